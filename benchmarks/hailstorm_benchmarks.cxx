@@ -0,0 +1,765 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include <hailstorm/hailstorm_operations.hxx>
+#include <hailstorm/hailstorm_arena_allocator.hxx>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+
+    //! \brief Synthetic resources, data views point into a single shared blob to keep memory usage low.
+    struct ResourceSet
+    {
+        static constexpr uint32_t Constant_MetadataCount = 16;
+
+        ResourceSet(uint32_t count, size_t min_size, size_t max_size) noexcept
+        {
+            std::mt19937 rng{ count };
+            std::uniform_int_distribution<size_t> size_dist{ min_size, max_size };
+
+            blob.resize(max_size);
+            for (size_t idx = 0; idx < blob.size(); ++idx)
+            {
+                blob[idx] = char(rng());
+            }
+
+            for (uint32_t idx = 0; idx < Constant_MetadataCount; ++idx)
+            {
+                meta_blobs.emplace_back(32 + idx * 8, char(idx));
+            }
+            for (std::vector<char> const& meta : meta_blobs)
+            {
+                metadata.push_back({ meta.data(), meta.size(), 8 });
+            }
+
+            path_storage.reserve(count);
+            for (uint32_t idx = 0; idx < count; ++idx)
+            {
+                path_storage.push_back("urn:benchmark/resources/" + std::to_string(idx) + ".bin");
+                paths.push_back(path_storage.back());
+
+                size_t const size = size_dist(rng);
+                data.push_back({ blob.data(), size, 8 });
+                metadata_mapping.push_back(idx % Constant_MetadataCount);
+                total_size += size;
+            }
+        }
+
+        auto write_data() const noexcept -> hailstorm::v1::HailstormWriteData
+        {
+            return {
+                .paths = paths,
+                .data = data,
+                .metadata = metadata,
+                .metadata_mapping = metadata_mapping,
+                .custom_values = { }
+            };
+        }
+
+        std::vector<char> blob;
+        std::vector<std::vector<char>> meta_blobs;
+        std::vector<std::string> path_storage;
+        std::vector<std::string_view> paths;
+        std::vector<hailstorm::Data> data;
+        std::vector<hailstorm::Data> metadata;
+        std::vector<uint32_t> metadata_mapping;
+        size_t total_size = 0;
+    };
+
+    auto resource_set(uint32_t count, size_t min_size, size_t max_size) noexcept -> ResourceSet const&
+    {
+        static std::map<std::tuple<uint32_t, size_t, size_t>, std::unique_ptr<ResourceSet>> sets;
+        std::unique_ptr<ResourceSet>& set = sets[{ count, min_size, max_size }];
+        if (set == nullptr)
+        {
+            set = std::make_unique<ResourceSet>(count, min_size, max_size);
+        }
+        return *set;
+    }
+
+    auto write_params(hailstorm::Allocator& alloc, hailstorm::Allocator& temp_alloc) noexcept -> hailstorm::v1::HailstormWriteParams
+    {
+        return hailstorm::v1::HailstormWriteParams{
+            .temp_alloc = temp_alloc,
+            .cluster_alloc = alloc,
+            .fn_select_chunk = hailstorm::v1::default_chunk_select_logic,
+            .fn_create_chunk = hailstorm::v1::default_chunk_create_logic,
+            .fn_resource_write_metadata = nullptr,
+            .fn_resource_write = nullptr,
+            .fn_custom_chunk_write = nullptr,
+            .userdata = nullptr
+        };
+    }
+
+    auto write_params(hailstorm::Allocator& alloc) noexcept -> hailstorm::v1::HailstormWriteParams
+    {
+        return write_params(alloc, alloc);
+    }
+
+    //! \brief Packs are cached so header benchmarks don't measure the write.
+    auto cached_pack(uint32_t count, bool paths_index) noexcept -> hailstorm::Memory
+    {
+        static hailstorm::Allocator alloc;
+        static std::map<std::pair<uint32_t, bool>, hailstorm::Memory> packs;
+
+        hailstorm::Memory& pack = packs[{ count, paths_index }];
+        if (pack.location == nullptr)
+        {
+            hailstorm::v1::HailstormWriteParams params = write_params(alloc);
+            params.create_paths_index = paths_index;
+            pack = hailstorm::v1::write_cluster(params, resource_set(count, 16, 64).write_data());
+        }
+        return pack;
+    }
+
+    void set_counters(benchmark::State& state, ResourceSet const& set) noexcept
+    {
+        state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(set.paths.size()));
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(set.total_size));
+    }
+
+} // namespace
+
+static void BM_ReadHeader(benchmark::State& state)
+{
+    hailstorm::Memory const pack = cached_pack(uint32_t(state.range(0)), false);
+    for (auto _ : state)
+    {
+        hailstorm::v1::HailstormData data;
+        hailstorm::Result const result = hailstorm::v1::read_header({ pack.location, pack.size, 8 }, data);
+        benchmark::DoNotOptimize(result);
+        benchmark::DoNotOptimize(data);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK(BM_ReadHeader)->Arg(1'000)->Arg(100'000)->Arg(1'000'000);
+
+static void BM_FindResource(benchmark::State& state)
+{
+    uint32_t const count = uint32_t(state.range(0));
+    hailstorm::Memory const pack = cached_pack(count, state.range(1) != 0);
+    ResourceSet const& set = resource_set(count, 16, 64);
+
+    hailstorm::v1::HailstormData data;
+    hailstorm::v1::read_header({ pack.location, pack.size, 8 }, data);
+
+    uint32_t idx = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(hailstorm::v1::find_resource(data, set.paths[idx]));
+        idx = (idx + 7919) % count;
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK(BM_FindResource)->ArgsProduct({ { 1'000, 100'000 }, { 0, 1 } });
+
+static void BM_WriteCluster(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    ResourceSet const& set = resource_set(uint32_t(state.range(0)), 64, size_t(state.range(1)));
+    hailstorm::v1::HailstormWriteParams const params = write_params(alloc);
+    hailstorm::v1::HailstormWriteData const write_data = set.write_data();
+
+    for (auto _ : state)
+    {
+        hailstorm::Memory const pack = hailstorm::v1::write_cluster(params, write_data);
+        benchmark::DoNotOptimize(pack.location);
+        alloc.deallocate(pack);
+    }
+    set_counters(state, set);
+}
+BENCHMARK(BM_WriteCluster)->ArgsProduct({ { 1'000, 100'000 }, { 256, 16 * 1024 } })->Unit(benchmark::kMillisecond);
+
+//! \brief Measures the cost of hashing resources when deduplicating data, all resources of the same size share their data.
+static void BM_WriteClusterDeduplicated(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    ResourceSet const& set = resource_set(uint32_t(state.range(0)), 64, 16 * 1024);
+    hailstorm::v1::HailstormWriteParams params = write_params(alloc);
+    params.deduplicate_data = state.range(1) != 0;
+    hailstorm::v1::HailstormWriteData const write_data = set.write_data();
+
+    size_t pack_size = 0;
+    for (auto _ : state)
+    {
+        hailstorm::Memory const pack = hailstorm::v1::write_cluster(params, write_data);
+        benchmark::DoNotOptimize(pack.location);
+        pack_size = pack.size;
+        alloc.deallocate(pack);
+    }
+    set_counters(state, set);
+    state.counters["pack_size"] = double(pack_size);
+}
+BENCHMARK(BM_WriteClusterDeduplicated)->ArgsProduct({ { 1'000, 100'000 }, { 0, 1 } })->ArgNames({ "resources", "dedup" })->Unit(benchmark::kMillisecond);
+
+//! \brief Measures finding duplicated metadata when each resource provides it's own metadata entry.
+//! \note The pack spans multiple chunks, so resources sharing metadata store their data in other chunks than the metadata.
+static void BM_WriteClusterDeduplicatedMetadata(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    ResourceSet const& set = resource_set(uint32_t(state.range(0)), 64, 16 * 1024);
+    hailstorm::v1::HailstormWriteParams params = write_params(alloc);
+    params.deduplicate_metadata = state.range(1) != 0;
+
+    std::vector<hailstorm::Data> metadata;
+    for (uint32_t const meta_idx : set.metadata_mapping)
+    {
+        metadata.push_back(set.metadata[meta_idx]);
+    }
+
+    hailstorm::v1::HailstormWriteData write_data = set.write_data();
+    write_data.metadata = metadata;
+    write_data.metadata_mapping = { };
+
+    size_t pack_chunks = 0;
+    for (auto _ : state)
+    {
+        hailstorm::Memory const pack = hailstorm::v1::write_cluster(params, write_data);
+        benchmark::DoNotOptimize(pack.location);
+
+        state.PauseTiming();
+        hailstorm::v1::HailstormData data;
+        if (pack.location == nullptr || hailstorm::v1::read_header({ pack.location, pack.size, 8 }, data) != hailstorm::Result::Success)
+        {
+            state.SkipWithError("Failed to write the pack.");
+            state.ResumeTiming();
+            break;
+        }
+        pack_chunks = data.chunks.size();
+        alloc.deallocate(pack);
+        state.ResumeTiming();
+    }
+    set_counters(state, set);
+    state.counters["chunks"] = double(pack_chunks);
+}
+BENCHMARK(BM_WriteClusterDeduplicatedMetadata)->ArgsProduct({ { 10'000, 100'000 }, { 0, 1 } })->ArgNames({ "resources", "dedup" })->Unit(benchmark::kMillisecond);
+
+//! \brief Measures writing a pack as segments, which references resource data instead of copying it.
+static void BM_WriteClusterSegments(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    ResourceSet const& set = resource_set(uint32_t(state.range(0)), 64, size_t(state.range(1)));
+    hailstorm::v1::HailstormWriteParams const params = write_params(alloc);
+    hailstorm::v1::HailstormWriteData const write_data = set.write_data();
+
+    for (auto _ : state)
+    {
+        hailstorm::v1::HailstormWriteSegments segments;
+        bool const success = hailstorm::v1::write_cluster_segments(params, write_data, segments);
+        benchmark::DoNotOptimize(success);
+        alloc.deallocate(segments.memory);
+    }
+    set_counters(state, set);
+}
+BENCHMARK(BM_WriteClusterSegments)->ArgsProduct({ { 1'000, 100'000 }, { 256, 16 * 1024 } })->Unit(benchmark::kMillisecond);
+
+//! \brief Measures updating 100 resources of an existing pack, with or without a paths index in the existing pack.
+static void BM_RepackCluster(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    uint32_t const count = uint32_t(state.range(0));
+    ResourceSet const& set = resource_set(count, 64, 256);
+
+    hailstorm::v1::HailstormWriteParams params = write_params(alloc);
+    params.create_paths_index = state.range(1) != 0;
+    hailstorm::Memory const pack = hailstorm::v1::write_cluster(params, set.write_data());
+
+    hailstorm::v1::HailstormData pack_data;
+    hailstorm::v1::read_header({ pack.location, pack.size, 8 }, pack_data);
+
+    // Resources spread over the whole pack are replaced, so changes are not limited to a few chunks.
+    std::vector<std::string_view> changed_paths;
+    std::vector<hailstorm::Data> changed_data;
+    for (uint32_t idx = 0; idx < count; idx += count / 100)
+    {
+        changed_paths.push_back(set.paths[idx]);
+        changed_data.push_back({ set.blob.data(), 128, 8 });
+    }
+
+    std::vector<uint32_t> const changed_mapping(changed_paths.size(), 0);
+    hailstorm::v1::HailstormWriteData const changes{
+        .paths = changed_paths,
+        .data = changed_data,
+        .metadata = std::span{ set.metadata }.subspan(0, 1),
+        .metadata_mapping = changed_mapping,
+        .custom_values = { }
+    };
+    hailstorm::v1::HailstormRepackData const repack_data{
+        .pack = pack_data,
+        .pack_data = { pack.location, pack.size, 8 },
+        .resources = changes
+    };
+
+    for (auto _ : state)
+    {
+        hailstorm::v1::HailstormWriteSegments segments;
+        bool const success = hailstorm::v1::repack_cluster(params, repack_data, segments);
+        benchmark::DoNotOptimize(success);
+        alloc.deallocate(segments.memory);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(changed_paths.size()));
+    alloc.deallocate(pack);
+}
+BENCHMARK(BM_RepackCluster)->ArgsProduct({ { 1'000, 100'000 }, { 0, 1 } })->ArgNames({ "resources", "index" })->Unit(benchmark::kMillisecond);
+
+//! \brief Measures baking many small packs, with temporary allocations going either to the heap or to a reused arena.
+static void BM_WriteClusterSmallPacks(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    hailstorm::ArenaAllocator arena{ alloc };
+    hailstorm::Allocator& temp_alloc = state.range(1) != 0 ? arena : alloc;
+
+    ResourceSet const& set = resource_set(uint32_t(state.range(0)), 64, 256);
+    hailstorm::v1::HailstormWriteParams const params = write_params(alloc, temp_alloc);
+    hailstorm::v1::HailstormWriteData const write_data = set.write_data();
+
+    for (auto _ : state)
+    {
+        hailstorm::Memory const pack = hailstorm::v1::write_cluster(params, write_data);
+        benchmark::DoNotOptimize(pack.location);
+        alloc.deallocate(pack);
+        arena.reset();
+    }
+    set_counters(state, set);
+}
+BENCHMARK(BM_WriteClusterSmallPacks)->ArgsProduct({ { 16, 256 }, { 0, 1 } })->ArgNames({ "resources", "arena" });
+
+//! \brief Measures chunk estimation and cluster layout by skipping resource data copies.
+static void BM_WriteClusterLayout(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    ResourceSet const& set = resource_set(uint32_t(state.range(0)), 64, 256);
+
+    std::vector<hailstorm::Data> empty_data = set.data;
+    for (hailstorm::Data& data : empty_data)
+    {
+        data.location = nullptr;
+    }
+
+    hailstorm::v1::HailstormWriteParams params = write_params(alloc);
+    params.fn_resource_write = [](auto const&, auto&, hailstorm::Memory, void*) noexcept { return true; };
+    params.chunk_planner = hailstorm::v1::HailstormChunkPlanner(state.range(1));
+
+    // Wrapping the default heuristics forces them to be called through function pointers.
+    if (state.range(2) != 0)
+    {
+        params.fn_select_chunk = [](auto meta, auto data, auto chunks, uint32_t start, uint32_t count, void* userdata) noexcept
+        {
+            return hailstorm::v1::default_chunk_select_logic(meta, data, chunks, start, count, userdata);
+        };
+        params.fn_create_chunk = [](auto meta, auto data, auto base_chunk, void* userdata) noexcept
+        {
+            return hailstorm::v1::default_chunk_create_logic(meta, data, base_chunk, userdata);
+        };
+    }
+
+    hailstorm::v1::HailstormWriteData write_data = set.write_data();
+    write_data.data = empty_data;
+
+    for (auto _ : state)
+    {
+        hailstorm::Memory const pack = hailstorm::v1::write_cluster(params, write_data);
+        benchmark::DoNotOptimize(pack.location);
+        alloc.deallocate(pack);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(set.paths.size()));
+}
+BENCHMARK(BM_WriteClusterLayout)
+    ->ArgsProduct({ { 1'000, 100'000, 1'000'000 }, { 0, 1 }, { 0, 1 } })
+    ->ArgNames({ "resources", "planner", "callbacks" })
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_WriteClusterAsync(benchmark::State& state)
+{
+    using hailstorm::v1::HailstormAsyncWriteCompletion;
+    using hailstorm::v1::HailstormAsyncWriteStatus;
+
+    hailstorm::Allocator alloc;
+    ResourceSet const& set = resource_set(uint32_t(state.range(0)), 64, size_t(state.range(1)));
+    hailstorm::v1::HailstormWriteData const write_data = set.write_data();
+
+    // Writes complete immediately into a single buffer, measuring the overhead of the async pipeline.
+    std::vector<char> output;
+    hailstorm::v1::HailstormAsyncWriteParams params{ .base_params = write_params(alloc) };
+    params.async_userdata = &output;
+    params.fn_async_open = [](size_t size, void* userdata) noexcept
+    {
+        reinterpret_cast<std::vector<char>*>(userdata)->resize(size);
+        return true;
+    };
+    params.fn_async_write_header = [](hailstorm::Data data, size_t offset, HailstormAsyncWriteCompletion*, void* userdata) noexcept
+    {
+        std::memcpy(reinterpret_cast<std::vector<char>*>(userdata)->data() + offset, data.location, data.size);
+        return HailstormAsyncWriteStatus::Completed;
+    };
+    params.fn_async_write_metadata = [](auto const& data, uint32_t idx, size_t offset, HailstormAsyncWriteCompletion*, void* userdata) noexcept
+    {
+        std::memcpy(reinterpret_cast<std::vector<char>*>(userdata)->data() + offset, data.metadata[idx].location, data.metadata[idx].size);
+        return HailstormAsyncWriteStatus::Completed;
+    };
+    params.fn_async_write_resource = [](auto const& data, auto& info, size_t offset, HailstormAsyncWriteCompletion*, void* userdata) noexcept
+    {
+        hailstorm::Data const res_data = data.data[info.resource_index];
+        std::memcpy(reinterpret_cast<std::vector<char>*>(userdata)->data() + offset, res_data.location, res_data.size);
+        return HailstormAsyncWriteStatus::Completed;
+    };
+    params.fn_async_write_custom_chunk = nullptr;
+    params.fn_async_close = [](void*) noexcept { return true; };
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(hailstorm::v1::write_cluster_async(params, write_data));
+    }
+    set_counters(state, set);
+}
+BENCHMARK(BM_WriteClusterAsync)->ArgsProduct({ { 1'000, 100'000 }, { 256, 16 * 1024 } })->Unit(benchmark::kMillisecond);
+
+static void BM_WriteClusterParallel(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    ResourceSet const& set = resource_set(uint32_t(state.range(0)), 64, size_t(state.range(1)));
+    hailstorm::v1::HailstormParallelWriteParams const params{ .base_params = write_params(alloc) };
+    hailstorm::v1::HailstormWriteData const write_data = set.write_data();
+
+    for (auto _ : state)
+    {
+        hailstorm::Memory const pack = hailstorm::v1::write_cluster_parallel(params, write_data);
+        benchmark::DoNotOptimize(pack.location);
+        alloc.deallocate(pack);
+    }
+    set_counters(state, set);
+}
+BENCHMARK(BM_WriteClusterParallel)->ArgsProduct({ { 1'000, 100'000 }, { 256, 16 * 1024 } })->Unit(benchmark::kMillisecond);
+
+//! \brief Measures writing 64 clusters one after another or as a single batch.
+static void BM_WriteClusters(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    ResourceSet const& set = resource_set(uint32_t(state.range(0)), 64, 4 * 1024);
+    std::vector<hailstorm::v1::HailstormWriteData> const clusters(64, set.write_data());
+    std::vector<hailstorm::Memory> packs(clusters.size());
+
+    hailstorm::v1::HailstormBatchWriteParams const params{ .base_params = write_params(alloc) };
+    bool const batch = state.range(1) == 1;
+
+    for (auto _ : state)
+    {
+        if (batch)
+        {
+            hailstorm::v1::write_clusters(params, clusters, packs);
+        }
+        else
+        {
+            for (size_t idx = 0; idx < clusters.size(); ++idx)
+            {
+                packs[idx] = hailstorm::v1::write_cluster(params.base_params, clusters[idx]);
+            }
+        }
+
+        for (hailstorm::Memory const& pack : packs)
+        {
+            benchmark::DoNotOptimize(pack.location);
+            alloc.deallocate(pack);
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(set.paths.size() * clusters.size()));
+}
+BENCHMARK(BM_WriteClusters)->ArgsProduct({ { 1'000, 10'000 }, { 0, 1 } })->ArgNames({ "resources", "batch" })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_PrefixResourcePaths(benchmark::State& state)
+{
+    std::string_view const prefix = "urn:benchmark-prefix/";
+    uint32_t const count = uint32_t(state.range(0));
+    hailstorm::Memory const pack = cached_pack(count, false);
+
+    hailstorm::v1::HailstormData data;
+    hailstorm::v1::read_header({ pack.location, pack.size, 8 }, data);
+
+    size_t const prefixed_size = hailstorm::v1::prefixed_resource_paths_size(data.paths, count, prefix);
+    std::vector<char> paths_buffer(prefixed_size);
+    std::vector<hailstorm::v1::HailstormResource> resources(data.resources.begin(), data.resources.end());
+
+    for (auto _ : state)
+    {
+        // Restore the original paths and resources, the operation updates both in place.
+        state.PauseTiming();
+        std::memcpy(paths_buffer.data(), data.paths_data.location, data.paths_data.size);
+        std::memset(paths_buffer.data() + data.paths_data.size, 0, prefixed_size - data.paths_data.size);
+        std::copy(data.resources.begin(), data.resources.end(), resources.begin());
+        state.ResumeTiming();
+
+        bool const result = hailstorm::v1::prefix_resource_paths(
+            data.paths, resources, { paths_buffer.data(), paths_buffer.size(), 8 }, prefix
+        );
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(prefixed_size));
+}
+BENCHMARK(BM_PrefixResourcePaths)->Arg(1'000)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMicrosecond);
+
+static void BM_ValidatePaths(benchmark::State& state)
+{
+    uint32_t const count = uint32_t(state.range(0));
+    hailstorm::Memory const pack = cached_pack(count, false);
+
+    hailstorm::v1::HailstormData data;
+    hailstorm::v1::read_header({ pack.location, pack.size, 8 }, data);
+
+    for (auto _ : state)
+    {
+        hailstorm::Result const result = hailstorm::v1::validate_paths(data);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(data.paths_data.size));
+}
+BENCHMARK(BM_ValidatePaths)->Arg(1'000)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMicrosecond);
+
+static void BM_SplitPaths(benchmark::State& state)
+{
+    uint32_t const count = uint32_t(state.range(0));
+    hailstorm::Memory const pack = cached_pack(count, false);
+
+    hailstorm::v1::HailstormData data;
+    hailstorm::v1::read_header({ pack.location, pack.size, 8 }, data);
+
+    std::vector<std::string_view> paths(count);
+    for (auto _ : state)
+    {
+        bool const result = hailstorm::v1::split_paths(data, paths);
+        benchmark::DoNotOptimize(result);
+        benchmark::DoNotOptimize(paths.data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+BENCHMARK(BM_SplitPaths)->Arg(1'000)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMicrosecond);
+
+static void BM_ChunkChecksum(benchmark::State& state)
+{
+    std::vector<char> data(size_t(state.range(0)));
+    for (size_t idx = 0; idx < data.size(); ++idx)
+    {
+        data[idx] = char(idx * 31);
+    }
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(hailstorm::v1::chunk_checksum({ data.data(), data.size(), 8 }));
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(data.size()));
+}
+BENCHMARK(BM_ChunkChecksum)->Arg(4 * 1024)->Arg(1024 * 1024)->Arg(32 * 1024 * 1024);
+
+static void BM_DecryptChunkData(benchmark::State& state)
+{
+    std::vector<char> data(size_t(state.range(0)));
+    hailstorm::v1::HailstormEncryptionKey const key{ .key = { 1, 2, 3, 4 }, .nonce = { 5, 6, 7, 8 } };
+
+    // Starts in the middle of a keystream block, same as most resources stored in a chunk.
+    for (auto _ : state)
+    {
+        hailstorm::v1::decrypt_chunk_data(key, 1, 7, { data.data(), data.size(), 8 });
+        benchmark::DoNotOptimize(data.data());
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(data.size()));
+}
+BENCHMARK(BM_DecryptChunkData)->Arg(4 * 1024)->Arg(1024 * 1024)->Arg(32 * 1024 * 1024);
+
+//! \brief Measures verifying all chunks of a pack holding 64_MiB of data in 1_MiB chunks, using the given number of workers.
+static void BM_VerifyChunks(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    ResourceSet const& set = resource_set(4'096, 16 * 1024, 16 * 1024);
+
+    hailstorm::v1::HailstormChunk const initial_chunk{ .size = 1024 * 1024, .align = 8, .type = 3 };
+    hailstorm::v1::HailstormWriteParams params = write_params(alloc);
+    params.initial_chunks = std::span{ &initial_chunk, 1 };
+    params.create_chunk_checksums = true;
+    params.fn_create_chunk = [](hailstorm::Data, hailstorm::Data, hailstorm::v1::HailstormChunk base, void*) noexcept
+    {
+        return base;
+    };
+
+    hailstorm::Memory const pack = hailstorm::v1::write_cluster(params, set.write_data());
+    hailstorm::v1::HailstormData data;
+    hailstorm::v1::read_header({ pack.location, pack.size, 8 }, data);
+
+    hailstorm::v1::HailstormVerifyParams const verify_params{ .worker_count = uint32_t(state.range(0)) };
+    for (auto _ : state)
+    {
+        hailstorm::Result const result = hailstorm::v1::verify_chunks(verify_params, data, { pack.location, pack.size, 8 });
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(pack.size - data.header.offset_data));
+    alloc.deallocate(pack);
+}
+BENCHMARK(BM_VerifyChunks)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ChunkResources(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    ResourceSet const& set = resource_set(uint32_t(state.range(0)), 256, 4 * 1024);
+
+    hailstorm::v1::HailstormChunk const initial_chunk{ .size = 64 * 1024, .align = 8, .type = 3 };
+    hailstorm::v1::HailstormWriteParams params = write_params(alloc);
+    params.initial_chunks = std::span{ &initial_chunk, 1 };
+    params.create_chunk_resources_index = state.range(1) != 0;
+    params.fn_create_chunk = [](hailstorm::Data, hailstorm::Data, hailstorm::v1::HailstormChunk base, void*) noexcept
+    {
+        return base;
+    };
+
+    hailstorm::Memory const pack = hailstorm::v1::write_cluster(params, set.write_data());
+    hailstorm::v1::HailstormData data;
+    hailstorm::v1::read_header({ pack.location, pack.size, 8 }, data);
+
+    // Lists the resources of every chunk, either using the index or by scanning all resources.
+    for (auto _ : state)
+    {
+        size_t total_size = 0;
+        for (uint32_t chunk_idx = 0; chunk_idx < data.chunks.size(); ++chunk_idx)
+        {
+            if (params.create_chunk_resources_index)
+            {
+                for (uint32_t resource_idx : hailstorm::v1::chunk_resources(data, chunk_idx))
+                {
+                    total_size += data.resources[resource_idx].size;
+                }
+            }
+            else
+            {
+                for (hailstorm::v1::HailstormResource const& resource : data.resources)
+                {
+                    total_size += resource.chunk == chunk_idx ? resource.size : 0;
+                }
+            }
+        }
+        benchmark::DoNotOptimize(total_size);
+    }
+    alloc.deallocate(pack);
+}
+BENCHMARK(BM_ChunkResources)->ArgsProduct({ { 1'000, 100'000 }, { 0, 1 } })->Unit(benchmark::kMicrosecond);
+
+//! \brief Measures restoring pointers in a 1_MiB chunk of baked resources, with a pointer every given number of bytes.
+static void BM_ApplyRelocations(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    ResourceSet const& set = resource_set(1'024, 256, 4 * 1024);
+
+    std::vector<uint32_t> offsets;
+    for (uint32_t offset = 0; offset + sizeof(uint64_t) <= 4 * 1024; offset += uint32_t(state.range(0)))
+    {
+        offsets.push_back(offset);
+    }
+
+    // Each resource stores pointers over all of it's data.
+    std::vector<std::span<uint32_t const>> relocations;
+    for (hailstorm::Data const& data : set.data)
+    {
+        relocations.push_back(std::span{ offsets }.first((data.size - sizeof(uint64_t)) / size_t(state.range(0)) + 1));
+    }
+
+    hailstorm::v1::HailstormChunk const initial_chunk{ .size = 1024 * 1024, .align = 8, .type = 3 };
+    hailstorm::v1::HailstormWriteParams params = write_params(alloc);
+    params.initial_chunks = std::span{ &initial_chunk, 1 };
+    params.fn_create_chunk = [](hailstorm::Data, hailstorm::Data, hailstorm::v1::HailstormChunk base, void*) noexcept
+    {
+        return base;
+    };
+
+    hailstorm::v1::HailstormWriteData write_data = set.write_data();
+    write_data.relocations = relocations;
+    hailstorm::Memory const pack = hailstorm::v1::write_cluster(params, write_data);
+    hailstorm::v1::HailstormData data;
+    hailstorm::v1::read_header({ pack.location, pack.size, 8 }, data);
+
+    // Values are patched again on each iteration, which is the same amount of work as the first pass.
+    std::vector<char> chunk(data.chunks[0].size);
+    std::memcpy(chunk.data(), reinterpret_cast<char const*>(pack.location) + data.chunks[0].offset, chunk.size());
+    for (auto _ : state)
+    {
+        hailstorm::Result const result = hailstorm::v1::apply_relocations(data, 0, { chunk.data(), chunk.size(), 8 });
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(hailstorm::v1::chunk_relocations(data, 0).size()));
+    alloc.deallocate(pack);
+}
+BENCHMARK(BM_ApplyRelocations)->Arg(8)->Arg(64)->Unit(benchmark::kMicrosecond);
+
+static void BM_PlanReads(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    ResourceSet const& set = resource_set(100'000, 256, 4 * 1024);
+
+    hailstorm::v1::HailstormChunk const initial_chunk{ .size = 1024 * 1024, .align = 8, .type = 3 };
+    hailstorm::v1::HailstormWriteParams params = write_params(alloc);
+    params.initial_chunks = std::span{ &initial_chunk, 1 };
+    params.fn_create_chunk = [](hailstorm::Data, hailstorm::Data, hailstorm::v1::HailstormChunk base, void*) noexcept
+    {
+        return base;
+    };
+
+    hailstorm::Memory const pack = hailstorm::v1::write_cluster(params, set.write_data());
+    hailstorm::v1::HailstormData data;
+    hailstorm::v1::read_header({ pack.location, pack.size, 8 }, data);
+
+    // Every N-th resource is requested, the reads count is reported to compare against one read per resource.
+    std::vector<uint32_t> resources;
+    for (uint32_t idx = 0; idx < data.resources.size(); idx += uint32_t(state.range(0)))
+    {
+        resources.push_back(idx);
+    }
+
+    hailstorm::v1::HailstormReadPlanParams const plan_params{ .alloc = alloc, .read_alignment = 4096 };
+    size_t count_reads = 0;
+    for (auto _ : state)
+    {
+        hailstorm::v1::HailstormReadPlan plan;
+        hailstorm::v1::plan_reads(plan_params, data, resources, plan);
+        count_reads = plan.reads.size();
+        alloc.deallocate(plan.memory);
+    }
+    state.counters["resources"] = double(resources.size());
+    state.counters["reads"] = double(count_reads);
+    alloc.deallocate(pack);
+}
+BENCHMARK(BM_PlanReads)->Arg(1)->Arg(16)->Arg(256)->Unit(benchmark::kMicrosecond);
+
+static void BM_ScanResources(benchmark::State& state)
+{
+    hailstorm::Allocator alloc;
+    ResourceSet const& set = resource_set(1'000'000, 16, 64);
+
+    hailstorm::v1::HailstormWriteParams params = write_params(alloc);
+    params.create_resource_columns = state.range(0) != 0;
+
+    hailstorm::Memory const pack = hailstorm::v1::write_cluster(params, set.write_data());
+    hailstorm::v1::HailstormData data;
+    hailstorm::v1::read_header({ pack.location, pack.size, 8 }, data);
+
+    // Sums the size of all resources stored in the first chunk, using the resources table or columns.
+    for (auto _ : state)
+    {
+        size_t total_size = 0;
+        for (uint32_t idx = 0; idx < data.resources.size(); ++idx)
+        {
+            total_size += hailstorm::v1::resource_chunk(data, idx) == 0 ? hailstorm::v1::resource_size(data, idx) : 0;
+        }
+        benchmark::DoNotOptimize(total_size);
+    }
+    alloc.deallocate(pack);
+}
+BENCHMARK(BM_ScanResources)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -18,8 +18,8 @@ class IceShardHailstormRecipe(ConanFile):
 
     # Binary configuration
     settings = "os", "compiler", "build_type", "arch"
-    options = {"fPIC": [True, False]}
-    default_options = {"fPIC": True}
+    options = {"fPIC": [True, False], "with_zlib": [True, False], "with_zstd": [True, False]}
+    default_options = {"fPIC": True, "with_zlib": True, "with_zstd": False}
 
     # Sources are located in the same place as this recipe, copy them to the recipe
     exports_sources = "LICENSE", "CMakeLists.txt", "private/*", "public/*"
@@ -33,6 +33,12 @@ class IceShardHailstormRecipe(ConanFile):
     def configure(self):
         self.settings.compiler.cppstd = 20
 
+    def requirements(self):
+        if self.options.with_zlib:
+            self.requires("zlib/[>=1.2.11 <2]")
+        if self.options.with_zstd:
+            self.requires("zstd/[>=1.5.0 <2]")
+
     def layout(self):
         cmake_layout(self)
 
@@ -40,6 +46,8 @@ class IceShardHailstormRecipe(ConanFile):
         deps = CMakeDeps(self)
         deps.generate()
         tc = CMakeToolchain(self, "Ninja")
+        tc.variables["HAILSTORM_COMPRESSION_ZLIB"] = bool(self.options.with_zlib)
+        tc.variables["HAILSTORM_COMPRESSION_ZSTD"] = bool(self.options.with_zstd)
         if self.settings.os == "Linux":
             tc.variables["CMAKE_C_COMPILER"] = str(self.settings.compiler)
             tc.variables["CMAKE_CXX_COMPILER"] = str(self.settings.compiler)
@@ -61,3 +69,5 @@ class IceShardHailstormRecipe(ConanFile):
     def package_info(self):
         self.cpp_info.libs = ["hailstorm"]
         self.cpp_info.includedirs = ["public"]
+        if self.settings.os == "Linux":
+            self.cpp_info.system_libs = ["pthread"]
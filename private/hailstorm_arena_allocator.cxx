@@ -0,0 +1,127 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include <hailstorm/hailstorm_arena_allocator.hxx>
+#include "hailstorm_memutils.hxx"
+#include <cassert>
+
+namespace hailstorm::v1
+{
+
+    struct ArenaAllocator::Block
+    {
+        Block* next;
+        hailstorm::Memory memory;
+
+        auto begin() noexcept -> char* { return reinterpret_cast<char*>(align_to(static_cast<void*>(this + 1), Constant_Alignment)); }
+        auto end() noexcept -> char* { return reinterpret_cast<char*>(memory.location) + memory.size; }
+    };
+
+    ArenaAllocator::ArenaAllocator(hailstorm::Allocator& backing_alloc, size_t block_size) noexcept
+        : _backing_alloc{ backing_alloc }
+        , _block_size{ block_size }
+        , _reserved_size{ 0 }
+        , _blocks{ nullptr }
+        , _current{ nullptr }
+        , _cursor{ nullptr }
+        , _end{ nullptr }
+        , _last_allocation{ nullptr }
+    {
+    }
+
+    ArenaAllocator::~ArenaAllocator() noexcept
+    {
+        Block* block = _blocks;
+        while (block != nullptr)
+        {
+            Block* const next = block->next;
+            _backing_alloc.deallocate(block->memory);
+            block = next;
+        }
+    }
+
+    auto ArenaAllocator::allocate(size_t size) noexcept -> hailstorm::Memory
+    {
+        char* location = reinterpret_cast<char*>(align_to(static_cast<void*>(_cursor), Constant_Alignment));
+        if (_current == nullptr || location > _end || size_t(_end - location) < size)
+        {
+            if (next_block(size) == false)
+            {
+                return { };
+            }
+            location = _cursor;
+        }
+
+        _cursor = location + size;
+        _last_allocation = location;
+        return { location, size, Constant_Alignment };
+    }
+
+    void ArenaAllocator::deallocate(void* ptr) noexcept
+    {
+        // Only the most recent allocation can be rolled back, all other memory is released on 'reset'.
+        if (ptr != nullptr && ptr == _last_allocation)
+        {
+            _cursor = _last_allocation;
+            _last_allocation = nullptr;
+        }
+    }
+
+    void ArenaAllocator::deallocate(hailstorm::Memory memory) noexcept
+    {
+        this->deallocate(memory.location);
+    }
+
+    void ArenaAllocator::reset() noexcept
+    {
+        _current = _blocks;
+        _cursor = _blocks != nullptr ? _blocks->begin() : nullptr;
+        _end = _blocks != nullptr ? _blocks->end() : nullptr;
+        _last_allocation = nullptr;
+    }
+
+    bool ArenaAllocator::next_block(size_t size) noexcept
+    {
+        // Try to reuse blocks kept after a 'reset', blocks too small for this allocation are skipped until the next reset.
+        Block* const first_candidate = _current != nullptr ? _current->next : _blocks;
+        for (Block* block = first_candidate; block != nullptr; block = block->next)
+        {
+            if (size_t(block->end() - block->begin()) >= size)
+            {
+                _current = block;
+                _cursor = block->begin();
+                _end = block->end();
+                return true;
+            }
+        }
+
+        size_t const header_size = align_to(sizeof(Block), Constant_Alignment) + Constant_Alignment;
+        hailstorm::Memory const memory = _backing_alloc.allocate(std::max(_block_size, size + header_size));
+        if (memory.location == nullptr)
+        {
+            return false;
+        }
+
+        Block* const block = reinterpret_cast<Block*>(memory.location);
+        block->memory = memory;
+
+        // New blocks are inserted after the current block, so blocks skipped earlier can still be reused after a reset.
+        if (_current != nullptr)
+        {
+            block->next = _current->next;
+            _current->next = block;
+        }
+        else
+        {
+            block->next = _blocks;
+            _blocks = block;
+        }
+
+        _reserved_size += memory.size;
+        _current = block;
+        _cursor = block->begin();
+        _end = block->end();
+        return true;
+    }
+
+} // namespace hailstorm::v1
@@ -1,6 +1,7 @@
 #pragma once
 #include <hailstorm/hailstorm_types.hxx>
 #include <memory_resource>
+#include <cstring>
 #include <vector>
 
 namespace hailstorm
@@ -120,7 +121,10 @@ namespace hailstorm
     template<typename T>
     inline void Array<T>::memset(uint8_t value) noexcept requires (std::is_trivial_v<T>)
     {
-        std::memset(_vector.data(), value, _vector.size() * sizeof(T));
+        if (_vector.empty() == false)
+        {
+            std::memset(_vector.data(), value, _vector.size() * sizeof(T));
+        }
     }
 
     template<typename T>
@@ -0,0 +1,863 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include <hailstorm/hailstorm_async_reader.hxx>
+#include <hailstorm/hailstorm_operations.hxx>
+#include "hailstorm_memutils.hxx"
+#include "hailstorm_array.hxx"
+#include "hailstorm_file.hxx"
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#endif
+
+namespace hailstorm::v1
+{
+
+    //! \brief The minimal valid 'pack_slice_alignment', used to read the header before the actual alignment is known.
+    static constexpr uint32_t Constant_MinSliceAlignment = 4 * Constant_1KiB;
+
+    namespace
+    {
+
+        //! \brief Reads the range extended to the given alignment into aligned memory, or the range as is if the alignment is '0'.
+        //! \return The requested data inside the allocated memory, or an empty view if reading failed.
+        auto read_aligned(
+            hailstorm::Allocator& alloc,
+            hailstorm::NativeFileHandle file,
+            uint64_t offset,
+            size_t size,
+            uint32_t align,
+            hailstorm::Memory& out_memory
+        ) noexcept -> hailstorm::Data
+        {
+            uint64_t const read_begin = align > 0 ? offset & ~uint64_t{ align - 1 } : offset;
+            uint64_t const read_end = align > 0 ? align_to(offset + size, align) : offset + size;
+            size_t const read_size = size_t(read_end - read_begin);
+
+            out_memory = alloc.allocate(read_size + align);
+            if (out_memory.location == nullptr)
+            {
+                return { };
+            }
+
+            void* const location = align > 0 ? align_to(out_memory.location, align) : out_memory.location;
+            if (file_read_at(file, { location, read_size, std::max<size_t>(align, out_memory.align) }, read_begin) == false)
+            {
+                alloc.deallocate(out_memory);
+                out_memory = { };
+                return { };
+            }
+            return { ptr_add(location, size_t(offset - read_begin)), size, align > 0 ? align : out_memory.align };
+        }
+
+    } // namespace
+
+    namespace detail
+    {
+
+        //! \brief Starts a thread executing 'fn(internal)'.
+        //! \note Thread creation reports failures using exceptions, which are not allowed to leave the noexcept callers.
+        //! \return 'true' if the thread was started.
+        template<typename Internal>
+        bool start_thread(std::thread& out_thread, void(*fn)(Internal&) noexcept, Internal& internal) noexcept
+        {
+            try
+            {
+                out_thread = std::thread{ fn, std::ref(internal) };
+                return true;
+            }
+            catch (std::system_error const&)
+            {
+                return false;
+            }
+        }
+
+    } // namespace detail
+
+    struct ThreadedIOBackend::Internal
+    {
+        explicit Internal(hailstorm::Allocator& alloc) noexcept
+            : threads{ alloc }
+            , queue{ alloc }
+        {
+        }
+
+        std::mutex mutex;
+        std::condition_variable cv_requests;
+        bool stopping = false;
+
+        hailstorm::Array<std::thread> threads;
+
+        //! \brief Pending requests, 'queue_head' is the next request to be executed.
+        hailstorm::Array<hailstorm::v1::HailstormReadRequest*> queue;
+        uint32_t queue_head = 0;
+
+        static void io_thread(Internal& internal) noexcept
+        {
+            std::unique_lock lock{ internal.mutex };
+            while (true)
+            {
+                internal.cv_requests.wait(lock, [&]() noexcept
+                    {
+                        return internal.stopping || internal.queue_head < internal.queue.count();
+                    }
+                );
+
+                // Pending requests are always finished before stopping.
+                if (internal.queue_head == internal.queue.count())
+                {
+                    return;
+                }
+
+                HailstormReadRequest* const request = internal.queue[internal.queue_head++];
+                if (internal.queue_head == internal.queue.count())
+                {
+                    internal.queue.resize(0);
+                    internal.queue_head = 0;
+                }
+
+                lock.unlock();
+                bool const success = file_read_at(request->file, request->memory, request->offset);
+                request->fn_complete(*request, success);
+                lock.lock();
+            }
+        }
+
+        static bool submit_read(HailstormReadRequest& request, void* userdata) noexcept
+        {
+            if (userdata == nullptr)
+            {
+                return false;
+            }
+
+            Internal& internal = *reinterpret_cast<Internal*>(userdata);
+            {
+                std::lock_guard lock{ internal.mutex };
+                if (internal.stopping)
+                {
+                    return false;
+                }
+                internal.queue.push_back(&request);
+            }
+            internal.cv_requests.notify_one();
+            return true;
+        }
+    };
+
+    ThreadedIOBackend::ThreadedIOBackend(hailstorm::Allocator& alloc, uint32_t thread_count) noexcept
+        : _allocator{ alloc }
+        , _internal{ nullptr }
+    {
+        hailstorm::Memory const memory = _allocator.allocate(sizeof(Internal));
+        if (memory.location == nullptr)
+        {
+            return;
+        }
+        _internal = new (memory.location) Internal{ _allocator };
+
+        if (thread_count == 0)
+        {
+            thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        _internal->threads.reserve(thread_count);
+        for (uint32_t idx = 0; idx < thread_count; ++idx)
+        {
+            std::thread thread;
+            if (detail::start_thread(thread, Internal::io_thread, *_internal) == false)
+            {
+                break;
+            }
+            _internal->threads.push_back(std::move(thread));
+        }
+
+        if (_internal->threads.empty())
+        {
+            _internal->~Internal();
+            _allocator.deallocate(_internal);
+            _internal = nullptr;
+        }
+    }
+
+    ThreadedIOBackend::~ThreadedIOBackend() noexcept
+    {
+        if (_internal == nullptr)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard lock{ _internal->mutex };
+            _internal->stopping = true;
+        }
+        _internal->cv_requests.notify_all();
+
+        for (std::thread& thread : _internal->threads)
+        {
+            thread.join();
+        }
+
+        _internal->~Internal();
+        _allocator.deallocate(_internal);
+    }
+
+    auto ThreadedIOBackend::backend() noexcept -> hailstorm::v1::HailstormIOBackend
+    {
+        return { .fn_submit_read = Internal::submit_read, .userdata = _internal };
+    }
+
+#if defined(__linux__)
+
+    struct UringIOBackend::Internal
+    {
+        //! \brief The 'user_data' value of the request used to wake up the completion thread.
+        static constexpr uint64_t Constant_WakeUserData = ~uint64_t{ 0 };
+
+        //! \brief The maximum size of a single read, bigger requests are read using multiple reads.
+        static constexpr size_t Constant_MaxReadSize = Constant_1GiB;
+
+        explicit Internal(hailstorm::Allocator& alloc) noexcept
+            : slots{ alloc }
+            , free_slots{ alloc }
+            , queue{ alloc }
+        {
+        }
+
+        int ring_fd = -1;
+
+        void* sq_ring = MAP_FAILED;
+        size_t sq_ring_size = 0;
+        uint32_t* sq_head = nullptr;
+        uint32_t* sq_tail = nullptr;
+        uint32_t* sq_array = nullptr;
+        uint32_t sq_mask = 0;
+
+        void* cq_ring = MAP_FAILED;
+        size_t cq_ring_size = 0;
+        uint32_t* cq_head = nullptr;
+        uint32_t* cq_tail = nullptr;
+        io_uring_cqe* cqes = nullptr;
+        uint32_t cq_mask = 0;
+
+        void* sqes = MAP_FAILED;
+        size_t sqes_size = 0;
+
+        std::mutex mutex;
+        bool stopping = false;
+        std::thread thread;
+
+        //! \brief Entries pushed to the submission queue, but not yet consumed by the kernel.
+        uint32_t sq_pending = 0;
+
+        //! \brief A request in flight, 'done' is the number of bytes already read.
+        struct Slot
+        {
+            hailstorm::v1::HailstormReadRequest* request;
+            size_t done;
+        };
+
+        //! \brief Requests in flight, the slot index is used as the 'user_data' value.
+        hailstorm::Array<Slot> slots;
+        hailstorm::Array<uint32_t> free_slots;
+
+        //! \brief Requests waiting for a free slot, 'queue_head' is the next request to be submitted.
+        hailstorm::Array<hailstorm::v1::HailstormReadRequest*> queue;
+        uint32_t queue_head = 0;
+
+        static auto ring_enter(int fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags) noexcept -> int
+        {
+            return int(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+        }
+
+        bool setup(uint32_t queue_depth) noexcept
+        {
+            io_uring_params params{ };
+            ring_fd = int(syscall(__NR_io_uring_setup, std::max(queue_depth, 2u), &params));
+            if (ring_fd < 0)
+            {
+                return false;
+            }
+
+            sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+            cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+            // Since 5.4 both rings can be mapped using a single mapping.
+            bool const single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single_mmap)
+            {
+                sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+            }
+
+            sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+            if (sq_ring == MAP_FAILED)
+            {
+                return false;
+            }
+
+            if (single_mmap == false)
+            {
+                cq_ring = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+                if (cq_ring == MAP_FAILED)
+                {
+                    return false;
+                }
+            }
+
+            sqes = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+            if (sqes == MAP_FAILED)
+            {
+                return false;
+            }
+
+            void* const cq_base = single_mmap ? sq_ring : cq_ring;
+            sq_head = reinterpret_cast<uint32_t*>(ptr_add(sq_ring, params.sq_off.head));
+            sq_tail = reinterpret_cast<uint32_t*>(ptr_add(sq_ring, params.sq_off.tail));
+            sq_array = reinterpret_cast<uint32_t*>(ptr_add(sq_ring, params.sq_off.array));
+            sq_mask = *reinterpret_cast<uint32_t*>(ptr_add(sq_ring, params.sq_off.ring_mask));
+            cq_head = reinterpret_cast<uint32_t*>(ptr_add(cq_base, params.cq_off.head));
+            cq_tail = reinterpret_cast<uint32_t*>(ptr_add(cq_base, params.cq_off.tail));
+            cqes = reinterpret_cast<io_uring_cqe*>(ptr_add(cq_base, params.cq_off.cqes));
+            cq_mask = *reinterpret_cast<uint32_t*>(ptr_add(cq_base, params.cq_off.ring_mask));
+
+            // Submission entries are used in ring order, so the index array never changes.
+            for (uint32_t idx = 0; idx < params.sq_entries; ++idx)
+            {
+                sq_array[idx] = idx;
+            }
+
+            // One entry is always left for the wake up request, so the completion queue can never overflow.
+            uint32_t const slot_count = params.sq_entries - 1;
+            slots.resize(slot_count);
+            free_slots.reserve(slot_count);
+            for (uint32_t idx = slot_count; idx > 0; --idx)
+            {
+                free_slots.push_back(idx - 1);
+            }
+            return true;
+        }
+
+        void teardown() noexcept
+        {
+            if (sqes != MAP_FAILED)
+            {
+                munmap(sqes, sqes_size);
+            }
+            if (cq_ring != MAP_FAILED)
+            {
+                munmap(cq_ring, cq_ring_size);
+            }
+            if (sq_ring != MAP_FAILED)
+            {
+                munmap(sq_ring, sq_ring_size);
+            }
+            if (ring_fd >= 0)
+            {
+                close(ring_fd);
+            }
+        }
+
+        auto push_entry_locked() noexcept -> io_uring_sqe&
+        {
+            uint32_t const tail = *sq_tail;
+            io_uring_sqe& sqe = reinterpret_cast<io_uring_sqe*>(sqes)[tail & sq_mask];
+            sqe = { };
+
+            // The entry is visible to the kernel once the tail is updated by the caller.
+            sq_pending += 1;
+            return sqe;
+        }
+
+        void push_read_locked(uint32_t slot_idx) noexcept
+        {
+            Slot const& slot = slots[slot_idx];
+            HailstormReadRequest const& request = *slot.request;
+
+            io_uring_sqe& sqe = push_entry_locked();
+            sqe.opcode = IORING_OP_READ;
+            sqe.fd = int(request.file);
+            sqe.addr = uint64_t(reinterpret_cast<uintptr_t>(ptr_add(request.memory.location, slot.done)));
+            sqe.len = uint32_t(std::min(request.memory.size - slot.done, Constant_MaxReadSize));
+            sqe.off = request.offset + slot.done;
+            sqe.user_data = slot_idx;
+            std::atomic_ref{ *sq_tail }.store(*sq_tail + 1, std::memory_order_release);
+        }
+
+        void push_wake_locked() noexcept
+        {
+            io_uring_sqe& sqe = push_entry_locked();
+            sqe.opcode = IORING_OP_NOP;
+            sqe.user_data = Constant_WakeUserData;
+            std::atomic_ref{ *sq_tail }.store(*sq_tail + 1, std::memory_order_release);
+        }
+
+        void submit_locked() noexcept
+        {
+            while (sq_pending > 0)
+            {
+                int const submitted = ring_enter(ring_fd, sq_pending, 0, 0);
+                if (submitted > 0)
+                {
+                    sq_pending -= uint32_t(submitted);
+                }
+                else if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                {
+                    // Entries stay in the ring and are submitted with the next request.
+                    return;
+                }
+            }
+        }
+
+        //! \brief Handles a single completion, resubmitting short reads and starting queued requests.
+        //! \return The finished request or 'nullptr' if the request is still in flight.
+        auto complete_locked(uint32_t slot_idx, int32_t result, bool& out_success) noexcept -> HailstormReadRequest*
+        {
+            Slot& slot = slots[slot_idx];
+            HailstormReadRequest* const request = slot.request;
+
+            bool const retry = result == -EINTR || result == -EAGAIN;
+            if (result > 0)
+            {
+                slot.done += size_t(result);
+            }
+
+            if (retry || (result > 0 && slot.done < request->memory.size))
+            {
+                push_read_locked(slot_idx);
+                submit_locked();
+                return nullptr;
+            }
+
+            out_success = result >= 0 && slot.done == request->memory.size;
+            if (queue_head < queue.count())
+            {
+                slot = { .request = queue[queue_head++], .done = 0 };
+                if (queue_head == queue.count())
+                {
+                    queue.resize(0);
+                    queue_head = 0;
+                }
+                push_read_locked(slot_idx);
+                submit_locked();
+            }
+            else
+            {
+                slot = { .request = nullptr, .done = 0 };
+                free_slots.push_back(slot_idx);
+            }
+            return request;
+        }
+
+        static void io_thread(Internal& internal) noexcept
+        {
+            while (true)
+            {
+                // Only this thread consumes completions, so the head is never modified by others.
+                uint32_t const head = *internal.cq_head;
+                if (head == std::atomic_ref{ *internal.cq_tail }.load(std::memory_order_acquire))
+                {
+                    {
+                        // Pending requests are always finished before stopping.
+                        std::lock_guard lock{ internal.mutex };
+                        if (internal.stopping && internal.free_slots.count() == internal.slots.count())
+                        {
+                            return;
+                        }
+                    }
+
+                    // Returns immediately if any completion is already available.
+                    ring_enter(internal.ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+                    continue;
+                }
+
+                io_uring_cqe const cqe = internal.cqes[head & internal.cq_mask];
+                std::atomic_ref{ *internal.cq_head }.store(head + 1, std::memory_order_release);
+                if (cqe.user_data == Constant_WakeUserData)
+                {
+                    continue;
+                }
+
+                bool success = false;
+                HailstormReadRequest* request;
+                {
+                    std::lock_guard lock{ internal.mutex };
+                    request = internal.complete_locked(uint32_t(cqe.user_data), cqe.res, success);
+                }
+
+                if (request != nullptr)
+                {
+                    request->fn_complete(*request, success);
+                }
+            }
+        }
+
+        static bool submit_read(HailstormReadRequest& request, void* userdata) noexcept
+        {
+            if (userdata == nullptr)
+            {
+                return false;
+            }
+
+            Internal& internal = *reinterpret_cast<Internal*>(userdata);
+            std::lock_guard lock{ internal.mutex };
+            if (internal.stopping)
+            {
+                return false;
+            }
+
+            if (internal.free_slots.empty())
+            {
+                internal.queue.push_back(&request);
+                return true;
+            }
+
+            uint32_t const slot_idx = internal.free_slots[internal.free_slots.count() - 1];
+            internal.free_slots.resize(internal.free_slots.count() - 1);
+            internal.slots[slot_idx] = { .request = &request, .done = 0 };
+            internal.push_read_locked(slot_idx);
+            internal.submit_locked();
+            return true;
+        }
+    };
+
+    UringIOBackend::UringIOBackend(hailstorm::Allocator& alloc, uint32_t queue_depth) noexcept
+        : _allocator{ alloc }
+        , _internal{ nullptr }
+    {
+        hailstorm::Memory const memory = _allocator.allocate(sizeof(Internal));
+        if (memory.location == nullptr)
+        {
+            return;
+        }
+
+        Internal* const internal = new (memory.location) Internal{ _allocator };
+        if (internal->setup(queue_depth) && detail::start_thread(internal->thread, Internal::io_thread, *internal))
+        {
+            _internal = internal;
+        }
+        else
+        {
+            internal->teardown();
+            internal->~Internal();
+            _allocator.deallocate(internal);
+        }
+    }
+
+    UringIOBackend::~UringIOBackend() noexcept
+    {
+        if (_internal == nullptr)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard lock{ _internal->mutex };
+            _internal->stopping = true;
+            _internal->push_wake_locked();
+            _internal->submit_locked();
+        }
+        _internal->thread.join();
+
+        _internal->teardown();
+        _internal->~Internal();
+        _allocator.deallocate(_internal);
+    }
+
+    auto UringIOBackend::backend() noexcept -> hailstorm::v1::HailstormIOBackend
+    {
+        return { .fn_submit_read = Internal::submit_read, .userdata = _internal };
+    }
+
+#else
+
+    struct UringIOBackend::Internal
+    {
+        static bool submit_read(HailstormReadRequest&, void*) noexcept
+        {
+            return false;
+        }
+    };
+
+    UringIOBackend::UringIOBackend(hailstorm::Allocator& alloc, uint32_t) noexcept
+        : _allocator{ alloc }
+        , _internal{ nullptr }
+    {
+    }
+
+    UringIOBackend::~UringIOBackend() noexcept = default;
+
+    auto UringIOBackend::backend() noexcept -> hailstorm::v1::HailstormIOBackend
+    {
+        return { .fn_submit_read = Internal::submit_read, .userdata = nullptr };
+    }
+
+#endif
+
+    AsyncReader::AsyncReader(hailstorm::Allocator& alloc, hailstorm::v1::HailstormIOBackend backend) noexcept
+        : _allocator{ alloc }
+        , _backend{ backend }
+        , _file{ Constant_InvalidFileHandle }
+        , _owns_file{ false }
+        , _pack_offset{ 0 }
+        , _io_alignment{ 0 }
+        , _header_memory{ }
+        , _data{ }
+    {
+    }
+
+    AsyncReader::~AsyncReader() noexcept
+    {
+        close();
+    }
+
+    auto AsyncReader::open(char const* path, uint64_t pack_offset, bool unbuffered) noexcept -> hailstorm::Result
+    {
+        close();
+
+        FileOpenFlags const flags = unbuffered ? FileOpenFlags::Read | FileOpenFlags::Unbuffered : FileOpenFlags::Read;
+        hailstorm::NativeFileHandle const file = file_open(path, flags);
+        if (file == Constant_InvalidFileHandle)
+        {
+            return Result::E_FileAccessError;
+        }
+
+        hailstorm::Result const result = open_internal(file, pack_offset, unbuffered);
+        if (result == Result::Success)
+        {
+            _owns_file = true;
+        }
+        else
+        {
+            file_close(file);
+        }
+        return result;
+    }
+
+    auto AsyncReader::open(hailstorm::NativeFileHandle file, uint64_t pack_offset, bool unbuffered) noexcept -> hailstorm::Result
+    {
+        close();
+        return open_internal(file, pack_offset, unbuffered);
+    }
+
+    auto AsyncReader::open_internal(hailstorm::NativeFileHandle file, uint64_t pack_offset, bool unbuffered) noexcept -> hailstorm::Result
+    {
+        if (unbuffered && (pack_offset % Constant_MinSliceAlignment) != 0)
+        {
+            return Result::E_InvalidArgument;
+        }
+
+        // Unbuffered reads need to be aligned, so the first slice is read even if only the header is used.
+        HailstormHeader header{ };
+        if (unbuffered)
+        {
+            hailstorm::Memory slice_memory;
+            hailstorm::Data const slice = read_aligned(
+                _allocator, file, pack_offset, sizeof(HailstormHeader), Constant_MinSliceAlignment, slice_memory
+            );
+            if (slice.location == nullptr)
+            {
+                return Result::E_IncompleteHeaderData;
+            }
+            std::memcpy(&header, slice.location, sizeof(HailstormHeader));
+            _allocator.deallocate(slice_memory);
+        }
+        else if (file_read_at(file, { &header, sizeof(header), alignof(HailstormHeader) }, pack_offset) == false)
+        {
+            return Result::E_IncompleteHeaderData;
+        }
+
+        if (header.magic != Constant_HailstormMagic || header.header_version != Constant_HailstormHeaderVersionV0)
+        {
+            return Result::E_InvalidPackData;
+        }
+
+        // Read everything up to the first chunk, this includes paths and sections data.
+        if (header.offset_data < sizeof(HailstormHeader) || header.offset_data >= Constant_1GiB)
+        {
+            return Result::E_InvalidPackData;
+        }
+
+        // Only sliced packs guarantee that all chunks start and end at an aligned offset.
+        uint32_t const io_alignment = unbuffered ? header.pack_slice_alignment : 0;
+        if (unbuffered
+            && (io_alignment < Constant_MinSliceAlignment || (io_alignment & (io_alignment - 1)) != 0 || (pack_offset % io_alignment) != 0))
+        {
+            return Result::E_InvalidArgument;
+        }
+
+        hailstorm::Memory header_memory;
+        hailstorm::Data const header_data = read_aligned(
+            _allocator, file, pack_offset, size_t(header.offset_data), io_alignment, header_memory
+        );
+        if (header_data.location == nullptr)
+        {
+            return Result::E_IncompleteHeaderData;
+        }
+
+        hailstorm::Result const result = read_header(header_data, _data);
+        if (result != Result::Success)
+        {
+            _allocator.deallocate(header_memory);
+            _data = { };
+            return result;
+        }
+
+        _file = file;
+        _pack_offset = pack_offset;
+        _io_alignment = io_alignment;
+        _header_memory = header_memory;
+        return Result::Success;
+    }
+
+    void AsyncReader::close() noexcept
+    {
+        if (_owns_file)
+        {
+            file_close(_file);
+        }
+
+        if (_header_memory.location != nullptr)
+        {
+            _allocator.deallocate(_header_memory);
+        }
+
+        _file = Constant_InvalidFileHandle;
+        _owns_file = false;
+        _pack_offset = 0;
+        _io_alignment = 0;
+        _header_memory = { };
+        _data = { };
+    }
+
+    AsyncReadOperation::AsyncReadOperation(
+        hailstorm::v1::AsyncReader& reader,
+        uint64_t offset,
+        size_t size
+    ) noexcept
+        : _allocator{ reader._allocator }
+        , _backend{ reader._backend }
+        , _request{
+            .file = reader._file,
+            .offset = reader._pack_offset + offset,
+            .memory = { },
+            .fn_complete = AsyncReadOperation::on_complete,
+            .request_userdata = nullptr
+        }
+        , _memory{ }
+        , _data{ }
+        , _coro{ }
+        , _result{ Result::Success }
+    {
+        assert(reader.is_open());
+
+        // With unbuffered access the read is extended to the pack slice alignment, stored in aligned memory.
+        uint32_t const align = reader._io_alignment;
+        uint64_t const read_begin = align > 0 ? _request.offset & ~uint64_t{ align - 1 } : _request.offset;
+        uint64_t const read_end = align > 0 ? align_to(_request.offset + size, align) : _request.offset + size;
+        size_t const read_size = size_t(read_end - read_begin);
+
+        _memory = _allocator.allocate(read_size + align);
+        if (_memory.location == nullptr && size > 0)
+        {
+            _result = Result::E_InvalidArgument;
+        }
+
+        void* const location = align > 0 ? align_to(_memory.location, align) : _memory.location;
+        _data = { ptr_add(location, size_t(_request.offset - read_begin)), size, align > 0 ? align : _memory.align };
+        _request.offset = read_begin;
+        _request.memory = { location, read_size, align > 0 ? align : _memory.align };
+    }
+
+    AsyncReadOperation::~AsyncReadOperation() noexcept
+    {
+        if (_memory.location != nullptr)
+        {
+            _allocator.deallocate(_memory);
+        }
+    }
+
+    bool AsyncReadOperation::await_suspend(std::coroutine_handle<> coro) noexcept
+    {
+        _coro = coro;
+        _request.request_userdata = this;
+
+        // Once submitted, the operation might be already completed and destroyed on another thread.
+        if (_backend.fn_submit_read(_request, _backend.userdata) == false)
+        {
+            _result = Result::E_FileAccessError;
+            return false;
+        }
+        return true;
+    }
+
+    auto AsyncReadOperation::await_resume() noexcept -> hailstorm::v1::HailstormAsyncReadResult
+    {
+        if (_result != Result::Success)
+        {
+            return { .result = _result, .memory = { }, .data = { } };
+        }
+        return { .result = Result::Success, .memory = std::exchange(_memory, { }), .data = _data };
+    }
+
+    void AsyncReadOperation::on_complete(hailstorm::v1::HailstormReadRequest& request, bool success) noexcept
+    {
+        AsyncReadOperation* const operation = reinterpret_cast<AsyncReadOperation*>(request.request_userdata);
+        operation->_result = success ? Result::Success : Result::E_FileAccessError;
+        operation->_coro.resume();
+    }
+
+    auto load_chunk(
+        hailstorm::v1::AsyncReader& reader,
+        uint32_t chunk_idx
+    ) noexcept -> hailstorm::v1::AsyncReadOperation
+    {
+        assert(chunk_idx < reader.data().chunks.size());
+        HailstormChunk const& chunk = reader.data().chunks[chunk_idx];
+        return AsyncReadOperation{ reader, chunk.offset, chunk.size };
+    }
+
+    auto load_resource(
+        hailstorm::v1::AsyncReader& reader,
+        uint32_t resource_idx
+    ) noexcept -> hailstorm::v1::AsyncReadOperation
+    {
+        assert(resource_idx < reader.data().resources.size());
+        HailstormResource const& res = reader.data().resources[resource_idx];
+        HailstormChunk const& chunk = reader.data().chunks[res.chunk];
+
+        // Resources spanning multiple chunks are stored continuously, so a single read is enough.
+        return AsyncReadOperation{ reader, chunk.offset + res.offset, res.size };
+    }
+
+    auto load_resource_range(
+        hailstorm::v1::AsyncReader& reader,
+        uint32_t resource_idx,
+        uint64_t offset,
+        size_t size
+    ) noexcept -> hailstorm::v1::AsyncReadOperation
+    {
+        assert(resource_idx < reader.data().resources.size());
+        HailstormResource const& res = reader.data().resources[resource_idx];
+        HailstormChunk const& chunk = reader.data().chunks[res.chunk];
+        assert(offset <= res.size && size <= res.size - offset);
+
+        // The range can span multiple chunks, but since data is stored continuously it's still a single read.
+        return AsyncReadOperation{ reader, chunk.offset + res.offset + offset, size };
+    }
+
+} // namespace hailstorm::v1
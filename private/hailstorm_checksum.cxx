@@ -0,0 +1,177 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include "hailstorm_checksum.hxx"
+#include "hailstorm_memutils.hxx"
+#include "hailstorm_jobs.hxx"
+#include <array>
+#include <atomic>
+#include <cstring>
+
+namespace hailstorm::v1
+{
+
+    namespace detail
+    {
+
+        //! \brief Reflected CRC32C polynomial.
+        static constexpr uint32_t Constant_CRC32C_Polynomial = 0x82f6'3b78u;
+
+        //! \brief Lookup tables for the slicing-by-8 algorithm, table 'N' handles the byte 'N' positions before the end of a block.
+        static constexpr auto Constant_CRC32C_Tables = []() noexcept
+        {
+            std::array<std::array<uint32_t, 256>, 8> tables{ };
+            for (uint32_t idx = 0; idx < 256; ++idx)
+            {
+                uint32_t crc = idx;
+                for (uint32_t bit = 0; bit < 8; ++bit)
+                {
+                    crc = (crc >> 1) ^ ((crc & 1) ? Constant_CRC32C_Polynomial : 0);
+                }
+                tables[0][idx] = crc;
+            }
+            for (uint32_t idx = 0; idx < 256; ++idx)
+            {
+                for (uint32_t table = 1; table < 8; ++table)
+                {
+                    uint32_t const previous = tables[table - 1][idx];
+                    tables[table][idx] = (previous >> 8) ^ tables[0][previous & 0xff];
+                }
+            }
+            return tables;
+        }();
+
+        static constexpr uint8_t Constant_ZeroBlock[4 * Constant_1KiB]{ };
+
+        auto crc32c(uint32_t crc, void const* data, size_t size) noexcept -> uint32_t
+        {
+            auto const& tables = Constant_CRC32C_Tables;
+            uint8_t const* bytes = reinterpret_cast<uint8_t const*>(data);
+            crc = ~crc;
+
+            // Process 8 bytes at a time, the 'memcpy' allows unaligned loads.
+            while (size >= 8)
+            {
+                uint32_t low, high;
+                std::memcpy(&low, bytes, 4);
+                std::memcpy(&high, bytes + 4, 4);
+                low ^= crc;
+
+                crc = tables[7][low & 0xff] ^ tables[6][(low >> 8) & 0xff]
+                    ^ tables[5][(low >> 16) & 0xff] ^ tables[4][low >> 24]
+                    ^ tables[3][high & 0xff] ^ tables[2][(high >> 8) & 0xff]
+                    ^ tables[1][(high >> 16) & 0xff] ^ tables[0][high >> 24];
+
+                bytes += 8;
+                size -= 8;
+            }
+
+            while (size > 0)
+            {
+                crc = (crc >> 8) ^ tables[0][(crc ^ *bytes) & 0xff];
+                bytes += 1;
+                size -= 1;
+            }
+            return ~crc;
+        }
+
+        auto crc32c_zeros(uint32_t crc, size_t size) noexcept -> uint32_t
+        {
+            while (size > 0)
+            {
+                size_t const block_size = std::min(size, sizeof(Constant_ZeroBlock));
+                crc = crc32c(crc, Constant_ZeroBlock, block_size);
+                size -= block_size;
+            }
+            return crc;
+        }
+
+    } // namespace detail
+
+    auto chunk_checksum(hailstorm::Data data) noexcept -> uint32_t
+    {
+        return detail::crc32c(0, data.location, data.size);
+    }
+
+    auto verify_chunk(
+        hailstorm::v1::HailstormData const& hailstorm,
+        uint32_t chunk_idx,
+        hailstorm::Data chunk_data
+    ) noexcept -> hailstorm::Result
+    {
+        if (chunk_idx >= hailstorm.chunk_checksums.size()
+            || chunk_idx >= hailstorm.chunks.size()
+            || chunk_data.location == nullptr
+            || chunk_data.size != hailstorm.chunks[chunk_idx].size)
+        {
+            return Result::E_InvalidArgument;
+        }
+
+        return chunk_checksum(chunk_data) == hailstorm.chunk_checksums[chunk_idx] ? Result::Success : Result::E_ChecksumMismatch;
+    }
+
+    auto verify_chunks(
+        hailstorm::v1::HailstormVerifyParams const& params,
+        hailstorm::v1::HailstormData const& hailstorm,
+        hailstorm::Data pack_data
+    ) noexcept -> hailstorm::Result
+    {
+        uint32_t const count_chunks = uint32_t(hailstorm.chunks.size());
+        if (hailstorm.chunk_checksums.size() != count_chunks
+            || (params.out_results.empty() == false && params.out_results.size() < count_chunks))
+        {
+            return Result::E_InvalidArgument;
+        }
+
+        for (HailstormChunk const& chunk : hailstorm.chunks)
+        {
+            if (chunk.offset > pack_data.size || pack_data.size - chunk.offset < chunk.size)
+            {
+                return Result::E_InvalidArgument;
+            }
+        }
+
+        struct JobData
+        {
+            hailstorm::v1::HailstormVerifyParams const& params;
+            hailstorm::v1::HailstormData const& hailstorm;
+            hailstorm::Data pack_data;
+            std::atomic_bool failed;
+        };
+
+        // Each job verifies a single chunk, chunks are already big enough to keep the job system overhead low.
+        auto const fn_job = [](void* job_data, uint32_t job_index) noexcept
+        {
+            JobData& job = *reinterpret_cast<JobData*>(job_data);
+            HailstormChunk const& chunk = job.hailstorm.chunks[job_index];
+
+            hailstorm::Result const result = verify_chunk(
+                job.hailstorm, job_index, { ptr_add(job.pack_data.location, chunk.offset), chunk.size, chunk.align }
+            );
+            if (job.params.out_results.empty() == false)
+            {
+                job.params.out_results[job_index] = result;
+            }
+            if (result != Result::Success)
+            {
+                job.failed.store(true, std::memory_order_relaxed);
+            }
+        };
+
+        JobData job_data{ .params = params, .hailstorm = hailstorm, .pack_data = pack_data, .failed = false };
+        if (params.fn_parallel_for != nullptr)
+        {
+            if (params.fn_parallel_for(count_chunks, fn_job, &job_data, params.parallel_userdata) == false)
+            {
+                return Result::E_InvalidArgument;
+            }
+        }
+        else
+        {
+            parallel_for_builtin(count_chunks, fn_job, &job_data, params.worker_count);
+        }
+
+        return job_data.failed.load(std::memory_order_relaxed) ? Result::E_ChecksumMismatch : Result::Success;
+    }
+
+} // namespace hailstorm::v1
@@ -0,0 +1,14 @@
+#pragma once
+#include <hailstorm/hailstorm_operations.hxx>
+
+namespace hailstorm::v1::detail
+{
+
+    //! \brief Continues a CRC32C (Castagnoli) checksum with the given data.
+    //! \note Start with a value of '0', the initial and final bit inversion is handled internally.
+    auto crc32c(uint32_t crc, void const* data, size_t size) noexcept -> uint32_t;
+
+    //! \brief Continues a CRC32C checksum with the given number of zero bytes.
+    auto crc32c_zeros(uint32_t crc, size_t size) noexcept -> uint32_t;
+
+} // namespace hailstorm::v1::detail
@@ -0,0 +1,409 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include <hailstorm/hailstorm_chunk_cache.hxx>
+#include "hailstorm_memutils.hxx"
+#include "hailstorm_chunk_info.hxx"
+#include "hailstorm_checksum.hxx"
+#include "hailstorm_encryption.hxx"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <new>
+
+namespace hailstorm::v1
+{
+
+    //! \brief The entry state holds the number of references and flags describing the chunk data.
+    static constexpr uint32_t Constant_EntryResident = 1u << 31;
+    static constexpr uint32_t Constant_EntryLoading = 1u << 30;
+    static constexpr uint32_t Constant_EntryRefsMask = Constant_EntryLoading - 1;
+
+    //! \brief Memory allocated for chunk data, with enough space to align the data. This size is accounted in the budget.
+    static auto chunk_allocation_size(hailstorm::v1::HailstormChunk const& chunk) noexcept -> size_t
+    {
+        return chunk.size + std::max<size_t>(chunk.align, 1) - 1;
+    }
+
+    struct ChunkCache::Entry
+    {
+        //! \brief The allocated memory, might be bigger than the chunk to satisfy the alignment requirements.
+        hailstorm::Memory memory{ };
+
+        //! \brief Aligned chunk data location.
+        void* location = nullptr;
+
+        //! \brief References and flags, chunks can be acquired without the lock only if 'Constant_EntryResident' is set.
+        //! \note Only changed from 'Constant_EntryResident' without references to '0', or from '0' to 'Constant_EntryLoading'
+        //!   when holding the lock, so 'memory' and 'location' are never accessed by two threads at once.
+        std::atomic<uint32_t> state{ 0 };
+
+        //! \brief Neighbours in the eviction list of the chunk persistance group, only accessed when holding the lock.
+        uint32_t lru_prev = Constant_HailstormInvalidIndex;
+        uint32_t lru_next = Constant_HailstormInvalidIndex;
+        bool lru_linked = false;
+    };
+
+    struct ChunkCache::Internal
+    {
+        //! \brief Serialises loading and evicting chunks, updating eviction lists and all accesses to the allocator.
+        std::mutex mutex;
+
+        std::atomic<size_t> resident_size{ 0 };
+
+        //! \brief Loaded chunks of each persistance group, ordered from the least to the most recently released one.
+        //! \note Chunks still in use are kept in the lists and skipped when evicting, 'LoadAlways' chunks are never linked.
+        uint32_t lru_head[detail::Constant_PersistanceCount]{
+            Constant_HailstormInvalidIndex, Constant_HailstormInvalidIndex, Constant_HailstormInvalidIndex, Constant_HailstormInvalidIndex
+        };
+        uint32_t lru_tail[detail::Constant_PersistanceCount]{
+            Constant_HailstormInvalidIndex, Constant_HailstormInvalidIndex, Constant_HailstormInvalidIndex, Constant_HailstormInvalidIndex
+        };
+    };
+
+    ChunkCache::ChunkCache(hailstorm::v1::HailstormChunkCacheParams const& params) noexcept
+        : _params{ params }
+        , _entries_memory{ params.alloc.allocate(sizeof(Entry) * params.chunks.size()) }
+        , _entries{ reinterpret_cast<Entry*>(_entries_memory.location) }
+        , _internal{ new (params.alloc.allocate(sizeof(Internal)).location) Internal{ } }
+    {
+        assert(_entries != nullptr || params.chunks.empty());
+        assert(params.chunk_checksums.empty() || params.chunk_checksums.size() == params.chunks.size());
+
+        for (uint32_t idx = 0; idx < _params.chunks.size(); ++idx)
+        {
+            new (_entries + idx) Entry{ };
+        }
+    }
+
+    ChunkCache::~ChunkCache() noexcept
+    {
+        for (uint32_t idx = 0; idx < _params.chunks.size(); ++idx)
+        {
+            // All chunks should be released by now.
+            assert(
+                (_entries[idx].state.load(std::memory_order_relaxed) & Constant_EntryRefsMask) == 0
+                || _params.chunks[idx].persistance == detail::Constant_PersistanceLoadAlways
+            );
+            if (_entries[idx].location != nullptr)
+            {
+                _params.alloc.deallocate(_entries[idx].memory);
+            }
+            _entries[idx].~Entry();
+        }
+
+        if (_entries_memory.location != nullptr)
+        {
+            _params.alloc.deallocate(_entries_memory);
+        }
+
+        _internal->~Internal();
+        _params.alloc.deallocate(_internal);
+    }
+
+    auto ChunkCache::acquire(uint32_t chunk_idx) noexcept -> hailstorm::Data
+    {
+        assert(chunk_idx < _params.chunks.size());
+        Entry& entry = _entries[chunk_idx];
+        HailstormChunk const& chunk = _params.chunks[chunk_idx];
+
+        uint32_t state = entry.state.load(std::memory_order_acquire);
+        for (;;)
+        {
+            // Chunks in memory are acquired by increasing the reference count, without taking the lock.
+            if ((state & Constant_EntryResident) != 0)
+            {
+                if (entry.state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_acquire))
+                {
+                    return { entry.location, chunk.size, chunk.align };
+                }
+                continue;
+            }
+
+            // Another thread is loading the chunk, wait until it finished.
+            if ((state & Constant_EntryLoading) != 0)
+            {
+                entry.state.wait(state, std::memory_order_acquire);
+                state = entry.state.load(std::memory_order_acquire);
+                continue;
+            }
+
+            // The entry is not loaded, only a single thread is allowed to start loading it.
+            {
+                std::lock_guard const lock{ _internal->mutex };
+                if (entry.state.compare_exchange_strong(state, Constant_EntryLoading, std::memory_order_acquire) == false)
+                {
+                    continue;
+                }
+            }
+
+            if (load(chunk_idx) == false)
+            {
+                return { };
+            }
+            return { entry.location, chunk.size, chunk.align };
+        }
+    }
+
+    void ChunkCache::release(uint32_t chunk_idx) noexcept
+    {
+        assert(chunk_idx < _params.chunks.size());
+        Entry& entry = _entries[chunk_idx];
+        assert((entry.state.load(std::memory_order_relaxed) & Constant_EntryRefsMask) > 0);
+
+        uint32_t const state = entry.state.fetch_sub(1, std::memory_order_release) - 1;
+        if (state != Constant_EntryResident)
+        {
+            return;
+        }
+
+        // Temporary chunks are released immediately, unless the chunk was acquired again in the meantime.
+        //   Other chunks become the most recently released chunk of their group, if they where not evicted in the meantime.
+        std::lock_guard const lock{ _internal->mutex };
+        if (_params.chunks[chunk_idx].persistance == detail::Constant_PersistanceTemporary)
+        {
+            evict(chunk_idx);
+        }
+        else if (entry.lru_linked)
+        {
+            unlink_locked(chunk_idx);
+            link_locked(chunk_idx);
+        }
+    }
+
+    bool ChunkCache::preload() noexcept
+    {
+        bool success = true;
+        for (uint32_t idx = 0; idx < _params.chunks.size(); ++idx)
+        {
+            if (_params.chunks[idx].persistance == detail::Constant_PersistanceLoadAlways && is_resident(idx) == false)
+            {
+                // The cache keeps it's own reference of 'LoadAlways' chunks.
+                bool const loaded = acquire(idx).location != nullptr;
+                if (loaded)
+                {
+                    release(idx);
+                }
+                success &= loaded;
+            }
+        }
+        return success;
+    }
+
+    void ChunkCache::trim(size_t target_size) noexcept
+    {
+        std::lock_guard const lock{ _internal->mutex };
+        trim_locked(target_size);
+    }
+
+    bool ChunkCache::is_resident(uint32_t chunk_idx) const noexcept
+    {
+        assert(chunk_idx < _params.chunks.size());
+        return (_entries[chunk_idx].state.load(std::memory_order_acquire) & Constant_EntryResident) != 0;
+    }
+
+    auto ChunkCache::resident_size() const noexcept -> size_t
+    {
+        return _internal->resident_size.load(std::memory_order_relaxed);
+    }
+
+    bool ChunkCache::load(uint32_t chunk_idx) noexcept
+    {
+        Entry& entry = _entries[chunk_idx];
+        HailstormChunk const& chunk = _params.chunks[chunk_idx];
+        assert(entry.location == nullptr);
+        assert(entry.state.load(std::memory_order_relaxed) == Constant_EntryLoading);
+
+        // Allocate with enough space to align the chunk data.
+        size_t const align = std::max<size_t>(chunk.align, 1);
+        size_t const allocation_size = chunk_allocation_size(chunk);
+        {
+            std::lock_guard const lock{ _internal->mutex };
+            if (reserve(allocation_size))
+            {
+                entry.memory = _params.alloc.allocate(allocation_size);
+                if (entry.memory.location == nullptr)
+                {
+                    _internal->resident_size.fetch_sub(allocation_size, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool loaded = entry.memory.location != nullptr;
+        if (loaded)
+        {
+            // Chunk data is loaded without holding the lock, the entry is only accessed by this thread until it's published.
+            entry.location = align_to(entry.memory.location, uint32_t(align));
+            hailstorm::Memory const chunk_memory{ entry.location, chunk.size, align };
+            loaded = _params.fn_load_chunk(chunk_idx, chunk, chunk_memory, _params.userdata);
+
+            // Chunks failing verification are treated the same as chunks that failed to load.
+            if (loaded && _params.chunk_checksums.empty() == false)
+            {
+                loaded = chunk_idx < _params.chunk_checksums.size()
+                    && detail::crc32c(0, chunk_memory.location, chunk.size) == _params.chunk_checksums[chunk_idx];
+            }
+
+            // Checksums are calculated from the encrypted data, so chunks are decrypted only after they were verified.
+            if (loaded && _params.decryption_key != nullptr)
+            {
+                detail::chacha20_xor(*_params.decryption_key, chunk_idx, 0, chunk_memory.location, chunk.size);
+            }
+
+            // Pointers in baked data are restored last, they are only valid for this memory block.
+            if (loaded && _params.relocations != nullptr)
+            {
+                loaded = apply_relocations(*_params.relocations, chunk_idx, chunk_memory) == Result::Success;
+            }
+
+            // Loaded chunks are linked before they are published, evicting them fails until their last reference is released.
+            std::lock_guard const lock{ _internal->mutex };
+            if (loaded == false)
+            {
+                _params.alloc.deallocate(entry.memory);
+                _internal->resident_size.fetch_sub(allocation_size, std::memory_order_relaxed);
+            }
+            else if (chunk.persistance != detail::Constant_PersistanceLoadAlways)
+            {
+                link_locked(chunk_idx);
+            }
+        }
+
+        // The loading thread keeps a reference, 'LoadAlways' chunks keep an additional one so they are never evicted.
+        uint32_t state = 0;
+        if (loaded)
+        {
+            state = Constant_EntryResident + 1 + uint32_t(chunk.persistance == detail::Constant_PersistanceLoadAlways);
+        }
+        else
+        {
+            entry.memory = { };
+            entry.location = nullptr;
+        }
+
+        entry.state.store(state, std::memory_order_release);
+        entry.state.notify_all();
+        return loaded;
+    }
+
+    bool ChunkCache::evict(uint32_t chunk_idx) noexcept
+    {
+        Entry& entry = _entries[chunk_idx];
+
+        // Only chunks without references can be evicted, the chunk might have been acquired again without the lock.
+        uint32_t expected = Constant_EntryResident;
+        if (entry.state.compare_exchange_strong(expected, 0, std::memory_order_acquire) == false)
+        {
+            return false;
+        }
+
+        _params.alloc.deallocate(entry.memory);
+        entry.memory = { };
+        entry.location = nullptr;
+        _internal->resident_size.fetch_sub(chunk_allocation_size(_params.chunks[chunk_idx]), std::memory_order_relaxed);
+        unlink_locked(chunk_idx);
+        return true;
+    }
+
+    bool ChunkCache::reserve(size_t size) noexcept
+    {
+        if (size > _params.memory_budget)
+        {
+            return false;
+        }
+
+        if (_internal->resident_size.load(std::memory_order_relaxed) + size > _params.memory_budget)
+        {
+            trim_locked(_params.memory_budget - size);
+        }
+
+        // The reserved size is accounted immediately, so chunks being loaded are part of the budget.
+        if (_internal->resident_size.load(std::memory_order_relaxed) + size > _params.memory_budget)
+        {
+            return false;
+        }
+        _internal->resident_size.fetch_add(size, std::memory_order_relaxed);
+        return true;
+    }
+
+    void ChunkCache::trim_locked(size_t target_size) noexcept
+    {
+        // Evict from the least important group first. 'LoadAlways' chunks always have a reference.
+        static constexpr uint8_t eviction_order[]{
+            detail::Constant_PersistanceTemporary,
+            detail::Constant_PersistanceRegular,
+            detail::Constant_PersistanceLoadIfPossible,
+        };
+
+        for (uint8_t const persistance : eviction_order)
+        {
+            // Starting with the least recently released chunk, chunks still in use fail to be evicted and are skipped.
+            uint32_t chunk_idx = _internal->lru_head[persistance];
+            while (chunk_idx != Constant_HailstormInvalidIndex)
+            {
+                if (_internal->resident_size.load(std::memory_order_relaxed) <= target_size)
+                {
+                    return;
+                }
+
+                uint32_t const next_idx = _entries[chunk_idx].lru_next;
+                evict(chunk_idx);
+                chunk_idx = next_idx;
+            }
+        }
+    }
+
+    void ChunkCache::link_locked(uint32_t chunk_idx) noexcept
+    {
+        Entry& entry = _entries[chunk_idx];
+        uint8_t const persistance = _params.chunks[chunk_idx].persistance;
+        assert(entry.lru_linked == false && persistance < detail::Constant_PersistanceCount);
+
+        uint32_t& tail = _internal->lru_tail[persistance];
+        entry.lru_prev = tail;
+        entry.lru_next = Constant_HailstormInvalidIndex;
+        entry.lru_linked = true;
+        if (tail != Constant_HailstormInvalidIndex)
+        {
+            _entries[tail].lru_next = chunk_idx;
+        }
+        else
+        {
+            _internal->lru_head[persistance] = chunk_idx;
+        }
+        tail = chunk_idx;
+    }
+
+    void ChunkCache::unlink_locked(uint32_t chunk_idx) noexcept
+    {
+        Entry& entry = _entries[chunk_idx];
+        if (entry.lru_linked == false)
+        {
+            return;
+        }
+
+        uint8_t const persistance = _params.chunks[chunk_idx].persistance;
+        if (entry.lru_prev != Constant_HailstormInvalidIndex)
+        {
+            _entries[entry.lru_prev].lru_next = entry.lru_next;
+        }
+        else
+        {
+            _internal->lru_head[persistance] = entry.lru_next;
+        }
+        if (entry.lru_next != Constant_HailstormInvalidIndex)
+        {
+            _entries[entry.lru_next].lru_prev = entry.lru_prev;
+        }
+        else
+        {
+            _internal->lru_tail[persistance] = entry.lru_prev;
+        }
+
+        entry.lru_prev = Constant_HailstormInvalidIndex;
+        entry.lru_next = Constant_HailstormInvalidIndex;
+        entry.lru_linked = false;
+    }
+
+} // namespace hailstorm::v1
@@ -0,0 +1,29 @@
+#pragma once
+#include <hailstorm/hailstorm.hxx>
+
+namespace hailstorm::v1::detail
+{
+
+    //! \brief Values of the 'HailstormChunk::persistance' field.
+    static constexpr uint8_t Constant_PersistanceTemporary = 0;
+    static constexpr uint8_t Constant_PersistanceRegular = 1;
+    static constexpr uint8_t Constant_PersistanceLoadIfPossible = 2;
+    static constexpr uint8_t Constant_PersistanceLoadAlways = 3;
+    static constexpr uint8_t Constant_PersistanceCount = 4;
+
+    //! \brief Finds all chunks storing the given byte range of resource data.
+    //! \note An empty range results in '0' chunks, with the first chunk being the one the range starts in.
+    //!
+    //! \param [out] out_location The offset of the range relative to the start of the pack.
+    //! \return 'false' if the resource index or range are not valid.
+    bool resource_range_chunks(
+        hailstorm::v1::HailstormData const& hailstorm,
+        uint32_t resource_idx,
+        uint64_t offset,
+        uint64_t size,
+        uint64_t& out_location,
+        uint32_t& out_first_chunk,
+        uint32_t& out_count_chunks
+    ) noexcept;
+
+} // namespace hailstorm::v1::detail
@@ -0,0 +1,81 @@
+#pragma once
+#include <hailstorm/hailstorm_operations.hxx>
+#include <concepts>
+
+namespace hailstorm::v1::detail
+{
+
+    //! \brief Chunk heuristics used when assigning resources to chunks, provided as static members so calls can be inlined.
+    template<typename T>
+    concept IChunkLogic = requires(
+        hailstorm::v1::HailstormWriteParams const& params,
+        hailstorm::Data data,
+        std::span<hailstorm::v1::HailstormChunk const> chunks,
+        hailstorm::v1::HailstormChunk const& base_chunk
+    ) {
+        { T::select_chunk(params, data, data, chunks, uint32_t{}, uint32_t{}) } -> std::convertible_to<hailstorm::v1::HailstormWriteChunkRef>;
+        { T::create_chunk(params, data, data, base_chunk) } -> std::convertible_to<hailstorm::v1::HailstormChunk>;
+    };
+
+    //! \brief Calls the heuristics provided in the write params.
+    struct CallbackChunkLogic
+    {
+        static auto select_chunk(
+            hailstorm::v1::HailstormWriteParams const& params,
+            hailstorm::Data meta,
+            hailstorm::Data data,
+            std::span<hailstorm::v1::HailstormChunk const> chunks,
+            uint32_t partial_chunk_start,
+            uint32_t partial_chunk_count
+        ) noexcept -> hailstorm::v1::HailstormWriteChunkRef
+        {
+            return params.fn_select_chunk(meta, data, chunks, partial_chunk_start, partial_chunk_count, params.userdata);
+        }
+
+        static auto create_chunk(
+            hailstorm::v1::HailstormWriteParams const& params,
+            hailstorm::Data meta,
+            hailstorm::Data data,
+            hailstorm::v1::HailstormChunk const& base_chunk
+        ) noexcept -> hailstorm::v1::HailstormChunk
+        {
+            return params.fn_create_chunk(meta, data, base_chunk, params.userdata);
+        }
+    };
+
+    //! \brief Calls the default heuristics directly, used if the write params reference them.
+    struct DefaultChunkLogic
+    {
+        static auto select_chunk(
+            hailstorm::v1::HailstormWriteParams const& /*params*/,
+            hailstorm::Data meta,
+            hailstorm::Data data,
+            std::span<hailstorm::v1::HailstormChunk const> chunks,
+            uint32_t partial_chunk_start,
+            uint32_t partial_chunk_count
+        ) noexcept -> hailstorm::v1::HailstormWriteChunkRef
+        {
+            return default_chunk_select_logic(meta, data, chunks, partial_chunk_start, partial_chunk_count, nullptr);
+        }
+
+        static auto create_chunk(
+            hailstorm::v1::HailstormWriteParams const& /*params*/,
+            hailstorm::Data meta,
+            hailstorm::Data data,
+            hailstorm::v1::HailstormChunk const& base_chunk
+        ) noexcept -> hailstorm::v1::HailstormChunk
+        {
+            return default_chunk_create_logic(meta, data, base_chunk, nullptr);
+        }
+    };
+
+    static_assert(IChunkLogic<CallbackChunkLogic>);
+    static_assert(IChunkLogic<DefaultChunkLogic>);
+
+    //! \return 'true' if the write params use both default chunk heuristics.
+    inline bool uses_default_chunk_logic(hailstorm::v1::HailstormWriteParams const& params) noexcept
+    {
+        return params.fn_select_chunk == default_chunk_select_logic && params.fn_create_chunk == default_chunk_create_logic;
+    }
+
+} // namespace hailstorm::v1::detail
@@ -0,0 +1,423 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include "hailstorm_chunk_planner.hxx"
+#include "hailstorm_deduplication.hxx"
+#include "hailstorm_chunk_logic.hxx"
+#include "hailstorm_memutils.hxx"
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace hailstorm::v1::detail
+{
+
+    static constexpr size_t Constant_PlannerMinAlign = 8;
+    static constexpr uint32_t Constant_PlannerU32Max = std::numeric_limits<uint32_t>::max();
+    static constexpr uint8_t Constant_PlannerU8Max = std::numeric_limits<uint8_t>::max();
+
+    namespace
+    {
+
+        struct PlannedResource
+        {
+            //! \brief Space required in a chunk, including metadata unless it's shared.
+            uint64_t size;
+
+            //! \brief Size of a chunk created for this resource.
+            uint64_t chunk_size;
+
+            uint32_t index;
+            uint32_t chunk_class;
+        };
+
+        bool same_chunk_class(HailstormChunk const& left, HailstormChunk const& right) noexcept
+        {
+            return left.align == right.align
+                && left.type == right.type
+                && left.persistance == right.persistance
+                && left.flags == right.flags
+                && left.app_custom_value == right.app_custom_value;
+        }
+
+        auto find_chunk_class(
+            hailstorm::Array<HailstormChunk>& classes,
+            HailstormChunk const& chunk,
+            uint32_t last_class
+        ) noexcept -> uint32_t
+        {
+            // Resources of the same class often come one after another.
+            if (last_class < classes.count() && same_chunk_class(classes[last_class], chunk))
+            {
+                return last_class;
+            }
+
+            for (uint32_t idx = 0; idx < classes.count(); ++idx)
+            {
+                if (same_chunk_class(classes[idx], chunk))
+                {
+                    return idx;
+                }
+            }
+
+            classes.push_back(chunk);
+            return classes.count() - 1;
+        }
+
+    } // namespace
+
+    FreeSpaceTree::FreeSpaceTree(hailstorm::Allocator& alloc) noexcept
+        : _nodes{ alloc }
+        , _chunks{ alloc }
+        , _capacity{ 0 }
+    {
+    }
+
+    void FreeSpaceTree::clear() noexcept
+    {
+        _nodes.memset(0);
+        _chunks.resize(0);
+    }
+
+    auto FreeSpaceTree::push(uint32_t chunk_idx, uint64_t free_space) noexcept -> uint32_t
+    {
+        if (_chunks.count() == _capacity)
+        {
+            grow();
+        }
+
+        uint32_t const slot = _chunks.count();
+        _chunks.push_back(chunk_idx);
+        update(slot, free_space);
+        return slot;
+    }
+
+    void FreeSpaceTree::update(uint32_t slot, uint64_t free_space) noexcept
+    {
+        uint32_t node = _capacity + slot;
+        _nodes[node] = free_space;
+        while (node > 1)
+        {
+            node /= 2;
+            _nodes[node] = std::max(_nodes[node * 2], _nodes[node * 2 + 1]);
+        }
+    }
+
+    auto FreeSpaceTree::find_first(uint64_t size) const noexcept -> uint32_t
+    {
+        // Unused leaves have no free space, but still fit requests for '0' bytes.
+        if (_chunks.empty() || _nodes[1] < size)
+        {
+            return Constant_InvalidSlot;
+        }
+
+        // Always descend into the left-most child with enough space.
+        uint32_t node = 1;
+        while (node < _capacity)
+        {
+            node = _nodes[node * 2] >= size ? node * 2 : node * 2 + 1;
+        }
+
+        uint32_t const slot = node - _capacity;
+        return slot < _chunks.count() ? slot : Constant_InvalidSlot;
+    }
+
+    void FreeSpaceTree::grow() noexcept
+    {
+        uint32_t const old_capacity = _capacity;
+        _capacity = std::max(_capacity * 2, 16u);
+
+        // Move the leaves to their new location, starting from the last one since they only move further back.
+        _nodes.resize(_capacity * 2);
+        for (uint32_t slot = old_capacity; slot > 0; --slot)
+        {
+            _nodes[_capacity + slot - 1] = _nodes[old_capacity + slot - 1];
+        }
+        for (uint32_t slot = old_capacity; slot < _capacity; ++slot)
+        {
+            _nodes[_capacity + slot] = 0;
+        }
+
+        // Rebuild all parent nodes.
+        for (uint32_t node = _capacity - 1; node > 0; --node)
+        {
+            _nodes[node] = std::max(_nodes[node * 2], _nodes[node * 2 + 1]);
+        }
+    }
+
+    template<IChunkLogic ChunkLogic>
+    bool plan_cluster_chunks_internal(
+        hailstorm::v1::HailstormWriteParams const& params,
+        hailstorm::v1::HailstormWriteData const& write_data,
+        hailstorm::Allocator& temp_alloc,
+        hailstorm::Array<hailstorm::v1::HailstormChunk>& chunks,
+        hailstorm::Array<hailstorm::v1::HailstormWriteChunkRef>& refs,
+        hailstorm::Array<size_t>& sizes,
+        hailstorm::Array<uint32_t>& metatracker,
+        hailstorm::v1::HailstormPaths& paths_info,
+        hailstorm::v1::HailstormWriteStats& stats
+    ) noexcept
+    {
+        bool requires_data_writer_callback = false;
+        uint32_t const res_count = uint32_t(write_data.paths.size());
+
+        // Get the chunk class of each resource.
+        hailstorm::Array<HailstormChunk> classes{ temp_alloc };
+        hailstorm::Array<PlannedResource> planned{ temp_alloc };
+        planned.resize(res_count);
+
+        uint32_t last_class = Constant_PlannerU32Max;
+        for (uint32_t idx = 0; idx < res_count; ++idx)
+        {
+            uint32_t const metadata_idx = metatracker.any() ? write_data.metadata_mapping[idx] : idx;
+            Data const meta = write_data.metadata[metadata_idx];
+            Data const data = write_data.data[idx];
+            bool const shared_data = is_deduplicated(write_data, idx);
+
+            // Check if even one data object is not provided.
+            requires_data_writer_callback |= data.location == nullptr && shared_data == false;
+
+            HailstormChunk chunk = ChunkLogic::create_chunk(params, meta, data, HailstormChunk{ });
+
+            // The planner only handles mixed chunks, resources are never split between chunks.
+            assert(chunk.type == 3 && chunk.flags == 0);
+
+            // Force the alignment value and realign the chunk size if necessary.
+            if (params.pack_slice_alignment > 0)
+            {
+                chunk.align = params.pack_slice_alignment;
+                chunk.size = align_to(chunk.size, params.pack_slice_alignment);
+            }
+
+            last_class = find_chunk_class(classes, chunk, last_class);
+            planned[idx] = PlannedResource{
+                .size = align_to(meta.size, Constant_PlannerMinAlign) + (shared_data ? 0 : data.size),
+                .chunk_size = chunk.size,
+                .index = idx,
+                .chunk_class = last_class
+            };
+
+            // Calculate total size needed for all paths to be stored
+            paths_info.size += size_t{ write_data.paths[idx].size() + 1 };
+        }
+
+        // Bigger resources are placed first (first-fit decreasing), the index keeps the result stable.
+        std::sort(planned.begin(), planned.end(), [](PlannedResource const& left, PlannedResource const& right) noexcept
+            {
+                if (left.chunk_class != right.chunk_class)
+                {
+                    return left.chunk_class < right.chunk_class;
+                }
+                if (left.size != right.size)
+                {
+                    return left.size > right.size;
+                }
+                return left.index < right.index;
+            }
+        );
+
+        FreeSpaceTree tree{ temp_alloc };
+        uint32_t current_class = Constant_PlannerU32Max;
+        for (PlannedResource const& resource : planned)
+        {
+            // Only chunks of the current class are available, the tree is rebuilt once for each class.
+            if (resource.chunk_class != current_class)
+            {
+                current_class = resource.chunk_class;
+                tree.clear();
+
+                for (uint32_t chunk_idx = 0; chunk_idx < chunks.count(); ++chunk_idx)
+                {
+                    HailstormChunk const& chunk = chunks[chunk_idx];
+                    if (same_chunk_class(chunk, classes[current_class]))
+                    {
+                        tree.push(chunk_idx, chunk.size - std::min<size_t>(chunk.size, sizes[chunk_idx]));
+                    }
+                }
+            }
+
+            uint32_t const idx = resource.index;
+            uint32_t const metadata_idx = metatracker.any() ? write_data.metadata_mapping[idx] : idx;
+            Data const meta = write_data.metadata[metadata_idx];
+            Data const data = write_data.data[idx];
+
+            // If the metadata is shared and was already placed, it does not require additional space.
+            bool const shared_metadata = metatracker.any() && metatracker[metadata_idx] != Constant_PlannerU32Max;
+            size_t const meta_size = shared_metadata ? 0 : align_to(meta.size, Constant_PlannerMinAlign);
+
+            // Same for deduplicated data, the data chunk is assigned once all resources are placed.
+            bool const shared_data = is_deduplicated(write_data, idx);
+            size_t const data_size = shared_data ? 0 : data.size;
+            size_t const required_size = meta_size + data_size;
+
+            if (shared_data && shared_metadata)
+            {
+                refs[idx] = HailstormWriteChunkRef{
+                    .data_chunk = Constant_PlannerU32Max,
+                    .meta_chunk = refs[metatracker[metadata_idx]].meta_chunk
+                };
+                continue;
+            }
+
+            uint32_t slot = tree.find_first(required_size);
+            if (slot == FreeSpaceTree::Constant_InvalidSlot)
+            {
+                HailstormChunk new_chunk = classes[current_class];
+                new_chunk.offset = 0;
+                new_chunk.count_entries = 0;
+                new_chunk.size = std::max<uint64_t>(resource.chunk_size, align_to(required_size, new_chunk.align));
+
+                chunks.push_back(new_chunk);
+                sizes.push_back(0);
+                stats.count_created_chunks += 1;
+
+                slot = tree.push(chunks.count() - 1, new_chunk.size);
+            }
+
+            uint32_t const chunk_idx = tree.chunk(slot);
+            HailstormChunk& chunk = chunks[chunk_idx];
+
+            // Entries are placed the same way as when writing, metadata first and both at their minimal alignment.
+            sizes[chunk_idx] += meta_size + align_to(data_size, Constant_PlannerMinAlign);
+            tree.update(slot, chunk.size - std::min<size_t>(chunk.size, sizes[chunk_idx]));
+            chunk.count_entries += 1;
+
+            refs[idx] = HailstormWriteChunkRef{
+                .data_chunk = chunk_idx,
+                .meta_chunk = shared_metadata ? refs[metatracker[metadata_idx]].meta_chunk : chunk_idx
+            };
+
+            // Metadata is stored with the first placed resource using it, other resources reference that location.
+            if (metatracker.any() && shared_metadata == false)
+            {
+                metatracker[metadata_idx] = idx;
+            }
+        }
+
+        // Resources are placed in size order, so data chunks of deduplicated resources are only known at the end.
+        for (uint32_t idx = 0; idx < res_count; ++idx)
+        {
+            if (is_deduplicated(write_data, idx))
+            {
+                refs[idx].data_chunk = refs[write_data.data_mapping[idx]].data_chunk;
+            }
+        }
+
+        return requires_data_writer_callback;
+    }
+
+    bool plan_cluster_chunks(
+        hailstorm::v1::HailstormWriteParams const& params,
+        hailstorm::v1::HailstormWriteData const& write_data,
+        hailstorm::Allocator& temp_alloc,
+        hailstorm::Array<hailstorm::v1::HailstormChunk>& chunks,
+        hailstorm::Array<hailstorm::v1::HailstormWriteChunkRef>& refs,
+        hailstorm::Array<size_t>& sizes,
+        hailstorm::Array<uint32_t>& metatracker,
+        hailstorm::v1::HailstormPaths& paths_info,
+        hailstorm::v1::HailstormWriteStats& stats
+    ) noexcept
+    {
+        if (uses_default_chunk_logic(params))
+        {
+            return plan_cluster_chunks_internal<DefaultChunkLogic>(
+                params, write_data, temp_alloc, chunks, refs, sizes, metatracker, paths_info, stats
+            );
+        }
+        return plan_cluster_chunks_internal<CallbackChunkLogic>(
+            params, write_data, temp_alloc, chunks, refs, sizes, metatracker, paths_info, stats
+        );
+    }
+
+    void resource_access_order(
+        hailstorm::v1::HailstormWriteData const& write_data,
+        hailstorm::Allocator& temp_alloc,
+        hailstorm::Array<uint32_t>& out_order
+    ) noexcept
+    {
+        uint32_t const res_count = uint32_t(write_data.paths.size());
+
+        // Resources are marked once added, so each index is only listed once.
+        hailstorm::Array<uint8_t> added{ temp_alloc };
+        added.resize(res_count);
+        added.memset(0);
+
+        out_order.reserve(res_count);
+        out_order.resize(0);
+        for (uint32_t const idx : write_data.access_order)
+        {
+            if (idx < res_count && std::exchange(added[idx], uint8_t{ 1 }) == 0)
+            {
+                out_order.push_back(idx);
+            }
+        }
+        for (uint32_t idx = 0; idx < res_count; ++idx)
+        {
+            if (added[idx] == 0)
+            {
+                out_order.push_back(idx);
+            }
+        }
+    }
+
+    void order_chunks_by_access(
+        std::span<uint32_t const> order,
+        hailstorm::Allocator& temp_alloc,
+        hailstorm::Array<hailstorm::v1::HailstormChunk>& chunks,
+        hailstorm::Array<hailstorm::v1::HailstormWriteChunkRef>& refs,
+        hailstorm::Array<size_t>& sizes
+    ) noexcept
+    {
+        uint32_t const chunk_count = chunks.count();
+
+        // Each chunk is ranked by the first resource stored in it, custom chunks are always written first.
+        hailstorm::Array<uint32_t> ranks{ temp_alloc };
+        ranks.resize(chunk_count);
+        ranks.memset(Constant_PlannerU8Max);
+        for (uint32_t chunk_idx = 0; chunk_idx < chunk_count; ++chunk_idx)
+        {
+            if (chunks[chunk_idx].type == 0)
+            {
+                ranks[chunk_idx] = 0;
+            }
+        }
+        for (uint32_t pos = 0; pos < order.size(); ++pos)
+        {
+            HailstormWriteChunkRef const& ref = refs[order[pos]];
+            ranks[ref.data_chunk] = std::min(ranks[ref.data_chunk], pos + 1);
+            ranks[ref.meta_chunk] = std::min(ranks[ref.meta_chunk], pos + 1);
+        }
+
+        hailstorm::Array<uint32_t> sorted{ temp_alloc };
+        sorted.resize(chunk_count);
+        for (uint32_t chunk_idx = 0; chunk_idx < chunk_count; ++chunk_idx)
+        {
+            sorted[chunk_idx] = chunk_idx;
+        }
+        std::stable_sort(sorted.begin(), sorted.end(), [&ranks](uint32_t left, uint32_t right) noexcept
+            {
+                return ranks[left] < ranks[right];
+            }
+        );
+
+        // Move chunks and their sizes, and keep the new location of each chunk to update resource references.
+        hailstorm::Array<HailstormChunk> old_chunks{ temp_alloc };
+        hailstorm::Array<size_t> old_sizes{ temp_alloc };
+        old_chunks.push_back(std::span<HailstormChunk const>{ chunks.begin(), chunks.end() });
+        old_sizes.push_back(std::span<size_t const>{ sizes.begin(), sizes.end() });
+        for (uint32_t new_idx = 0; new_idx < chunk_count; ++new_idx)
+        {
+            uint32_t const old_idx = sorted[new_idx];
+            chunks[new_idx] = old_chunks[old_idx];
+            sizes[new_idx] = old_sizes[old_idx];
+            ranks[old_idx] = new_idx;
+        }
+
+        for (HailstormWriteChunkRef& ref : refs)
+        {
+            ref.data_chunk = ranks[ref.data_chunk];
+            ref.meta_chunk = ranks[ref.meta_chunk];
+        }
+    }
+
+} // namespace hailstorm::v1::detail
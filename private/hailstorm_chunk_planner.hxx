@@ -0,0 +1,75 @@
+#pragma once
+#include <hailstorm/hailstorm_operations.hxx>
+#include "hailstorm_array.hxx"
+
+namespace hailstorm::v1::detail
+{
+
+    //! \brief Max segment tree over the free space of chunks, allows to find the first chunk with enough space in O(log C).
+    class FreeSpaceTree final
+    {
+    public:
+        static constexpr uint32_t Constant_InvalidSlot = std::numeric_limits<uint32_t>::max();
+
+        explicit FreeSpaceTree(hailstorm::Allocator& alloc) noexcept;
+
+        //! \brief Removes all chunks from the tree.
+        void clear() noexcept;
+
+        //! \brief Adds a new chunk to the tree.
+        //! \return The slot assigned to the chunk.
+        auto push(uint32_t chunk_idx, uint64_t free_space) noexcept -> uint32_t;
+
+        //! \brief Updates the free space of the chunk in the given slot.
+        void update(uint32_t slot, uint64_t free_space) noexcept;
+
+        //! \return The slot of the first added chunk with at least 'size' bytes of free space or 'Constant_InvalidSlot'.
+        auto find_first(uint64_t size) const noexcept -> uint32_t;
+
+        //! \return The chunk index stored in the given slot.
+        auto chunk(uint32_t slot) const noexcept -> uint32_t { return _chunks[slot]; }
+
+    private:
+        void grow() noexcept;
+
+    private:
+        //! \brief Tree nodes, with the root at index '1' and leaves starting at index '_capacity'.
+        hailstorm::Array<uint64_t> _nodes;
+        hailstorm::Array<uint32_t> _chunks;
+        uint32_t _capacity;
+    };
+
+    //! \brief Assigns resources to chunks by sorting them by chunk class and size, and selecting the first chunk with enough space.
+    //! \note Follows the same contract as 'estimate_cluster_chunks', \see HailstormChunkPlanner::BinPacking.
+    //! \return 'true' if at least one resource requires the data writer callback.
+    bool plan_cluster_chunks(
+        hailstorm::v1::HailstormWriteParams const& params,
+        hailstorm::v1::HailstormWriteData const& write_data,
+        hailstorm::Allocator& temp_alloc,
+        hailstorm::Array<hailstorm::v1::HailstormChunk>& chunks,
+        hailstorm::Array<hailstorm::v1::HailstormWriteChunkRef>& refs,
+        hailstorm::Array<size_t>& sizes,
+        hailstorm::Array<uint32_t>& metatracker,
+        hailstorm::v1::HailstormPaths& paths_info,
+        hailstorm::v1::HailstormWriteStats& stats
+    ) noexcept;
+
+    //! \brief Creates the order resources are assigned and written in, resources from 'access_order' followed by all others.
+    //! \see HailstormWriteData::access_order
+    void resource_access_order(
+        hailstorm::v1::HailstormWriteData const& write_data,
+        hailstorm::Allocator& temp_alloc,
+        hailstorm::Array<uint32_t>& out_order
+    ) noexcept;
+
+    //! \brief Reorders chunks so they are placed in the order of their first resource in 'order', and updates all references.
+    //! \note Custom chunks keep their place in front of all other chunks, chunks without resources are moved to the end.
+    void order_chunks_by_access(
+        std::span<uint32_t const> order,
+        hailstorm::Allocator& temp_alloc,
+        hailstorm::Array<hailstorm::v1::HailstormChunk>& chunks,
+        hailstorm::Array<hailstorm::v1::HailstormWriteChunkRef>& refs,
+        hailstorm::Array<size_t>& sizes
+    ) noexcept;
+
+} // namespace hailstorm::v1::detail
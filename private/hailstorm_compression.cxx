@@ -0,0 +1,281 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include "hailstorm_compression.hxx"
+#include "hailstorm_deduplication.hxx"
+#include "hailstorm_relocations.hxx"
+#include "hailstorm_memutils.hxx"
+#include "hailstorm_jobs.hxx"
+#include <cassert>
+#include <cstring>
+
+#if HAILSTORM_COMPRESSION_ZLIB
+#include <zlib.h>
+#endif
+
+#if HAILSTORM_COMPRESSION_ZSTD
+#include <zstd.h>
+#endif
+
+namespace hailstorm::v1
+{
+
+    namespace detail
+    {
+
+        static constexpr uint8_t Constant_CompressionLevelMax = 7;
+
+        auto compression_bound(uint8_t compression_type, size_t size) noexcept -> size_t
+        {
+            switch (compression_type)
+            {
+#if HAILSTORM_COMPRESSION_ZLIB
+            case Constant_CompressionZLib: return compressBound(uLong(size));
+#endif
+#if HAILSTORM_COMPRESSION_ZSTD
+            case Constant_CompressionZstd: return ZSTD_compressBound(size);
+#endif
+            default: return 0;
+            }
+        }
+
+        //! \return The compressed size or '0' if compression failed.
+        auto compress(uint8_t compression_type, uint8_t compression_level, hailstorm::Data data, hailstorm::Memory out_memory) noexcept -> size_t
+        {
+            switch (compression_type)
+            {
+#if HAILSTORM_COMPRESSION_ZLIB
+            case Constant_CompressionZLib:
+            {
+                // Maps [1, 7] onto [1, 9]
+                int const level = compression_level == 0 ? Z_DEFAULT_COMPRESSION : 1 + ((compression_level - 1) * 8) / 6;
+
+                uLongf compressed_size = uLongf(out_memory.size);
+                int const result = compress2(
+                    reinterpret_cast<Bytef*>(out_memory.location),
+                    &compressed_size,
+                    reinterpret_cast<Bytef const*>(data.location),
+                    uLong(data.size),
+                    level
+                );
+                return result == Z_OK ? size_t(compressed_size) : 0;
+            }
+#endif
+#if HAILSTORM_COMPRESSION_ZSTD
+            case Constant_CompressionZstd:
+            {
+                // Maps [1, 7] onto [3, 21]
+                int const level = compression_level == 0 ? ZSTD_CLEVEL_DEFAULT : compression_level * 3;
+
+                size_t const result = ZSTD_compress(out_memory.location, out_memory.size, data.location, data.size, level);
+                return ZSTD_isError(result) ? 0 : result;
+            }
+#endif
+            default: return 0;
+            }
+        }
+
+        CompressedResources::CompressedResources(hailstorm::Allocator& alloc) noexcept
+            : allocator{ alloc }
+            , memory{ }
+            , data{ alloc }
+            , info{ alloc }
+            , write_data{ }
+        {
+        }
+
+        CompressedResources::~CompressedResources() noexcept
+        {
+            if (memory.location != nullptr)
+            {
+                allocator.deallocate(memory);
+            }
+        }
+
+        bool compress_resources(
+            hailstorm::v1::HailstormWriteParams const& params,
+            hailstorm::v1::HailstormParallelWriteParams const* parallel_params,
+            hailstorm::v1::HailstormWriteData const& write_data,
+            hailstorm::v1::detail::CompressedResources& out_compressed
+        ) noexcept
+        {
+            out_compressed.write_data = write_data;
+            if (params.compression_type == Constant_CompressionNone)
+            {
+                return true;
+            }
+
+            if (is_compression_supported(params.compression_type) == false)
+            {
+                return false;
+            }
+
+            uint32_t const res_count = uint32_t(write_data.data.size());
+            out_compressed.data.resize(res_count);
+            out_compressed.info.resize(res_count);
+
+            // Reserve space for the worst case of each resource in a single allocation.
+            //   This way we don't require the allocator to be thread-safe when compressing in parallel.
+            Array<size_t> offsets{ out_compressed.allocator };
+            offsets.resize(res_count);
+
+            size_t total_size = 0;
+            for (uint32_t idx = 0; idx < res_count; ++idx)
+            {
+                hailstorm::Data const data = write_data.data[idx];
+                out_compressed.data[idx] = data;
+                out_compressed.info[idx] = { .compression_type = 0, .compression_level = 0, .compression_param = 0, .origin_size = uint32_t(data.size) };
+
+                // Resources written by the user callback are not compressed, deduplicated resources reuse the result.
+                //   Resources with relocations are kept uncompressed, so they can be used directly from loaded chunks.
+                if (data.location != nullptr && data.size > 0 && is_deduplicated(write_data, idx) == false
+                    && has_relocations(write_data, idx) == false)
+                {
+                    offsets[idx] = total_size = align_to(total_size, 8);
+                    total_size += compression_bound(params.compression_type, data.size);
+                }
+            }
+
+            out_compressed.memory = out_compressed.allocator.allocate(total_size);
+            if (out_compressed.memory.location == nullptr && total_size > 0)
+            {
+                return false;
+            }
+
+            struct JobData
+            {
+                hailstorm::v1::HailstormWriteData const& write_data;
+                hailstorm::v1::detail::CompressedResources& compressed;
+                hailstorm::Array<size_t> const& offsets;
+                uint8_t compression_type;
+                uint8_t compression_level;
+                uint32_t resources_per_job;
+            };
+
+            auto const fn_job = [](void* job_data, uint32_t job_index) noexcept
+            {
+                JobData& job = *reinterpret_cast<JobData*>(job_data);
+                uint32_t const first = job_index * job.resources_per_job;
+                uint32_t const last = std::min<uint32_t>(first + job.resources_per_job, uint32_t(job.write_data.data.size()));
+                for (uint32_t idx = first; idx < last; ++idx)
+                {
+                    hailstorm::Data const data = job.write_data.data[idx];
+                    if (data.location == nullptr || data.size == 0 || is_deduplicated(job.write_data, idx)
+                        || has_relocations(job.write_data, idx))
+                    {
+                        continue;
+                    }
+
+                    hailstorm::Memory const target{
+                        ptr_add(job.compressed.memory.location, job.offsets[idx]),
+                        compression_bound(job.compression_type, data.size),
+                        8
+                    };
+
+                    // Keep the original data if compression failed or did not reduce the size.
+                    size_t const compressed_size = compress(job.compression_type, job.compression_level, data, target);
+                    if (compressed_size > 0 && compressed_size < data.size)
+                    {
+                        job.compressed.data[idx] = { target.location, compressed_size, 8 };
+                        job.compressed.info[idx].compression_type = job.compression_type;
+                        job.compressed.info[idx].compression_level = job.compression_level;
+                    }
+                }
+            };
+
+            JobData job_data{
+                .write_data = write_data,
+                .compressed = out_compressed,
+                .offsets = offsets,
+                .compression_type = params.compression_type,
+                .compression_level = std::min(params.compression_level, Constant_CompressionLevelMax),
+                .resources_per_job = parallel_params != nullptr ? std::max(parallel_params->resources_per_job, 1u) : res_count
+            };
+
+            if (parallel_params != nullptr)
+            {
+                uint32_t const job_count = (res_count + job_data.resources_per_job - 1) / job_data.resources_per_job;
+                if (parallel_for(*parallel_params, job_count, fn_job, &job_data) == false)
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                fn_job(&job_data, 0);
+            }
+
+            // Mapped resources always have a smaller index, so they are already final.
+            for (uint32_t idx = 0; idx < res_count; ++idx)
+            {
+                if (is_deduplicated(write_data, idx))
+                {
+                    out_compressed.data[idx] = out_compressed.data[write_data.data_mapping[idx]];
+                    out_compressed.info[idx] = out_compressed.info[write_data.data_mapping[idx]];
+                }
+            }
+
+            out_compressed.write_data.data = std::span{ out_compressed.data.begin(), res_count };
+            return true;
+        }
+
+    } // namespace detail
+
+    bool is_compression_supported(uint8_t compression_type) noexcept
+    {
+        switch (compression_type)
+        {
+        case detail::Constant_CompressionNone: return true;
+#if HAILSTORM_COMPRESSION_ZLIB
+        case detail::Constant_CompressionZLib: return true;
+#endif
+#if HAILSTORM_COMPRESSION_ZSTD
+        case detail::Constant_CompressionZstd: return true;
+#endif
+        default: return false;
+        }
+    }
+
+    auto decompress_resource(
+        hailstorm::v1::HailstormResource const& resource,
+        hailstorm::Data resource_data,
+        hailstorm::Memory out_memory
+    ) noexcept -> hailstorm::Result
+    {
+        if (resource_data.size < resource.size || out_memory.size < resource.size_origin)
+        {
+            return Result::E_InvalidArgument;
+        }
+
+        switch (resource.compression_type)
+        {
+        case detail::Constant_CompressionNone:
+        {
+            std::memcpy(out_memory.location, resource_data.location, resource.size);
+            return Result::Success;
+        }
+#if HAILSTORM_COMPRESSION_ZLIB
+        case detail::Constant_CompressionZLib:
+        {
+            uLongf decompressed_size = uLongf(resource.size_origin);
+            int const result = uncompress(
+                reinterpret_cast<Bytef*>(out_memory.location),
+                &decompressed_size,
+                reinterpret_cast<Bytef const*>(resource_data.location),
+                uLong(resource.size)
+            );
+            return (result == Z_OK && decompressed_size == resource.size_origin) ? Result::Success : Result::E_DecompressionFailed;
+        }
+#endif
+#if HAILSTORM_COMPRESSION_ZSTD
+        case detail::Constant_CompressionZstd:
+        {
+            size_t const result = ZSTD_decompress(out_memory.location, resource.size_origin, resource_data.location, resource.size);
+            return (ZSTD_isError(result) == 0 && result == resource.size_origin) ? Result::Success : Result::E_DecompressionFailed;
+        }
+#endif
+        default: return Result::E_UnsupportedCompression;
+        }
+    }
+
+} // namespace hailstorm::v1
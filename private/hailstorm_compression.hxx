@@ -0,0 +1,42 @@
+#pragma once
+#include <hailstorm/hailstorm_operations.hxx>
+#include "hailstorm_array.hxx"
+
+namespace hailstorm::v1::detail
+{
+
+    static constexpr uint8_t Constant_CompressionNone = 0;
+    static constexpr uint8_t Constant_CompressionZLib = 1;
+    static constexpr uint8_t Constant_CompressionZstd = 2;
+
+    //! \brief Holds resource data compressed by the builtin compression stage.
+    //! \note All compressed resources are stored in a single allocation, which is released with the object.
+    struct CompressedResources final
+    {
+        explicit CompressedResources(hailstorm::Allocator& alloc) noexcept;
+        ~CompressedResources() noexcept;
+
+        hailstorm::Allocator& allocator;
+        hailstorm::Memory memory;
+
+        //! \brief Data views for all resources, each pointing either to compressed or to the original data.
+        hailstorm::Array<hailstorm::Data> data;
+
+        //! \brief Compression details for each resource, 'compression_type' is '0' if the resource was not compressed.
+        hailstorm::Array<hailstorm::v1::HailstormWriteCompressionInfo> info;
+
+        //! \brief Copy of the original write data, with the 'data' list replaced if any resource was compressed.
+        hailstorm::v1::HailstormWriteData write_data;
+    };
+
+    //! \brief Compresses all resources with data available based on the compression settings in the write params.
+    //! \note If 'parallel_params' are provided resources are compressed using multiple threads.
+    //! \return 'false' if the requested compression type is not supported.
+    bool compress_resources(
+        hailstorm::v1::HailstormWriteParams const& params,
+        hailstorm::v1::HailstormParallelWriteParams const* parallel_params,
+        hailstorm::v1::HailstormWriteData const& write_data,
+        hailstorm::v1::detail::CompressedResources& out_compressed
+    ) noexcept;
+
+} // namespace hailstorm::v1::detail
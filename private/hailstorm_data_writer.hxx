@@ -1,37 +1,290 @@
 #pragma once
 #include "hailstorm_memutils.hxx"
+#include "hailstorm_jobs.hxx"
+#include "hailstorm_staging_ring.hxx"
+#include "hailstorm_array.hxx"
+#include "hailstorm_checksum.hxx"
+#include "hailstorm_deduplication.hxx"
+#include "hailstorm_encryption.hxx"
 #include <hailstorm/hailstorm_operations.hxx>
+#include <atomic>
+#include <condition_variable>
 #include <coroutine>
 #include <cassert>
 #include <cstring>
+#include <mutex>
+#include <utility>
+
+namespace hailstorm::v1
+{
+
+    //! \brief Tracks all pending writes of an asynchronous write operation.
+    //! \note The write coroutine is always resumed by the thread driving the write, never from completion callbacks.
+    struct HailstormAsyncWriteCompletion
+    {
+        using IssueFn = auto(void* stage) noexcept -> hailstorm::v1::HailstormAsyncWriteStatus;
+
+        explicit HailstormAsyncWriteCompletion(hailstorm::v1::HailstormAsyncWriteParams const& params) noexcept
+            : params{ params }
+            , max_pending{ std::max(params.max_pending_writes, 1u) }
+        {
+        }
+
+        hailstorm::v1::HailstormAsyncWriteParams const& params;
+        uint32_t const max_pending;
+
+        std::mutex mutex;
+        std::condition_variable cv_completed;
+        uint32_t pending = 0;
+        bool failed = false;
+        bool opened = false;
+
+        //! \brief Set if the coroutine is suspended waiting for pending writes. If a stage is deferred it's issued
+        //!   once a write slot is available, otherwise the coroutine waits for all writes to finish.
+        bool waiting = false;
+        void* deferred_stage = nullptr;
+        IssueFn* deferred_issue = nullptr;
+    };
+
+} // namespace hailstorm::v1
 
 namespace hailstorm
 {
 
+    namespace detail
+    {
+
+        //! \brief Issues a write for which a slot was already taken.
+        //! \return 'false' if the write failed.
+        inline bool async_write_issue(
+            hailstorm::v1::HailstormAsyncWriteCompletion& completion,
+            void* stage,
+            hailstorm::v1::HailstormAsyncWriteCompletion::IssueFn* fn_issue
+        ) noexcept
+        {
+            using hailstorm::v1::HailstormAsyncWriteStatus;
+
+            HailstormAsyncWriteStatus const status = fn_issue(stage);
+            if (status == HailstormAsyncWriteStatus::Pending)
+            {
+                return true;
+            }
+
+            std::lock_guard lock{ completion.mutex };
+            completion.pending -= 1;
+            completion.failed |= status == HailstormAsyncWriteStatus::Failed;
+            return status == HailstormAsyncWriteStatus::Completed;
+        }
+
+        //! \brief Issues the write if a slot is available, otherwise defers the stage until the driving thread resumes it.
+        //! \return 'true' if the coroutine needs to be suspended.
+        inline bool async_write_request(
+            hailstorm::v1::HailstormAsyncWriteCompletion& completion,
+            void* stage,
+            hailstorm::v1::HailstormAsyncWriteCompletion::IssueFn* fn_issue
+        ) noexcept
+        {
+            {
+                std::lock_guard lock{ completion.mutex };
+
+                // We never resume after a failure, the coroutine is destroyed once pending writes are finished.
+                if (completion.failed)
+                {
+                    return true;
+                }
+
+                if (completion.pending >= completion.max_pending)
+                {
+                    completion.waiting = true;
+                    completion.deferred_stage = stage;
+                    completion.deferred_issue = fn_issue;
+                    return true;
+                }
+
+                completion.pending += 1;
+            }
+            return async_write_issue(completion, stage, fn_issue) == false;
+        }
+
+        //! \brief Blocks until the suspended coroutine can continue, issuing the deferred write if there is one.
+        //! \return 'true' if the coroutine should be resumed.
+        inline bool async_write_resume(hailstorm::v1::HailstormAsyncWriteCompletion& completion) noexcept
+        {
+            std::unique_lock lock{ completion.mutex };
+            if (completion.waiting == false)
+            {
+                return false;
+            }
+
+            completion.cv_completed.wait(lock, [&completion]() noexcept
+                {
+                    uint32_t const max_pending = completion.deferred_issue != nullptr ? completion.max_pending - 1 : 0;
+                    return completion.failed || completion.pending <= max_pending;
+                }
+            );
+
+            completion.waiting = false;
+            if (completion.failed)
+            {
+                return false;
+            }
+
+            if (completion.deferred_issue == nullptr)
+            {
+                return true;
+            }
+
+            void* const stage = std::exchange(completion.deferred_stage, nullptr);
+            auto* const fn_issue = std::exchange(completion.deferred_issue, nullptr);
+            completion.pending += 1;
+            lock.unlock();
+
+            return async_write_issue(completion, stage, fn_issue);
+        }
+
+        //! \brief Blocks until all pending writes are finished.
+        inline void async_write_wait_idle(hailstorm::v1::HailstormAsyncWriteCompletion& completion) noexcept
+        {
+            std::unique_lock lock{ completion.mutex };
+            completion.cv_completed.wait(lock, [&completion]() noexcept { return completion.pending == 0; });
+        }
+
+    } // namespace detail
+
     enum class DataWriterMode
     {
         Synchronous,
-        Asynchronous
+        Asynchronous,
+        Parallel,
+        Streamed,
+        Segments,
     };
 
+    //! \brief Parameters of the segments writer, the output is only set if the whole cluster was written.
+    struct SegmentsWriterParams
+    {
+        hailstorm::v1::HailstormWriteParams const& params;
+        hailstorm::v1::HailstormWriteSegments& out_segments;
+    };
+
+    //! \brief Copies compression details provided by a resource write into the final resource entry.
+    inline void apply_write_info(
+        hailstorm::v1::HailstormResource& res,
+        hailstorm::v1::HailstormWriteInfo const& write_info
+    ) noexcept
+    {
+        // Unless compressed, 'origin_size' needs to equal 'size' but we don't care about the compressed size and how it compares to the uncompressed version.
+        assert(write_info.compression.compression_type != 0 || res.size == write_info.compression.origin_size);
+
+        // Copy over all compression information.
+        res.compression_type = write_info.compression.compression_type;
+        res.compression_level = write_info.compression.compression_level;
+        res.compression_param = write_info.compression.compression_param;
+        res.size_origin = write_info.compression.origin_size;
+    }
+
+    //! \brief Creates the write info for a resource that was not yet written, keeps compression details already set on the resource.
+    inline auto initial_write_info(uint32_t idx, hailstorm::v1::HailstormResource const& res) noexcept
+        -> hailstorm::v1::HailstormWriteInfo
+    {
+        return hailstorm::v1::HailstormWriteInfo{
+            .resource_index = idx,
+            .compression = {
+                .compression_type = res.compression_type,
+                .compression_level = res.compression_level,
+                .compression_param = res.compression_param,
+                .origin_size = res.size_origin
+            }
+        };
+    }
+
     struct DataWriterStage
     {
         bool const is_valid;
         inline bool await_ready() const noexcept { return is_valid; }
-        // Since we know the coroutine is not exposed to the outside we can destroy it when an error happens and
-        //   it will clean up all resources on destruction.
-        inline void await_suspend(std::coroutine_handle<> coro) const noexcept { coro.destroy(); }
+        // Since we know the coroutine is not exposed to the outside we just never resume it when an error happens,
+        //   the owning 'Task' will clean up all resources on destruction.
+        inline void await_suspend(std::coroutine_handle<> /*coro*/) const noexcept { }
         inline void await_resume() const noexcept { }
     };
 
+    //! \brief Awaitable write stage of the asynchronous writer, suspends when too many writes are pending.
+    template<typename Fn>
+    struct AsyncWriteStage
+    {
+        AsyncWriteStage(hailstorm::v1::HailstormAsyncWriteCompletion& completion, Fn&& fn) noexcept
+            : _completion{ completion }
+            , _fn{ std::move(fn) }
+        {
+        }
+
+        inline bool await_ready() const noexcept { return false; }
+        inline bool await_suspend(std::coroutine_handle<> /*coro*/) noexcept
+        {
+            return detail::async_write_request(_completion, this, AsyncWriteStage::issue);
+        }
+        inline void await_resume() const noexcept { }
+
+        static auto issue(void* stage) noexcept -> hailstorm::v1::HailstormAsyncWriteStatus
+        {
+            return reinterpret_cast<AsyncWriteStage*>(stage)->_fn();
+        }
+
+        hailstorm::v1::HailstormAsyncWriteCompletion& _completion;
+        Fn _fn;
+    };
+
+    //! \brief Awaitable stage suspending until all pending asynchronous writes are finished.
+    struct AsyncWaitStage
+    {
+        inline bool await_ready() const noexcept { return false; }
+        inline bool await_suspend(std::coroutine_handle<> /*coro*/) noexcept
+        {
+            std::lock_guard lock{ _completion.mutex };
+            _completion.waiting = _completion.pending > 0 && _completion.failed == false;
+            return _completion.pending > 0 || _completion.failed;
+        }
+        inline void await_resume() const noexcept { }
+
+        hailstorm::v1::HailstormAsyncWriteCompletion& _completion;
+    };
+
+    template<typename T>
+    concept IDataWriterStage = requires(T t) {
+        { t.await_ready() } -> std::convertible_to<bool>;
+        { t.await_resume() };
+    };
+
     template<typename T>
     concept IDataWriter = requires(T t, hailstorm::v1::HailstormWriteInfo& write_info) {
-        { t.write_header(hailstorm::Data{}, size_t{}) } -> std::convertible_to<DataWriterStage>;
-        { t.write_resource(hailstorm::v1::HailstormWriteData{}, write_info, size_t{}) } -> std::convertible_to<DataWriterStage>;
-        { t.write_metadata(hailstorm::v1::HailstormWriteData{}, uint32_t{}, size_t{}) } -> std::convertible_to<DataWriterStage>;
+        { t.write_header(hailstorm::Data{}, size_t{}) } -> IDataWriterStage;
+        { t.write_resource(hailstorm::v1::HailstormWriteData{}, write_info, size_t{}) } -> IDataWriterStage;
+        { t.write_metadata(hailstorm::v1::HailstormWriteData{}, uint32_t{}, size_t{}) } -> IDataWriterStage;
         { t.finalize() } -> std::convertible_to<hailstorm::Memory>;
     };
 
+    //! \brief Writers with access to all written data, allowing to calculate chunk checksums once all chunks are written.
+    template<typename T>
+    concept IChecksumDataWriter = requires(
+        T t, std::span<hailstorm::v1::HailstormChunk const> chunks, std::span<uint32_t> out_checksums
+    ) {
+        { t.chunk_checksums(chunks, out_checksums) } -> std::convertible_to<bool>;
+    };
+
+    //! \brief Writers with access to all written data, allowing to encrypt chunks in place once all chunks are written.
+    template<typename T>
+    concept IEncryptingDataWriter = requires(
+        T t, std::span<hailstorm::v1::HailstormChunk const> chunks, hailstorm::v1::HailstormEncryptionKey const& key
+    ) {
+        { t.encrypt_chunks(chunks, key) } -> std::convertible_to<bool>;
+    };
+
+    //! \brief Writers owning the memory of the header block, allowing to fill header data in place instead of copying it.
+    template<typename T>
+    concept IHeaderMemoryDataWriter = requires(T t) {
+        { t.header_memory(size_t{}) } -> std::convertible_to<void*>;
+    };
+
     template<DataWriterMode Mode>
     struct DataWriter;
 
@@ -51,7 +304,7 @@ namespace hailstorm
 
         ~DataWriter()
         {
-            if (_memory.location == nullptr)
+            if (_memory.location != nullptr)
             {
                 _allocator.deallocate(_memory);
             }
@@ -63,6 +316,11 @@ namespace hailstorm
             return DataWriterStage{ true };
         }
 
+        auto header_memory(size_t offset) noexcept -> void*
+        {
+            return ptr_add(_memory.location, offset);
+        }
+
         auto write_resource(
             hailstorm::v1::HailstormWriteData const& data, hailstorm::v1::HailstormWriteInfo& write_info, size_t write_offset
         ) noexcept
@@ -72,10 +330,10 @@ namespace hailstorm
 
             // If data has a nullptr locations, call the write callback to access resource data.
             // This allows us to "stream" input data to the final buffer.
-            // TODO: It would be also good to provide a way to stream final data to a file also.
+            // Writing final data to a file without the whole pack in memory is done by 'write_cluster_streamed'.
             if (data.data[res_idx].location == nullptr)
             {
-                _params.fn_resource_write(data, write_info, target_mem, _params.userdata);
+                return DataWriterStage{ _params.fn_resource_write(data, write_info, target_mem, _params.userdata) };
             }
             else // We got the data so just copy it over
             {
@@ -101,6 +359,33 @@ namespace hailstorm
             return DataWriterStage{ _params.fn_custom_chunk_write(data, chunk, target_mem, _params.userdata) };
         }
 
+        bool chunk_checksums(
+            std::span<hailstorm::v1::HailstormChunk const> chunks,
+            std::span<uint32_t> out_checksums
+        ) const noexcept
+        {
+            for (size_t idx = 0; idx < chunks.size(); ++idx)
+            {
+                out_checksums[idx] = hailstorm::v1::detail::crc32c(0, ptr_add(_memory.location, chunks[idx].offset), chunks[idx].size);
+            }
+            return _memory.location != nullptr;
+        }
+
+        bool encrypt_chunks(
+            std::span<hailstorm::v1::HailstormChunk const> chunks,
+            hailstorm::v1::HailstormEncryptionKey const& key,
+            uint32_t first_chunk = 0
+        ) noexcept
+        {
+            for (size_t idx = 0; idx < chunks.size(); ++idx)
+            {
+                hailstorm::v1::detail::chacha20_xor(
+                    key, first_chunk + uint32_t(idx), 0, ptr_add(_memory.location, chunks[idx].offset), chunks[idx].size
+                );
+            }
+            return _memory.location != nullptr;
+        }
+
         auto finalize() noexcept -> hailstorm::Memory
         {
             return std::exchange(_memory, {});
@@ -115,31 +400,290 @@ namespace hailstorm
     struct DataWriter<DataWriterMode::Asynchronous> final
     {
         DataWriter(
-            hailstorm::v1::HailstormAsyncWriteParams const& params,
+            hailstorm::v1::HailstormAsyncWriteCompletion& completion,
             size_t size
         ) noexcept
-            : _params{ params }
-            , _open{ params.fn_async_open(size, params.async_userdata) }
+            : _params{ completion.params }
+            , _completion{ completion }
+            , _size{ size }
         {
+            // If we fail to open, the first write stage will stop the whole operation.
+            _completion.opened = _params.fn_async_open(size, _params.async_userdata);
+            _completion.failed = _completion.opened == false;
         }
 
         auto write_header(hailstorm::Data data, size_t offset) noexcept
         {
-            return DataWriterStage{ _params.fn_async_write_header(data, offset, _params.async_userdata) };
+            return AsyncWriteStage{ _completion, [this, data, offset]() noexcept
+                {
+                    return _params.fn_async_write_header(data, offset, &_completion, _params.async_userdata);
+                }
+            };
         }
 
         auto write_resource(
             hailstorm::v1::HailstormWriteData const& data, hailstorm::v1::HailstormWriteInfo& write_info, size_t write_offset
         ) noexcept
         {
-            return DataWriterStage{ _params.fn_async_write_resource(data, write_info, write_offset, _params.async_userdata) };
+            return AsyncWriteStage{ _completion, [this, &data, &write_info, write_offset]() noexcept
+                {
+                    return _params.fn_async_write_resource(data, write_info, write_offset, &_completion, _params.async_userdata);
+                }
+            };
         }
 
         auto write_metadata(
             hailstorm::v1::HailstormWriteData const& data, uint32_t idx, size_t write_offset
         ) noexcept
         {
-            return DataWriterStage{ _params.fn_async_write_metadata(data, idx, write_offset, _params.async_userdata) };
+            return AsyncWriteStage{ _completion, [this, &data, idx, write_offset]() noexcept
+                {
+                    return _params.fn_async_write_metadata(data, idx, write_offset, &_completion, _params.async_userdata);
+                }
+            };
+        }
+
+        auto write_custom_chunk_data(
+            hailstorm::v1::HailstormWriteData const& data,
+            hailstorm::v1::HailstormChunk const& chunk
+        ) noexcept
+        {
+            return AsyncWriteStage{ _completion, [this, &data, &chunk]() noexcept
+                {
+                    return _params.fn_async_write_custom_chunk(data, chunk, chunk.offset, &_completion, _params.async_userdata);
+                }
+            };
+        }
+
+        //! \brief Suspends until all pending writes are finished, required before releasing any memory passed to writes.
+        auto wait_pending() noexcept
+        {
+            return AsyncWaitStage{ _completion };
+        }
+
+        //! \note The file is closed by the driving thread once all pending writes are finished.
+        auto finalize() noexcept -> hailstorm::Memory
+        {
+            // We return the written size only, since there is no memory to be returned.
+            return { .location = nullptr, .size = _completion.failed ? 0 : _size, .align = 0 };
+        }
+
+        hailstorm::v1::HailstormAsyncWriteParams const& _params;
+        hailstorm::v1::HailstormAsyncWriteCompletion& _completion;
+        size_t const _size;
+    };
+
+    template<>
+    struct DataWriter<DataWriterMode::Parallel> final
+    {
+        DataWriter(
+            hailstorm::v1::HailstormParallelWriteParams const& params,
+            hailstorm::Allocator& allocator,
+            size_t size
+        ) noexcept
+            : _params{ params }
+            , _writer{ params.base_params, allocator, size }
+        {
+        }
+
+        auto write_header(hailstorm::Data data, size_t offset) noexcept
+        {
+            return _writer.write_header(data, offset);
+        }
+
+        auto header_memory(size_t offset) noexcept -> void*
+        {
+            return _writer.header_memory(offset);
+        }
+
+        auto write_resource(
+            hailstorm::v1::HailstormWriteData const& data, hailstorm::v1::HailstormWriteInfo& write_info, size_t write_offset
+        ) noexcept
+        {
+            return _writer.write_resource(data, write_info, write_offset);
+        }
+
+        //! \brief Writes all resources using multiple threads. Each resource is required to have it's location already set.
+        auto write_resources(
+            hailstorm::v1::HailstormWriteData const& data,
+            std::span<hailstorm::v1::HailstormChunk const> chunks,
+            std::span<hailstorm::v1::HailstormResource> resources
+        ) noexcept
+        {
+            struct JobData
+            {
+                DataWriter& writer;
+                hailstorm::v1::HailstormWriteData const& data;
+                std::span<hailstorm::v1::HailstormChunk const> chunks;
+                std::span<hailstorm::v1::HailstormResource> resources;
+                uint32_t resources_per_job;
+                std::atomic_bool failed;
+            };
+
+            auto const fn_job = [](void* job_data, uint32_t job_index) noexcept
+            {
+                JobData& job = *reinterpret_cast<JobData*>(job_data);
+                uint32_t const first = job_index * job.resources_per_job;
+                uint32_t const last = std::min<uint32_t>(first + job.resources_per_job, uint32_t(job.resources.size()));
+                for (uint32_t idx = first; idx < last && job.failed.load(std::memory_order_relaxed) == false; ++idx)
+                {
+                    // Deduplicated resources don't store any data.
+                    if (hailstorm::v1::detail::is_deduplicated(job.data, idx))
+                    {
+                        continue;
+                    }
+
+                    hailstorm::v1::HailstormResource& res = job.resources[idx];
+                    hailstorm::v1::HailstormWriteInfo write_info = initial_write_info(idx, res);
+
+                    DataWriterStage const stage = job.writer.write_resource(
+                        job.data, write_info, job.chunks[res.chunk].offset + res.offset
+                    );
+                    if (stage.is_valid == false)
+                    {
+                        job.failed.store(true, std::memory_order_relaxed);
+                        return;
+                    }
+
+                    apply_write_info(res, write_info);
+                }
+            };
+
+            uint32_t const resources_per_job = std::max(_params.resources_per_job, 1u);
+            JobData job_data{
+                .writer = *this,
+                .data = data,
+                .chunks = chunks,
+                .resources = resources,
+                .resources_per_job = resources_per_job,
+                .failed = false
+            };
+
+            uint32_t const job_count = (uint32_t(resources.size()) + resources_per_job - 1) / resources_per_job;
+            bool const executed = parallel_for(_params, job_count, fn_job, &job_data);
+            return DataWriterStage{ executed && job_data.failed.load() == false };
+        }
+
+        auto write_metadata(
+            hailstorm::v1::HailstormWriteData const& data, uint32_t idx, size_t offset
+        ) noexcept
+        {
+            return _writer.write_metadata(data, idx, offset);
+        }
+
+        auto write_custom_chunk_data(
+            hailstorm::v1::HailstormWriteData const& data,
+            hailstorm::v1::HailstormChunk const& chunk
+        ) noexcept
+        {
+            return _writer.write_custom_chunk_data(data, chunk);
+        }
+
+        //! \brief Calculates chunk checksums using multiple threads, each job handles a single chunk.
+        bool chunk_checksums(
+            std::span<hailstorm::v1::HailstormChunk const> chunks,
+            std::span<uint32_t> out_checksums
+        ) const noexcept
+        {
+            struct JobData
+            {
+                DataWriter<DataWriterMode::Synchronous> const& writer;
+                std::span<hailstorm::v1::HailstormChunk const> chunks;
+                std::span<uint32_t> checksums;
+            };
+
+            auto const fn_job = [](void* job_data, uint32_t job_index) noexcept
+            {
+                JobData& job = *reinterpret_cast<JobData*>(job_data);
+                job.writer.chunk_checksums(job.chunks.subspan(job_index, 1), job.checksums.subspan(job_index, 1));
+            };
+
+            JobData job_data{ .writer = _writer, .chunks = chunks, .checksums = out_checksums };
+            return _writer._memory.location != nullptr
+                && parallel_for(_params, uint32_t(chunks.size()), fn_job, &job_data);
+        }
+
+        //! \brief Encrypts chunks using multiple threads, each job handles a single chunk.
+        bool encrypt_chunks(
+            std::span<hailstorm::v1::HailstormChunk const> chunks,
+            hailstorm::v1::HailstormEncryptionKey const& key
+        ) noexcept
+        {
+            struct JobData
+            {
+                DataWriter<DataWriterMode::Synchronous>& writer;
+                std::span<hailstorm::v1::HailstormChunk const> chunks;
+                hailstorm::v1::HailstormEncryptionKey const& key;
+            };
+
+            auto const fn_job = [](void* job_data, uint32_t job_index) noexcept
+            {
+                JobData& job = *reinterpret_cast<JobData*>(job_data);
+                job.writer.encrypt_chunks(job.chunks.subspan(job_index, 1), job.key, job_index);
+            };
+
+            JobData job_data{ .writer = _writer, .chunks = chunks, .key = key };
+            return _writer._memory.location != nullptr
+                && parallel_for(_params, uint32_t(chunks.size()), fn_job, &job_data);
+        }
+
+        auto finalize() noexcept -> hailstorm::Memory
+        {
+            return _writer.finalize();
+        }
+
+        hailstorm::v1::HailstormParallelWriteParams const& _params;
+        DataWriter<DataWriterMode::Synchronous> _writer;
+    };
+
+    template<>
+    struct DataWriter<DataWriterMode::Streamed> final
+    {
+        DataWriter(
+            hailstorm::v1::HailstormStreamWriteParams const& params,
+            hailstorm::Allocator& temp_allocator,
+            size_t size
+        ) noexcept
+            : _params{ params }
+            , _temp_allocator{ temp_allocator }
+            , _size{ size }
+            , _ring{
+                temp_allocator,
+                params.file_handle,
+                params.file_offset,
+                params.staging_buffer_size,
+                params.staging_buffer_count
+            }
+        {
+        }
+
+        auto write_header(hailstorm::Data data, size_t offset) noexcept
+        {
+            return DataWriterStage{ _ring.write(offset, data) };
+        }
+
+        auto write_resource(
+            hailstorm::v1::HailstormWriteData const& data, hailstorm::v1::HailstormWriteInfo& write_info, size_t write_offset
+        ) noexcept
+        {
+            uint32_t const res_idx = write_info.resource_index;
+            if (data.data[res_idx].location != nullptr)
+            {
+                return DataWriterStage{ _ring.write(write_offset, data.data[res_idx]) };
+            }
+
+            return write_with_callback(write_offset, data.data[res_idx].size, [&](hailstorm::Memory target_mem) noexcept
+                {
+                    return _params.base_params.fn_resource_write(data, write_info, target_mem, _params.base_params.userdata);
+                }
+            );
+        }
+
+        auto write_metadata(
+            hailstorm::v1::HailstormWriteData const& data, uint32_t idx, size_t offset
+        ) noexcept
+        {
+            return DataWriterStage{ _ring.write(offset, data.metadata[idx]) };
         }
 
         auto write_custom_chunk_data(
@@ -147,26 +691,340 @@ namespace hailstorm
             hailstorm::v1::HailstormChunk const& chunk
         ) noexcept
         {
-            return DataWriterStage{ _params.fn_async_write_custom_chunk(data, chunk, chunk.offset, _params.async_userdata) };
+            return write_with_callback(chunk.offset, chunk.size, [&](hailstorm::Memory target_mem) noexcept
+                {
+                    return _params.base_params.fn_custom_chunk_write(data, chunk, target_mem, _params.base_params.userdata);
+                }
+            );
         }
 
         auto finalize() noexcept -> hailstorm::Memory
         {
-            if (std::exchange(_open, false))
+            // We return the written size only, since there is no memory to be returned.
+            bool const success = _ring.pad_to(_size) && _ring.flush();
+            return { .location = nullptr, .size = success ? _size : 0, .align = 0 };
+        }
+
+        //! \brief Calls the given write function on staging memory if possible or on temporary memory otherwise.
+        template<typename Fn>
+        auto write_with_callback(size_t write_offset, size_t size, Fn&& fn) noexcept -> DataWriterStage
+        {
+            if (size <= _ring.buffer_size())
             {
-                _params.fn_async_close(_params.async_userdata);
+                hailstorm::Memory const target_mem = _ring.acquire(write_offset, size);
+                return DataWriterStage{ target_mem.location != nullptr && fn(target_mem) };
             }
-            return {};
+
+            hailstorm::TrackedMemory temp_mem{ _temp_allocator, size };
+            return DataWriterStage{
+                temp_mem.location != nullptr && fn(temp_mem) && _ring.write(write_offset, data_view(temp_mem))
+            };
+        }
+
+        hailstorm::v1::HailstormStreamWriteParams const& _params;
+        hailstorm::Allocator& _temp_allocator;
+        size_t const _size;
+        hailstorm::StagingRing _ring;
+    };
+
+    template<>
+    struct DataWriter<DataWriterMode::Segments> final
+    {
+        //! \brief Minimal size of the zeroed block referenced by padding segments.
+        static constexpr size_t Constant_MinZeroBlockSize = 4 * Constant_1KiB;
+
+        struct Entry
+        {
+            size_t offset;
+            hailstorm::Data data;
+        };
+
+        //! \param [in] temp_data Memory holding temporary resource data, resources viewing it are copied.
+        //! \param [in] header_size Size of the initial cluster block holding all header data.
+        DataWriter(
+            hailstorm::SegmentsWriterParams& params,
+            hailstorm::Allocator& temp_allocator,
+            hailstorm::v1::HailstormWriteData const& data,
+            hailstorm::Data temp_data,
+            std::span<hailstorm::v1::HailstormChunk const> chunks,
+            size_t header_size,
+            size_t size
+        ) noexcept
+            : _params{ params }
+            , _temp_data{ temp_data }
+            , _size{ size }
+            , _entries{ temp_allocator }
+        {
+            // Calculate the size of all data that can't be referenced directly.
+            size_t owned_size = align_to(header_size, 8);
+            for (uint32_t idx = 0; idx < data.data.size(); ++idx)
+            {
+                if (is_referenced(data.data[idx]) == false && hailstorm::v1::detail::is_deduplicated(data, idx) == false)
+                {
+                    owned_size += align_to(data.data[idx].size, 8);
+                }
+            }
+
+            // Padding is never bigger than the highest chunk alignment, except for chunks written by the user.
+            size_t zeros_size = Constant_MinZeroBlockSize;
+            for (hailstorm::v1::HailstormChunk const& chunk : chunks)
+            {
+                zeros_size = std::max<size_t>(zeros_size, align_to(chunk.align, 8) + 8);
+                if (chunk.type == 0)
+                {
+                    owned_size += align_to(chunk.size, 8);
+                }
+            }
+
+            // Each write creates at most two segments, the data and the padding before it.
+            uint32_t const count_writes = 1 + uint32_t(data.data.size() + data.metadata.size() + chunks.size());
+            _capacity = count_writes * 2 + 1;
+
+            size_t const segments_size = sizeof(hailstorm::Data) * _capacity;
+            _memory = _params.params.cluster_alloc.allocate(segments_size + owned_size + zeros_size);
+            if (_memory.location == nullptr)
+            {
+                return;
+            }
+
+            _segments = reinterpret_cast<hailstorm::Data*>(_memory.location);
+            _header = ptr_add(_memory.location, segments_size);
+            _owned_cursor = ptr_add(_header, align_to(header_size, 8));
+            _zeros = { ptr_add(_header, owned_size), zeros_size, 8 };
+
+            std::memset(_header, 0, header_size);
+            std::memset(const_cast<void*>(_zeros.location), 0, zeros_size);
+
+            _entries.reserve(count_writes);
+            _entries.push_back({ 0, { _header, header_size, 8 } });
         }
 
         ~DataWriter() noexcept
         {
-            assert(_open == false);
-            finalize();
+            if (_memory.location != nullptr)
+            {
+                _params.params.cluster_alloc.deallocate(_memory);
+            }
         }
 
-        hailstorm::v1::HailstormAsyncWriteParams const& _params;
-        bool _open;
+        auto write_header(hailstorm::Data data, size_t offset) noexcept
+        {
+            assert(offset + data.size <= _entries[0].data.size);
+            std::memcpy(ptr_add(_header, offset), data.location, data.size);
+            return DataWriterStage{ _memory.location != nullptr };
+        }
+
+        auto header_memory(size_t offset) noexcept -> void*
+        {
+            assert(offset <= _entries[0].data.size);
+            return ptr_add(_header, offset);
+        }
+
+        auto write_resource(
+            hailstorm::v1::HailstormWriteData const& data, hailstorm::v1::HailstormWriteInfo& write_info, size_t write_offset
+        ) noexcept
+        {
+            hailstorm::v1::HailstormWriteParams const& params = _params.params;
+            hailstorm::Data const res_data = data.data[write_info.resource_index];
+            if (is_referenced(res_data))
+            {
+                return DataWriterStage{ push_entry(write_offset, res_data) };
+            }
+
+            hailstorm::Memory const target_mem = take_owned(res_data.size);
+            if (res_data.location == nullptr)
+            {
+                if (params.fn_resource_write(data, write_info, target_mem, params.userdata) == false)
+                {
+                    return DataWriterStage{ false };
+                }
+            }
+            else
+            {
+                std::memcpy(target_mem.location, res_data.location, res_data.size);
+            }
+            return DataWriterStage{ push_entry(write_offset, data_view(target_mem)) };
+        }
+
+        auto write_metadata(
+            hailstorm::v1::HailstormWriteData const& data, uint32_t idx, size_t offset
+        ) noexcept
+        {
+            return DataWriterStage{ push_entry(offset, data.metadata[idx]) };
+        }
+
+        //! \brief Adds a view of already existing cluster data, the data is never copied.
+        auto write_reference(hailstorm::Data data, size_t offset) noexcept
+        {
+            return DataWriterStage{ push_entry(offset, data) };
+        }
+
+        auto write_custom_chunk_data(
+            hailstorm::v1::HailstormWriteData const& data,
+            hailstorm::v1::HailstormChunk const& chunk
+        ) noexcept
+        {
+            hailstorm::v1::HailstormWriteParams const& params = _params.params;
+            hailstorm::Memory const target_mem = take_owned(chunk.size);
+            return DataWriterStage{
+                params.fn_custom_chunk_write(data, chunk, target_mem, params.userdata)
+                && push_entry(chunk.offset, data_view(target_mem))
+            };
+        }
+
+        //! \brief Calculates chunk checksums from all recorded writes, padding is always zeroed.
+        bool chunk_checksums(
+            std::span<hailstorm::v1::HailstormChunk const> chunks,
+            std::span<uint32_t> out_checksums
+        ) noexcept
+        {
+            sort_entries();
+
+            uint32_t entry_idx = 0;
+            uint32_t const entry_count = _entries.count();
+            for (size_t chunk_idx = 0; chunk_idx < chunks.size(); ++chunk_idx)
+            {
+                size_t const chunk_end = chunks[chunk_idx].offset + chunks[chunk_idx].size;
+                size_t cursor = chunks[chunk_idx].offset;
+
+                // Skip all entries before this chunk, the last entry might still continue in the next chunk.
+                while (entry_idx < entry_count && _entries[entry_idx].offset + _entries[entry_idx].data.size <= cursor)
+                {
+                    entry_idx += 1;
+                }
+
+                uint32_t crc = 0;
+                while (entry_idx < entry_count && _entries[entry_idx].offset < chunk_end)
+                {
+                    Entry const& entry = _entries[entry_idx];
+                    size_t const entry_end = entry.offset + entry.data.size;
+                    if (entry.offset > cursor)
+                    {
+                        crc = hailstorm::v1::detail::crc32c_zeros(crc, entry.offset - cursor);
+                        cursor = entry.offset;
+                    }
+
+                    size_t const end = std::min(entry_end, chunk_end);
+                    crc = hailstorm::v1::detail::crc32c(crc, ptr_add(entry.data.location, cursor - entry.offset), end - cursor);
+                    cursor = end;
+
+                    if (entry_end > chunk_end)
+                    {
+                        break;
+                    }
+                    entry_idx += 1;
+                }
+
+                out_checksums[chunk_idx] = hailstorm::v1::detail::crc32c_zeros(crc, chunk_end - cursor);
+            }
+            return _memory.location != nullptr;
+        }
+
+        auto finalize() noexcept -> hailstorm::Memory
+        {
+            // Writes are not done in file order, so we sort them and fill the gaps with padding.
+            sort_entries();
+
+            uint32_t count = 0;
+            size_t cursor = 0;
+            bool success = true;
+            for (Entry const& entry : _entries)
+            {
+                assert(entry.offset >= cursor);
+                success &= push_padding(count, entry.offset - cursor) && push_segment(count, entry.data);
+                cursor = entry.offset + entry.data.size;
+            }
+            success &= push_padding(count, _size - cursor);
+
+            // Should never happen, since the highest chunk alignment defines the biggest padding.
+            assert(success);
+            if (success == false)
+            {
+                return { };
+            }
+
+            _params.out_segments = {
+                .segments = std::span{ _segments, count },
+                .size = _size,
+                .memory = _memory
+            };
+            return { std::exchange(_memory, {}).location, _size, 8 };
+        }
+
+        void sort_entries() noexcept
+        {
+            std::sort(_entries.begin(), _entries.end(), [](Entry const& left, Entry const& right) noexcept
+                {
+                    return left.offset < right.offset;
+                }
+            );
+        }
+
+        bool is_referenced(hailstorm::Data data) const noexcept
+        {
+            char const* const location = reinterpret_cast<char const*>(data.location);
+            char const* const temp_begin = reinterpret_cast<char const*>(_temp_data.location);
+            return location != nullptr && (location < temp_begin || location >= temp_begin + _temp_data.size);
+        }
+
+        auto take_owned(size_t size) noexcept -> hailstorm::Memory
+        {
+            hailstorm::Memory const result{ _owned_cursor, size, 8 };
+            _owned_cursor = ptr_add(_owned_cursor, align_to(size, 8));
+            return result;
+        }
+
+        bool push_entry(size_t offset, hailstorm::Data data) noexcept
+        {
+            if (data.size > 0)
+            {
+                _entries.push_back({ offset, data });
+            }
+            return _memory.location != nullptr;
+        }
+
+        bool push_segment(uint32_t& count, hailstorm::Data data) noexcept
+        {
+            // Data placed one after another in memory is merged into a single segment.
+            if (count > 0 && ptr_add(_segments[count - 1].location, _segments[count - 1].size) == data.location)
+            {
+                _segments[count - 1].size += data.size;
+                return true;
+            }
+            if (count == _capacity)
+            {
+                return false;
+            }
+
+            _segments[count] = data;
+            count += 1;
+            return true;
+        }
+
+        bool push_padding(uint32_t& count, size_t size) noexcept
+        {
+            bool success = true;
+            while (size > 0 && success)
+            {
+                size_t const padding_size = std::min(size, _zeros.size);
+                success = push_segment(count, { _zeros.location, padding_size, 1 });
+                size -= padding_size;
+            }
+            return success;
+        }
+
+        hailstorm::SegmentsWriterParams& _params;
+        hailstorm::Data const _temp_data;
+        size_t const _size;
+        hailstorm::Array<Entry> _entries;
+
+        hailstorm::Memory _memory{ };
+        hailstorm::Data* _segments = nullptr;
+        uint32_t _capacity = 0;
+
+        void* _header = nullptr;
+        void* _owned_cursor = nullptr;
+        hailstorm::Data _zeros{ };
     };
 
 } // namespace hailstorm
@@ -0,0 +1,161 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include "hailstorm_deduplication.hxx"
+#include <algorithm>
+#include <cstring>
+#include <bit>
+
+namespace hailstorm::v1::detail
+{
+
+    static constexpr uint32_t Constant_DedupEmptySlot = std::numeric_limits<uint32_t>::max();
+    static constexpr uint64_t Constant_DedupPrime1 = 0x9e37'79b9'7f4a'7c15ull;
+    static constexpr uint64_t Constant_DedupPrime2 = 0xc2b2'ae3d'27d4'eb4full;
+
+    namespace
+    {
+
+        auto mix(uint64_t value) noexcept -> uint64_t
+        {
+            value ^= value >> 33;
+            value *= 0xff51'afd7'ed55'8ccdull;
+            value ^= value >> 33;
+            value *= 0xc4ce'b9fe'1a85'ec53ull;
+            value ^= value >> 33;
+            return value;
+        }
+
+        auto lane_round(uint64_t lane, uint64_t word) noexcept -> uint64_t
+        {
+            return std::rotl(lane ^ (word * Constant_DedupPrime2), 31) * Constant_DedupPrime1;
+        }
+
+        //! \brief Fast non-cryptographic hash, matches are always confirmed by comparing the data.
+        auto hash_data(void const* data, size_t size) noexcept -> uint64_t
+        {
+            uint8_t const* bytes = reinterpret_cast<uint8_t const*>(data);
+
+            // Four independent lanes, so multiplications of consecutive words can overlap.
+            uint64_t lanes[4]{ size, size ^ Constant_DedupPrime1, size ^ Constant_DedupPrime2, ~size };
+            while (size >= 32)
+            {
+                for (uint64_t& lane : lanes)
+                {
+                    uint64_t word;
+                    std::memcpy(&word, bytes, 8);
+                    lane = lane_round(lane, word);
+                    bytes += 8;
+                }
+                size -= 32;
+            }
+
+            uint64_t hash = lanes[0] ^ std::rotl(lanes[1], 17) ^ std::rotl(lanes[2], 34) ^ std::rotl(lanes[3], 51);
+            while (size >= 8)
+            {
+                uint64_t word;
+                std::memcpy(&word, bytes, 8);
+                hash = lane_round(hash, word);
+                bytes += 8;
+                size -= 8;
+            }
+
+            uint64_t tail = 0;
+            std::memcpy(&tail, bytes, size);
+            return mix(lane_round(hash, tail));
+        }
+
+        //! \brief Baked resources store offsets into their own data, so identical bytes are not enough to share the data.
+        bool equal_relocations(std::span<std::span<uint32_t const> const> relocations, uint32_t left, uint32_t right) noexcept
+        {
+            return relocations.empty() || std::ranges::equal(relocations[left], relocations[right]);
+        }
+
+    } // namespace
+
+    auto find_duplicated_data(
+        std::span<hailstorm::Data const> data,
+        std::span<std::span<uint32_t const> const> relocations,
+        hailstorm::Allocator& temp_alloc,
+        hailstorm::Array<uint32_t>& out_mapping
+    ) noexcept -> uint32_t
+    {
+        uint32_t const res_count = uint32_t(data.size());
+        out_mapping.resize(res_count);
+
+        // Open addressing table of resource indices, with a load factor of at most '0.5'.
+        hailstorm::Array<uint32_t> slots{ temp_alloc };
+        slots.resize(std::bit_ceil(std::max<uint32_t>(res_count, 1) * 2));
+        slots.memset(0xff);
+        uint32_t const slot_mask = slots.count() - 1;
+
+        // Only resources sharing their size with another resource can be duplicates, so only those need to be hashed.
+        hailstorm::Array<uint8_t> candidates{ temp_alloc };
+        candidates.resize(res_count);
+        candidates.memset(0);
+        for (uint32_t idx = 0; idx < res_count; ++idx)
+        {
+            out_mapping[idx] = idx;
+            if (data[idx].location == nullptr)
+            {
+                continue;
+            }
+
+            uint32_t slot = uint32_t(mix(data[idx].size)) & slot_mask;
+            while (slots[slot] != Constant_DedupEmptySlot && data[slots[slot]].size != data[idx].size)
+            {
+                slot = (slot + 1) & slot_mask;
+            }
+
+            if (slots[slot] == Constant_DedupEmptySlot)
+            {
+                slots[slot] = idx;
+            }
+            else
+            {
+                candidates[slots[slot]] = 1;
+                candidates[idx] = 1;
+            }
+        }
+
+        hailstorm::Array<uint64_t> hashes{ temp_alloc };
+        hashes.resize(res_count);
+        slots.memset(0xff);
+
+        uint32_t count_duplicates = 0;
+        for (uint32_t idx = 0; idx < res_count; ++idx)
+        {
+            if (candidates[idx] == 0)
+            {
+                continue;
+            }
+
+            hailstorm::Data const res_data = data[idx];
+            uint64_t const hash = hash_data(res_data.location, res_data.size);
+            hashes[idx] = hash;
+
+            uint32_t slot = uint32_t(hash) & slot_mask;
+            while (slots[slot] != Constant_DedupEmptySlot)
+            {
+                uint32_t const other = slots[slot];
+                if (hashes[other] == hash
+                    && data[other].size == res_data.size
+                    && std::memcmp(data[other].location, res_data.location, res_data.size) == 0
+                    && equal_relocations(relocations, other, idx))
+                {
+                    out_mapping[idx] = other;
+                    count_duplicates += 1;
+                    break;
+                }
+                slot = (slot + 1) & slot_mask;
+            }
+
+            if (slots[slot] == Constant_DedupEmptySlot)
+            {
+                slots[slot] = idx;
+            }
+        }
+        return count_duplicates;
+    }
+
+} // namespace hailstorm::v1::detail
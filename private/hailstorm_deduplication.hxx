@@ -0,0 +1,25 @@
+#pragma once
+#include <hailstorm/hailstorm_operations.hxx>
+#include "hailstorm_array.hxx"
+
+namespace hailstorm::v1::detail
+{
+
+    //! \return 'true' if the data of the given resource is stored by another resource.
+    inline bool is_deduplicated(hailstorm::v1::HailstormWriteData const& write_data, uint32_t idx) noexcept
+    {
+        return write_data.data_mapping.empty() == false && write_data.data_mapping[idx] != idx;
+    }
+
+    //! \brief Finds resources with identical data, resources without a data location are never considered duplicates.
+    //! \param [in] relocations Optional relocations of each resource, resources are only duplicates if their relocations match.
+    //! \param [out] out_mapping For each resource, the index of the first resource with the same data.
+    //! \return The number of resources mapped to another resource.
+    auto find_duplicated_data(
+        std::span<hailstorm::Data const> data,
+        std::span<std::span<uint32_t const> const> relocations,
+        hailstorm::Allocator& temp_alloc,
+        hailstorm::Array<uint32_t>& out_mapping
+    ) noexcept -> uint32_t;
+
+} // namespace hailstorm::v1::detail
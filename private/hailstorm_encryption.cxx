@@ -0,0 +1,204 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include "hailstorm_encryption.hxx"
+#include "hailstorm_memutils.hxx"
+#include "hailstorm_chunk_info.hxx"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+
+namespace hailstorm::v1
+{
+
+    namespace detail
+    {
+
+        //! \brief Number of keystream blocks generated at once, each block is calculated in a separate lane to allow
+        //!   compilers to vectorize the rounds.
+        static constexpr uint32_t Constant_ChaCha20Lanes = 4;
+
+        static constexpr uint32_t Constant_ChaCha20Constants[4]{ 0x6170'7865u, 0x3320'646eu, 0x7962'2d32u, 0x6b20'6574u };
+
+        namespace
+        {
+
+            using ChaCha20Lanes = uint32_t[16][Constant_ChaCha20Lanes];
+
+            inline auto load_le32(uint8_t const* bytes) noexcept -> uint32_t
+            {
+                return uint32_t{ bytes[0] } | (uint32_t{ bytes[1] } << 8) | (uint32_t{ bytes[2] } << 16) | (uint32_t{ bytes[3] } << 24);
+            }
+
+            inline void store_le32(uint8_t* bytes, uint32_t value) noexcept
+            {
+                bytes[0] = uint8_t(value);
+                bytes[1] = uint8_t(value >> 8);
+                bytes[2] = uint8_t(value >> 16);
+                bytes[3] = uint8_t(value >> 24);
+            }
+
+            inline void quarter_round(ChaCha20Lanes& x, uint32_t a, uint32_t b, uint32_t c, uint32_t d) noexcept
+            {
+                for (uint32_t lane = 0; lane < Constant_ChaCha20Lanes; ++lane)
+                {
+                    x[a][lane] += x[b][lane]; x[d][lane] = std::rotl(x[d][lane] ^ x[a][lane], 16);
+                    x[c][lane] += x[d][lane]; x[b][lane] = std::rotl(x[b][lane] ^ x[c][lane], 12);
+                    x[a][lane] += x[b][lane]; x[d][lane] = std::rotl(x[d][lane] ^ x[a][lane], 8);
+                    x[c][lane] += x[d][lane]; x[b][lane] = std::rotl(x[b][lane] ^ x[c][lane], 7);
+                }
+            }
+
+            //! \brief Generates the keystream of consecutive blocks, starting at the given block counter.
+            void keystream(
+                uint32_t const (&input)[16],
+                uint32_t counter,
+                uint8_t (&out_keystream)[Constant_ChaCha20Lanes * Constant_ChaCha20BlockSize]
+            ) noexcept
+            {
+                ChaCha20Lanes state;
+                for (uint32_t word = 0; word < 16; ++word)
+                {
+                    for (uint32_t lane = 0; lane < Constant_ChaCha20Lanes; ++lane)
+                    {
+                        state[word][lane] = word == 12 ? counter + lane : input[word];
+                    }
+                }
+
+                ChaCha20Lanes x;
+                std::memcpy(x, state, sizeof(x));
+                for (uint32_t round = 0; round < 10; ++round)
+                {
+                    quarter_round(x, 0, 4, 8, 12);
+                    quarter_round(x, 1, 5, 9, 13);
+                    quarter_round(x, 2, 6, 10, 14);
+                    quarter_round(x, 3, 7, 11, 15);
+                    quarter_round(x, 0, 5, 10, 15);
+                    quarter_round(x, 1, 6, 11, 12);
+                    quarter_round(x, 2, 7, 8, 13);
+                    quarter_round(x, 3, 4, 9, 14);
+                }
+
+                for (uint32_t lane = 0; lane < Constant_ChaCha20Lanes; ++lane)
+                {
+                    for (uint32_t word = 0; word < 16; ++word)
+                    {
+                        store_le32(out_keystream + lane * Constant_ChaCha20BlockSize + word * 4, x[word][lane] + state[word][lane]);
+                    }
+                }
+            }
+
+            void xor_bytes(uint8_t* data, uint8_t const* keystream, size_t size) noexcept
+            {
+                // Process 8 bytes at a time, the 'memcpy' allows unaligned loads.
+                while (size >= 8)
+                {
+                    uint64_t value, key;
+                    std::memcpy(&value, data, 8);
+                    std::memcpy(&key, keystream, 8);
+                    value ^= key;
+                    std::memcpy(data, &value, 8);
+
+                    data += 8;
+                    keystream += 8;
+                    size -= 8;
+                }
+
+                while (size > 0)
+                {
+                    *data ^= *keystream;
+                    data += 1;
+                    keystream += 1;
+                    size -= 1;
+                }
+            }
+
+        } // namespace
+
+        void chacha20_xor(
+            hailstorm::v1::HailstormEncryptionKey const& key,
+            uint32_t chunk_idx,
+            uint64_t chunk_offset,
+            void* data,
+            size_t size
+        ) noexcept
+        {
+            // The block counter is limited to 32 bits, see RFC 8439.
+            assert((chunk_offset + size) / Constant_ChaCha20BlockSize <= 0xffff'ffffu);
+
+            uint32_t input[16];
+            std::memcpy(input, Constant_ChaCha20Constants, sizeof(Constant_ChaCha20Constants));
+            for (uint32_t word = 0; word < 8; ++word)
+            {
+                input[4 + word] = load_le32(key.key + word * 4);
+            }
+            input[12] = 0;
+            input[13] = chunk_idx;
+            input[14] = load_le32(key.nonce);
+            input[15] = load_le32(key.nonce + 4);
+
+            uint8_t keystream_blocks[Constant_ChaCha20Lanes * Constant_ChaCha20BlockSize];
+            uint8_t* bytes = reinterpret_cast<uint8_t*>(data);
+            uint64_t block = chunk_offset / Constant_ChaCha20BlockSize;
+            size_t skip = size_t(chunk_offset % Constant_ChaCha20BlockSize);
+            while (size > 0)
+            {
+                keystream(input, uint32_t(block), keystream_blocks);
+
+                // Only the first batch might start in the middle of a block.
+                size_t const count = std::min(sizeof(keystream_blocks) - skip, size);
+                xor_bytes(bytes, keystream_blocks + skip, count);
+
+                bytes += count;
+                size -= count;
+                block += Constant_ChaCha20Lanes;
+                skip = 0;
+            }
+        }
+
+    } // namespace detail
+
+    void decrypt_chunk_data(
+        hailstorm::v1::HailstormEncryptionKey const& key,
+        uint32_t chunk_idx,
+        uint64_t chunk_offset,
+        hailstorm::Memory data
+    ) noexcept
+    {
+        detail::chacha20_xor(key, chunk_idx, chunk_offset, data.location, data.size);
+    }
+
+    auto decrypt_resource_data(
+        hailstorm::v1::HailstormData const& hailstorm,
+        hailstorm::v1::HailstormEncryptionKey const& key,
+        uint32_t resource_idx,
+        hailstorm::v1::HailstormByteRange const& range,
+        hailstorm::Memory data
+    ) noexcept -> hailstorm::Result
+    {
+        uint64_t location = 0;
+        uint32_t first_chunk = 0;
+        uint32_t count_chunks = 0;
+        if (hailstorm.header.is_encrypted == false || data.size < range.size
+            || detail::resource_range_chunks(hailstorm, resource_idx, range.offset, range.size, location, first_chunk, count_chunks) == false)
+        {
+            return Result::E_InvalidArgument;
+        }
+
+        // Data stored across multiple chunks is continuous, but each part is encrypted with the keystream of it's chunk.
+        uint64_t const end = location + range.size;
+        for (uint32_t chunk_idx = first_chunk; chunk_idx < first_chunk + count_chunks; ++chunk_idx)
+        {
+            HailstormChunk const& chunk = hailstorm.chunks[chunk_idx];
+            uint64_t const part_begin = std::max(location, chunk.offset);
+            uint64_t const part_end = std::min(end, chunk.offset + chunk.size);
+
+            detail::chacha20_xor(
+                key, chunk_idx, part_begin - chunk.offset, ptr_add(data.location, part_begin - location), part_end - part_begin
+            );
+        }
+        return Result::Success;
+    }
+
+} // namespace hailstorm::v1
@@ -0,0 +1,20 @@
+#pragma once
+#include <hailstorm/hailstorm_operations.hxx>
+
+namespace hailstorm::v1::detail
+{
+
+    //! \brief Size of a single ChaCha20 keystream block.
+    static constexpr uint64_t Constant_ChaCha20BlockSize = 64;
+
+    //! \brief Combines data with the ChaCha20 keystream of the given chunk, starting at the given chunk offset.
+    //! \note Encryption and decryption are the same operation.
+    void chacha20_xor(
+        hailstorm::v1::HailstormEncryptionKey const& key,
+        uint32_t chunk_idx,
+        uint64_t chunk_offset,
+        void* data,
+        size_t size
+    ) noexcept;
+
+} // namespace hailstorm::v1::detail
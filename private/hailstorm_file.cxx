@@ -0,0 +1,346 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include "hailstorm_file.hxx"
+#include "hailstorm_memutils.hxx"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#endif
+
+namespace hailstorm
+{
+
+#if defined(_WIN32)
+
+    bool file_write_at(
+        hailstorm::NativeFileHandle handle,
+        hailstorm::Data data,
+        uint64_t file_offset
+    ) noexcept
+    {
+        size_t written_total = 0;
+        while (written_total < data.size)
+        {
+            uint64_t const offset = file_offset + written_total;
+            DWORD const write_size = DWORD(std::min<size_t>(data.size - written_total, Constant_1GiB));
+
+            OVERLAPPED overlapped{ };
+            overlapped.Offset = DWORD(offset & 0xffff'ffffu);
+            overlapped.OffsetHigh = DWORD(offset >> 32);
+
+            DWORD written = 0;
+            if (WriteFile(
+                reinterpret_cast<HANDLE>(handle), ptr_add(data.location, written_total), write_size, &written, &overlapped
+            ) == FALSE)
+            {
+                return false;
+            }
+            written_total += written;
+        }
+        return true;
+    }
+
+    bool file_read_at(
+        hailstorm::NativeFileHandle handle,
+        hailstorm::Memory memory,
+        uint64_t file_offset
+    ) noexcept
+    {
+        size_t read_total = 0;
+        while (read_total < memory.size)
+        {
+            uint64_t const offset = file_offset + read_total;
+            DWORD const read_size = DWORD(std::min<size_t>(memory.size - read_total, Constant_1GiB));
+
+            OVERLAPPED overlapped{ };
+            overlapped.Offset = DWORD(offset & 0xffff'ffffu);
+            overlapped.OffsetHigh = DWORD(offset >> 32);
+
+            DWORD read = 0;
+            if (ReadFile(
+                reinterpret_cast<HANDLE>(handle), ptr_add(memory.location, read_total), read_size, &read, &overlapped
+            ) == FALSE || read == 0)
+            {
+                return false;
+            }
+            read_total += read;
+        }
+        return true;
+    }
+
+    auto file_open(char const* path, FileOpenFlags flags) noexcept -> hailstorm::NativeFileHandle
+    {
+        DWORD const access = has_flag(flags, FileOpenFlags::Write) ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ;
+        DWORD const creation = has_flag(flags, FileOpenFlags::Create) ? CREATE_ALWAYS : OPEN_EXISTING;
+        DWORD const attributes = has_flag(flags, FileOpenFlags::Unbuffered) ? FILE_FLAG_NO_BUFFERING : FILE_ATTRIBUTE_NORMAL;
+
+        HANDLE const handle = CreateFileA(
+            path, access, FILE_SHARE_READ, nullptr, creation, attributes, nullptr
+        );
+        return handle == INVALID_HANDLE_VALUE ? Constant_InvalidFileHandle : reinterpret_cast<hailstorm::NativeFileHandle>(handle);
+    }
+
+    void file_close(hailstorm::NativeFileHandle handle) noexcept
+    {
+        CloseHandle(reinterpret_cast<HANDLE>(handle));
+    }
+
+    auto file_size(hailstorm::NativeFileHandle handle) noexcept -> uint64_t
+    {
+        LARGE_INTEGER size{ };
+        return GetFileSizeEx(reinterpret_cast<HANDLE>(handle), &size) ? uint64_t(size.QuadPart) : 0;
+    }
+
+    bool file_resize(hailstorm::NativeFileHandle handle, uint64_t size) noexcept
+    {
+        // Unlike 'SetEndOfFile' this does not require the file pointer to be moved, which needs to be aligned for unbuffered files.
+        FILE_END_OF_FILE_INFO info{ };
+        info.EndOfFile.QuadPart = LONGLONG(size);
+        return SetFileInformationByHandle(reinterpret_cast<HANDLE>(handle), FileEndOfFileInfo, &info, sizeof(info)) != FALSE;
+    }
+
+    bool file_map(
+        hailstorm::NativeFileHandle handle,
+        uint64_t offset,
+        size_t size,
+        hailstorm::FileMapping& out_mapping
+    ) noexcept
+    {
+        SYSTEM_INFO system_info{ };
+        GetSystemInfo(&system_info);
+
+        uint64_t const base_offset = offset - (offset % system_info.dwAllocationGranularity);
+        size_t const base_size = size_t(offset - base_offset) + size;
+
+        HANDLE const mapping = CreateFileMappingA(reinterpret_cast<HANDLE>(handle), nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            return false;
+        }
+
+        void* const base = MapViewOfFile(
+            mapping, FILE_MAP_READ, DWORD(base_offset >> 32), DWORD(base_offset & 0xffff'ffffu), base_size
+        );
+        if (base == nullptr)
+        {
+            CloseHandle(mapping);
+            return false;
+        }
+
+        out_mapping = FileMapping{
+            .base = base,
+            .base_size = base_size,
+            .data = { ptr_add(base, size_t(offset - base_offset)), size, 1 },
+            .native_mapping = reinterpret_cast<hailstorm::NativeFileHandle>(mapping)
+        };
+        return true;
+    }
+
+    void file_unmap(hailstorm::FileMapping& mapping) noexcept
+    {
+        if (mapping.base != nullptr)
+        {
+            UnmapViewOfFile(mapping.base);
+            CloseHandle(reinterpret_cast<HANDLE>(mapping.native_mapping));
+        }
+        mapping = FileMapping{ };
+    }
+
+    void memory_advise(hailstorm::Data range, hailstorm::MemoryAdvice advice) noexcept
+    {
+        if (range.size == 0)
+        {
+            return;
+        }
+
+        if (advice == MemoryAdvice::WillNeed)
+        {
+            WIN32_MEMORY_RANGE_ENTRY entry{ const_cast<void*>(range.location), range.size };
+            PrefetchVirtualMemory(GetCurrentProcess(), 1, &entry, 0);
+        }
+        else if (advice == MemoryAdvice::DontNeed)
+        {
+            // Unlocking pages that are not locked removes them from the working set.
+            VirtualUnlock(const_cast<void*>(range.location), range.size);
+        }
+    }
+
+#else
+
+    bool file_write_at(
+        hailstorm::NativeFileHandle handle,
+        hailstorm::Data data,
+        uint64_t file_offset
+    ) noexcept
+    {
+        size_t written_total = 0;
+        while (written_total < data.size)
+        {
+            ssize_t const written = ::pwrite(
+                int(handle), ptr_add(data.location, written_total), data.size - written_total, off_t(file_offset + written_total)
+            );
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else if (written <= 0)
+            {
+                return false;
+            }
+            written_total += size_t(written);
+        }
+        return true;
+    }
+
+    bool file_read_at(
+        hailstorm::NativeFileHandle handle,
+        hailstorm::Memory memory,
+        uint64_t file_offset
+    ) noexcept
+    {
+        size_t read_total = 0;
+        while (read_total < memory.size)
+        {
+            ssize_t const read = ::pread(
+                int(handle), ptr_add(memory.location, read_total), memory.size - read_total, off_t(file_offset + read_total)
+            );
+            if (read < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else if (read <= 0)
+            {
+                return false;
+            }
+            read_total += size_t(read);
+        }
+        return true;
+    }
+
+    auto file_open(char const* path, FileOpenFlags flags) noexcept -> hailstorm::NativeFileHandle
+    {
+        int open_flags = has_flag(flags, FileOpenFlags::Write) ? O_RDWR : O_RDONLY;
+        if (has_flag(flags, FileOpenFlags::Create))
+        {
+            open_flags |= O_CREAT | O_TRUNC;
+        }
+
+#if defined(O_DIRECT)
+        if (has_flag(flags, FileOpenFlags::Unbuffered))
+        {
+            open_flags |= O_DIRECT;
+        }
+#endif
+
+        int const fd = ::open(path, open_flags | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            return Constant_InvalidFileHandle;
+        }
+
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+        if (has_flag(flags, FileOpenFlags::Unbuffered))
+        {
+            ::fcntl(fd, F_NOCACHE, 1);
+        }
+#endif
+        return hailstorm::NativeFileHandle{ fd };
+    }
+
+    void file_close(hailstorm::NativeFileHandle handle) noexcept
+    {
+        ::close(int(handle));
+    }
+
+    auto file_size(hailstorm::NativeFileHandle handle) noexcept -> uint64_t
+    {
+        struct stat file_stat{ };
+        return ::fstat(int(handle), &file_stat) == 0 ? uint64_t(file_stat.st_size) : 0;
+    }
+
+    bool file_resize(hailstorm::NativeFileHandle handle, uint64_t size) noexcept
+    {
+        return ::ftruncate(int(handle), off_t(size)) == 0;
+    }
+
+    bool file_map(
+        hailstorm::NativeFileHandle handle,
+        uint64_t offset,
+        size_t size,
+        hailstorm::FileMapping& out_mapping
+    ) noexcept
+    {
+        uint64_t const page_size = uint64_t(::sysconf(_SC_PAGESIZE));
+        uint64_t const base_offset = offset - (offset % page_size);
+        size_t const base_size = size_t(offset - base_offset) + size;
+
+        void* const base = ::mmap(nullptr, base_size, PROT_READ, MAP_SHARED, int(handle), off_t(base_offset));
+        if (base == MAP_FAILED)
+        {
+            return false;
+        }
+
+        out_mapping = FileMapping{
+            .base = base,
+            .base_size = base_size,
+            .data = { ptr_add(base, size_t(offset - base_offset)), size, 1 },
+            .native_mapping = 0
+        };
+        return true;
+    }
+
+    void file_unmap(hailstorm::FileMapping& mapping) noexcept
+    {
+        if (mapping.base != nullptr)
+        {
+            ::munmap(mapping.base, mapping.base_size);
+        }
+        mapping = FileMapping{ };
+    }
+
+    void memory_advise(hailstorm::Data range, hailstorm::MemoryAdvice advice) noexcept
+    {
+        uintptr_t const page_size = uintptr_t(::sysconf(_SC_PAGESIZE));
+        uintptr_t const range_begin = reinterpret_cast<uintptr_t>(range.location);
+        uintptr_t const range_end = range_begin + range.size;
+
+        if (advice == MemoryAdvice::WillNeed)
+        {
+            // Load all pages touched by the range.
+            uintptr_t const begin = range_begin - (range_begin % page_size);
+            ::madvise(reinterpret_cast<void*>(begin), range_end - begin, MADV_WILLNEED);
+            return;
+        }
+
+        // Only release pages that are fully contained in the range, since neighbouring data may still be in use.
+        uintptr_t const begin = align_to(range_begin, uint32_t(page_size));
+        uintptr_t const end = range_end - (range_end % page_size);
+        if (begin >= end)
+        {
+            return;
+        }
+
+        if (advice == MemoryAdvice::DontNeed)
+        {
+            ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+        }
+#if defined(MADV_COLD)
+        else if (advice == MemoryAdvice::Cold)
+        {
+            ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_COLD);
+        }
+#endif
+    }
+
+#endif
+
+} // namespace hailstorm
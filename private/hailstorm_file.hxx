@@ -0,0 +1,107 @@
+#pragma once
+#include <hailstorm/hailstorm_types.hxx>
+
+namespace hailstorm
+{
+
+    //! \brief Writes the whole data block at the given file offset without changing the file position.
+    //! \note Safe to call from multiple threads on the same handle if written ranges don't overlap.
+    //! \return 'true' if all bytes where written.
+    bool file_write_at(
+        hailstorm::NativeFileHandle handle,
+        hailstorm::Data data,
+        uint64_t file_offset
+    ) noexcept;
+
+    //! \brief Reads the whole memory block from the given file offset without changing the file position.
+    //! \note Safe to call from multiple threads on the same handle.
+    //! \return 'true' if all bytes where read.
+    bool file_read_at(
+        hailstorm::NativeFileHandle handle,
+        hailstorm::Memory memory,
+        uint64_t file_offset
+    ) noexcept;
+
+    //! \brief Value returned from 'file_open' when the file could not be opened.
+    static constexpr hailstorm::NativeFileHandle Constant_InvalidFileHandle = -1;
+
+    //! \brief Flags used to open files.
+    enum class FileOpenFlags : uint32_t
+    {
+        Read = 0x0,
+        Write = 0x1,
+        Create = 0x2,
+
+        //! \brief Bypasses the system file cache using 'O_DIRECT' / 'FILE_FLAG_NO_BUFFERING' ('F_NOCACHE' on Apple platforms).
+        //! \note All read and write offsets, sizes and memory locations need to be aligned to the sector size of the device.
+        Unbuffered = 0x4,
+    };
+
+    constexpr auto operator|(FileOpenFlags left, FileOpenFlags right) noexcept -> FileOpenFlags
+    {
+        return FileOpenFlags(uint32_t(left) | uint32_t(right));
+    }
+
+    constexpr bool has_flag(FileOpenFlags value, FileOpenFlags flag) noexcept
+    {
+        return (uint32_t(value) & uint32_t(flag)) == uint32_t(flag);
+    }
+
+    //! \brief Opens a file at the given path.
+    //! \return A valid file handle or 'Constant_InvalidFileHandle'.
+    auto file_open(char const* path, FileOpenFlags flags) noexcept -> hailstorm::NativeFileHandle;
+
+    //! \brief Closes a file opened with 'file_open'.
+    void file_close(hailstorm::NativeFileHandle handle) noexcept;
+
+    //! \return The size of the file or '0' if it could not be accessed.
+    auto file_size(hailstorm::NativeFileHandle handle) noexcept -> uint64_t;
+
+    //! \brief Changes the size of the file, used to remove padding after writing with unbuffered access.
+    //! \return 'true' if the file size was changed.
+    bool file_resize(hailstorm::NativeFileHandle handle, uint64_t size) noexcept;
+
+    //! \brief A read-only view of a file mapped into memory.
+    struct FileMapping
+    {
+        //! \brief Mapped memory, starts at the page boundary preceding the requested offset.
+        void* base;
+        size_t base_size;
+
+        //! \brief Mapped data at the requested offset.
+        hailstorm::Data data;
+
+        //! \brief Platform specific mapping object, unused on POSIX.
+        hailstorm::NativeFileHandle native_mapping;
+    };
+
+    //! \brief Maps the given file range as read-only memory. Pages are loaded lazily on first access.
+    //! \return 'true' if the mapping was created.
+    bool file_map(
+        hailstorm::NativeFileHandle handle,
+        uint64_t offset,
+        size_t size,
+        hailstorm::FileMapping& out_mapping
+    ) noexcept;
+
+    //! \brief Unmaps a mapping created with 'file_map'.
+    void file_unmap(hailstorm::FileMapping& mapping) noexcept;
+
+    //! \brief Hints on expected access to mapped memory.
+    enum class MemoryAdvice : uint8_t
+    {
+        //! \brief The memory will be accessed soon and should be loaded.
+        WillNeed,
+
+        //! \brief The memory is not needed right now, but might be accessed again.
+        Cold,
+
+        //! \brief The memory is not needed and the pages can be released immediately.
+        DontNeed,
+    };
+
+    //! \brief Applies the given advice to the mapped memory range.
+    //! \note Only pages fully contained in the range are discarded, while all touched pages are loaded.
+    void memory_advise(hailstorm::Data range, hailstorm::MemoryAdvice advice) noexcept;
+
+} // namespace hailstorm
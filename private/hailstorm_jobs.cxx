@@ -0,0 +1,69 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include "hailstorm_jobs.hxx"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace hailstorm
+{
+
+    void parallel_for_builtin(
+        uint32_t job_count,
+        hailstorm::v1::HailstormParallelWriteParams::JobFn* fn_job,
+        void* job_data,
+        uint32_t worker_count
+    ) noexcept
+    {
+        if (worker_count == 0)
+        {
+            worker_count = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        // Jobs are picked from a shared counter so bigger jobs don't stall the whole batch.
+        std::atomic_uint32_t next_job = 0;
+        auto const fn_worker = [&]() noexcept
+        {
+            for (uint32_t job = next_job.fetch_add(1, std::memory_order_relaxed);
+                job < job_count;
+                job = next_job.fetch_add(1, std::memory_order_relaxed))
+            {
+                fn_job(job_data, job);
+            }
+        };
+
+        // The calling thread is also a worker
+        uint32_t const thread_count = std::min(worker_count, job_count);
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count > 0 ? thread_count - 1 : 0);
+        for (uint32_t idx = 1; idx < thread_count; ++idx)
+        {
+            threads.emplace_back(fn_worker);
+        }
+
+        fn_worker();
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    bool parallel_for(
+        hailstorm::v1::HailstormParallelWriteParams const& params,
+        uint32_t job_count,
+        hailstorm::v1::HailstormParallelWriteParams::JobFn* fn_job,
+        void* job_data
+    ) noexcept
+    {
+        if (params.fn_parallel_for != nullptr)
+        {
+            return params.fn_parallel_for(job_count, fn_job, job_data, params.parallel_userdata);
+        }
+
+        parallel_for_builtin(job_count, fn_job, job_data, params.worker_count);
+        return true;
+    }
+
+} // namespace hailstorm
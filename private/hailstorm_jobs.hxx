@@ -0,0 +1,25 @@
+#pragma once
+#include <hailstorm/hailstorm_operations.hxx>
+
+namespace hailstorm
+{
+
+    //! \brief Executes all jobs on the given number of threads and blocks until all of them are finished.
+    //! \note The calling thread is used as one of the workers. A value of '0' uses the number of hardware threads.
+    //! \note The signature is compatible with 'HailstormParallelWriteParams::JobFn' so it can be used as a fallback.
+    void parallel_for_builtin(
+        uint32_t job_count,
+        hailstorm::v1::HailstormParallelWriteParams::JobFn* fn_job,
+        void* job_data,
+        uint32_t worker_count
+    ) noexcept;
+
+    //! \brief Executes jobs using the function provided in the params or the builtin implementation as a fallback.
+    bool parallel_for(
+        hailstorm::v1::HailstormParallelWriteParams const& params,
+        uint32_t job_count,
+        hailstorm::v1::HailstormParallelWriteParams::JobFn* fn_job,
+        void* job_data
+    ) noexcept;
+
+} // namespace hailstorm
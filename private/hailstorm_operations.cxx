@@ -2,10 +2,23 @@
 /// SPDX-License-Identifier: MIT
 
 #include <hailstorm/hailstorm_operations.hxx>
+#include <hailstorm/hailstorm_arena_allocator.hxx>
 #include "hailstorm_data_writer.hxx"
 #include "hailstorm_array.hxx"
 #include "hailstorm_task.hxx"
+#include "hailstorm_paths.hxx"
+#include "hailstorm_compression.hxx"
+#include "hailstorm_write_stats.hxx"
+#include "hailstorm_chunk_planner.hxx"
+#include "hailstorm_chunk_logic.hxx"
+#include "hailstorm_deduplication.hxx"
+#include "hailstorm_relocations.hxx"
+#include "hailstorm_jobs.hxx"
+#include <algorithm>
 #include <cassert>
+#include <bit>
+#include <mutex>
+#include <new>
 
 namespace hailstorm::v1
 {
@@ -18,6 +31,8 @@ namespace hailstorm::v1
             size_t paths_info;
             size_t chunks;
             size_t resources;
+            size_t sections;
+            size_t header_size;
             size_t paths_data;
             size_t data;
         };
@@ -27,18 +42,231 @@ namespace hailstorm::v1
         {
             assert(align >= alignof(T));
             size_t const previous_size = align_to(inout_size, align);
-            inout_size += count * sizeof(T);
+            inout_size = previous_size + count * sizeof(T);
             return previous_size;
         };
 
+        //! \return Size of a single chunk index in the 'ResourceColumns' section.
+        inline auto resource_columns_index_size(uint32_t chunk_count) noexcept -> uint32_t
+        {
+            return chunk_count <= (uint32_t{ std::numeric_limits<uint16_t>::max() } + 1) ? sizeof(uint16_t) : sizeof(uint32_t);
+        }
+
+        inline auto resource_columns_size(uint32_t resource_count, uint32_t chunk_count) noexcept -> size_t
+        {
+            return size_t{ resource_count } * (sizeof(uint32_t) * 4 + resource_columns_index_size(chunk_count) * 2);
+        }
+
     } // namespace detail
 
     static constexpr size_t Constant_MetadataMinAlign = 8;
+    static constexpr size_t Constant_DataMinAlign = 8;
     static constexpr size_t Constant_MaxSupportedPackSize = std::numeric_limits<size_t>::max();
     static constexpr uint8_t Constant_U8Max = std::numeric_limits<uint8_t>::max();
     static constexpr uint32_t Constant_U32Max = std::numeric_limits<uint32_t>::max();
     static constexpr HailstormChunk Constant_EmptyChunk{ };
 
+    void reset_section_data(hailstorm::v1::HailstormData& out_hailstorm) noexcept
+    {
+        out_hailstorm.paths_index = { };
+        out_hailstorm.chunk_checksums = { };
+        out_hailstorm.chunk_resource_offsets = { };
+        out_hailstorm.chunk_resource_indices = { };
+        out_hailstorm.resource_columns = { };
+        out_hailstorm.relocation_offsets = { };
+        out_hailstorm.relocations = { };
+    }
+
+    //! \brief Reads data of all sections in 'out_hailstorm.sections' that are fully stored in the given data.
+    //! \param [in] data Pack data starting at 'data_offset' bytes from the start of the pack.
+    auto read_section_data(
+        hailstorm::Data data,
+        uint64_t data_offset,
+        hailstorm::v1::HailstormHeader const& header,
+        hailstorm::v1::HailstormData& out_hailstorm
+    ) noexcept -> hailstorm::Result
+    {
+        for (HailstormSection const& section : out_hailstorm.sections)
+        {
+            // Section data is optional, same as paths data.
+            if (section.offset < data_offset
+                || (section.offset - data_offset) > data.size
+                || (data.size - (section.offset - data_offset)) < section.size)
+            {
+                continue;
+            }
+
+            void const* const section_data = ptr_add(data.location, size_t(section.offset - data_offset));
+
+            if (section.type == HailstormSectionType::PathsIndex)
+            {
+                if (std::has_single_bit(section.count_entries) == false
+                    || section.size != sizeof(HailstormPathsIndexEntry) * section.count_entries)
+                {
+                    return Result::E_InvalidPackData;
+                }
+
+                // Entries are checked once, so lookups don't need to validate them.
+                HailstormPathsIndexEntry const* const entries = reinterpret_cast<HailstormPathsIndexEntry const*>(section_data);
+                bool valid_data = true;
+                bool has_empty_slot = false;
+                for (uint32_t idx = 0; idx < section.count_entries && valid_data; ++idx)
+                {
+                    has_empty_slot |= entries[idx].resource == Constant_HailstormInvalidIndex;
+                    valid_data = entries[idx].resource == Constant_HailstormInvalidIndex
+                        || entries[idx].resource < header.count_resources;
+                }
+                if (valid_data == false || has_empty_slot == false)
+                {
+                    return Result::E_InvalidPackData;
+                }
+
+                out_hailstorm.paths_index = std::span{ entries, section.count_entries };
+            }
+            else if (section.type == HailstormSectionType::ChunkChecksums)
+            {
+                if (section.count_entries != header.count_chunks || section.size != sizeof(uint32_t) * section.count_entries)
+                {
+                    return Result::E_InvalidPackData;
+                }
+
+                out_hailstorm.chunk_checksums = std::span{
+                    reinterpret_cast<uint32_t const*>(section_data),
+                    section.count_entries
+                };
+            }
+            else if (section.type == HailstormSectionType::ChunkResources)
+            {
+                size_t const count_offsets = size_t{ header.count_chunks } + 1;
+                if (section.count_entries != header.count_chunks
+                    || section.size != sizeof(uint32_t) * (count_offsets + header.count_resources))
+                {
+                    return Result::E_InvalidPackData;
+                }
+
+                // Offsets and indices are checked once, so lookups don't need to validate them.
+                uint32_t const* const offsets = reinterpret_cast<uint32_t const*>(section_data);
+                bool valid_data = offsets[0] == 0 && offsets[header.count_chunks] == header.count_resources;
+                for (uint32_t idx = 0; idx < header.count_chunks && valid_data; ++idx)
+                {
+                    valid_data = offsets[idx] <= offsets[idx + 1];
+                }
+                for (uint32_t idx = 0; idx < header.count_resources && valid_data; ++idx)
+                {
+                    valid_data = offsets[count_offsets + idx] < header.count_resources;
+                }
+                if (valid_data == false)
+                {
+                    return Result::E_InvalidPackData;
+                }
+
+                out_hailstorm.chunk_resource_offsets = std::span{ offsets, count_offsets };
+                out_hailstorm.chunk_resource_indices = std::span{ offsets + count_offsets, header.count_resources };
+            }
+            else if (section.type == HailstormSectionType::ResourceColumns)
+            {
+                uint32_t const index_size = detail::resource_columns_index_size(header.count_chunks);
+                if (section.count_entries != header.count_resources
+                    || section.size != detail::resource_columns_size(header.count_resources, header.count_chunks))
+                {
+                    return Result::E_InvalidPackData;
+                }
+
+                uint32_t const count = header.count_resources;
+                uint32_t const* const columns = reinterpret_cast<uint32_t const*>(section_data);
+                out_hailstorm.resource_columns = HailstormResourceColumns{
+                    .offsets = std::span{ columns, count },
+                    .sizes = std::span{ columns + count, count },
+                    .meta_offsets = std::span{ columns + count * 2, count },
+                    .meta_sizes = std::span{ columns + count * 3, count },
+                    .chunks = columns + count * 4,
+                    .meta_chunks = ptr_add(columns + count * 4, size_t{ count } * index_size),
+                    .chunk_index_size = index_size
+                };
+            }
+            else if (section.type == HailstormSectionType::Relocations)
+            {
+                size_t const count_offsets = size_t{ header.count_chunks } + 1;
+                if (section.size != detail::relocations_size(header.count_chunks, section.count_entries))
+                {
+                    return Result::E_InvalidPackData;
+                }
+
+                // Offsets are checked once, so lookups don't need to validate them.
+                uint32_t const* const offsets = reinterpret_cast<uint32_t const*>(section_data);
+                bool valid_offsets = offsets[0] == 0 && offsets[header.count_chunks] == section.count_entries;
+                for (uint32_t idx = 0; idx < header.count_chunks && valid_offsets; ++idx)
+                {
+                    valid_offsets = offsets[idx] <= offsets[idx + 1];
+                }
+                if (valid_offsets == false)
+                {
+                    return Result::E_InvalidPackData;
+                }
+
+                out_hailstorm.relocation_offsets = std::span{ offsets, count_offsets };
+                out_hailstorm.relocations = std::span{
+                    reinterpret_cast<HailstormRelocation const*>(offsets + count_offsets),
+                    section.count_entries
+                };
+            }
+        }
+        return Result::Success;
+    }
+
+    //! \brief Reads the sections table stored right after the resources table, without accessing section data.
+    auto read_sections_table(
+        hailstorm::Data data,
+        hailstorm::v1::HailstormHeader const& header,
+        size_t sections_offset,
+        hailstorm::v1::HailstormData& out_hailstorm
+    ) noexcept -> hailstorm::Result
+    {
+        // Sections are stored right after the resources table, but still need to be part of the header.
+        if (sections_offset + sizeof(HailstormSections) > header.header_size || sizeof(HailstormSections) > data.size)
+        {
+            return Result::E_InvalidPackData;
+        }
+
+        HailstormSections const* const sections_info = reinterpret_cast<HailstormSections const*>(data.location);
+        size_t const table_size = sizeof(HailstormSections) + sizeof(HailstormSection) * sections_info->count;
+        if (sections_offset + table_size > header.header_size || table_size > data.size)
+        {
+            return Result::E_InvalidPackData;
+        }
+
+        out_hailstorm.sections = std::span{ reinterpret_cast<HailstormSection const*>(sections_info + 1), sections_info->count };
+        return Result::Success;
+    }
+
+    auto read_sections(
+        hailstorm::Data data,
+        hailstorm::v1::HailstormHeader const& header,
+        void const* resources_end,
+        hailstorm::v1::HailstormData& out_hailstorm
+    ) noexcept -> hailstorm::Result
+    {
+        out_hailstorm.sections = { };
+        reset_section_data(out_hailstorm);
+        if (header.has_sections == 0)
+        {
+            return Result::Success;
+        }
+
+        size_t const sections_offset = align_to(ptr_distance(data.location, resources_end), alignof(HailstormSection));
+        hailstorm::Result const result = read_sections_table(
+            { ptr_add(data.location, sections_offset), data.size - std::min(data.size, sections_offset), 8 },
+            header,
+            sections_offset,
+            out_hailstorm
+        );
+        if (result != Result::Success)
+        {
+            return result;
+        }
+        return read_section_data(data, 0, header, out_hailstorm);
+    }
+
     auto read_header(
         hailstorm::Data data,
         hailstorm::v1::HailstormData& out_hailstorm
@@ -104,13 +332,158 @@ namespace hailstorm::v1
         {
             out_hailstorm.paths_data = Data{};
         }
+        return read_sections(data, *v1_header, resources_ptr + v1_header->count_resources, out_hailstorm);
+    }
+
+    auto read_header_layout(
+        hailstorm::Data probe_data,
+        hailstorm::v1::HailstormHeaderLayout& out_layout,
+        hailstorm::v1::HailstormData& out_hailstorm
+    ) noexcept -> hailstorm::Result
+    {
+        if (probe_data.location == nullptr)
+        {
+            return Result::E_InvalidPackData;
+        }
+        else if (probe_data.size < Constant_HailstormHeaderProbeSize)
+        {
+            return Result::E_IncompleteHeaderData;
+        }
+
+        HailstormHeader const* const header = reinterpret_cast<HailstormHeader const*>(probe_data.location);
+        if (header->magic != Constant_HailstormMagic
+            || header->header_version != Constant_HailstormHeaderVersionV0
+            || header->header_size >= Constant_1GiB
+            || header->header_size < Constant_HailstormHeaderProbeSize)
+        {
+            return Result::E_InvalidPackData;
+        }
+
+        out_hailstorm = { };
+        out_hailstorm.header = *header;
+        out_layout = HailstormHeaderLayout{ };
+        if (header->count_chunks == 0)
+        {
+            return Result::E_EmptyPack;
+        }
+
+        HailstormPaths const& paths = *reinterpret_cast<HailstormPaths const*>(header + 1);
+        out_hailstorm.paths = paths;
+
+        // Both tables are required by all other operations, so they always need to be part of the header.
+        uint64_t const chunks_size = sizeof(HailstormChunk) * uint64_t{ header->count_chunks };
+        uint64_t const resources_size = sizeof(HailstormResource) * uint64_t{ header->count_resources };
+        if (Constant_HailstormHeaderProbeSize + chunks_size + resources_size > header->header_size)
+        {
+            return Result::E_InvalidPackData;
+        }
+
+        out_layout.chunks = { Constant_HailstormHeaderProbeSize, chunks_size };
+        out_layout.resources = { out_layout.chunks.offset + chunks_size, resources_size };
+        out_layout.paths = { paths.offset, paths.size };
+
+        if (header->has_sections != 0)
+        {
+            uint64_t const table_offset = align_to(out_layout.resources.offset + resources_size, alignof(HailstormSection));
+            out_layout.sections_table = { table_offset, header->header_size - std::min<uint64_t>(table_offset, header->header_size) };
+
+            // Section data is stored after the header and paths data, up to the first chunk.
+            uint64_t const data_offset = align_to(std::max<uint64_t>(header->header_size, paths.offset + paths.size), 8);
+            out_layout.sections_data = { data_offset, header->offset_data - std::min(data_offset, header->offset_data) };
+        }
+        return Result::Success;
+    }
+
+    auto read_header_part(
+        hailstorm::v1::HailstormHeaderLayout const& layout,
+        hailstorm::v1::HailstormHeaderPart part,
+        hailstorm::Data part_data,
+        hailstorm::v1::HailstormData& inout_hailstorm
+    ) noexcept -> hailstorm::Result
+    {
+        HailstormByteRange range{ };
+        switch (part)
+        {
+        case HailstormHeaderPart::Chunks: range = layout.chunks; break;
+        case HailstormHeaderPart::Resources: range = layout.resources; break;
+        case HailstormHeaderPart::Paths: range = layout.paths; break;
+        case HailstormHeaderPart::SectionsTable: range = layout.sections_table; break;
+        case HailstormHeaderPart::SectionsData: range = layout.sections_data; break;
+        default: return Result::E_InvalidArgument;
+        }
+
+        if (range.size > 0 && (part_data.location == nullptr || part_data.size < range.size))
+        {
+            return Result::E_IncompleteHeaderData;
+        }
+
+        HailstormHeader const& header = inout_hailstorm.header;
+        if (part == HailstormHeaderPart::Chunks)
+        {
+            std::span const chunks{ reinterpret_cast<HailstormChunk const*>(part_data.location), header.count_chunks };
+
+            // Safely check (with no overflow) that we can represent the packs data offsets.
+            HailstormChunk const& last_chunk = chunks.back();
+            if ((Constant_MaxSupportedPackSize - last_chunk.offset) < last_chunk.size)
+            {
+                return Result::E_LargePackNotSupported;
+            }
+            inout_hailstorm.chunks = chunks;
+        }
+        else if (part == HailstormHeaderPart::Resources)
+        {
+            inout_hailstorm.resources = std::span{
+                reinterpret_cast<HailstormResource const*>(part_data.location),
+                header.count_resources
+            };
+        }
+        else if (part == HailstormHeaderPart::Paths)
+        {
+            inout_hailstorm.paths_data = Data{ part_data.location, range.size, 1 };
+        }
+        else if (part == HailstormHeaderPart::SectionsTable)
+        {
+            inout_hailstorm.sections = { };
+            reset_section_data(inout_hailstorm);
+            if (range.size == 0)
+            {
+                return Result::Success;
+            }
+            return read_sections_table(part_data, header, size_t(range.offset), inout_hailstorm);
+        }
+        else if (part == HailstormHeaderPart::SectionsData)
+        {
+            if (header.has_sections != 0 && inout_hailstorm.sections.data() == nullptr)
+            {
+                return Result::E_InvalidArgument;
+            }
+
+            reset_section_data(inout_hailstorm);
+            return read_section_data(part_data, range.offset, header, inout_hailstorm);
+        }
         return Result::Success;
     }
 
+    auto chunk_resources(
+        hailstorm::v1::HailstormData const& hailstorm,
+        uint32_t chunk_idx
+    ) noexcept -> std::span<uint32_t const>
+    {
+        if (size_t{ chunk_idx } + 1 >= hailstorm.chunk_resource_offsets.size())
+        {
+            return { };
+        }
+
+        uint32_t const first = hailstorm.chunk_resource_offsets[chunk_idx];
+        uint32_t const last = hailstorm.chunk_resource_offsets[chunk_idx + 1];
+        return hailstorm.chunk_resource_indices.subspan(first, last - first);
+    }
+
     auto cluster_size_info(
         uint32_t pack_slice_alignment,
         uint32_t resource_count,
         std::span<hailstorm::v1::HailstormChunk const> chunks,
+        std::span<hailstorm::v1::HailstormSection> sections,
         hailstorm::v1::HailstormPaths paths,
         hailstorm::v1::detail::Offsets& out_offsets
     ) noexcept -> size_t
@@ -121,12 +494,25 @@ namespace hailstorm::v1
         out_offsets.paths_info = detail::increase_size<HailstormPaths>(final_size);
         out_offsets.chunks = detail::increase_size<HailstormChunk>(final_size, chunks.size());
         out_offsets.resources = detail::increase_size<HailstormResource>(final_size, resource_count);
+        out_offsets.sections = 0;
+        if (sections.empty() == false)
+        {
+            out_offsets.sections = detail::increase_size<HailstormSections>(final_size, 1, alignof(HailstormSection));
+            detail::increase_size<HailstormSection>(final_size, sections.size());
+        }
+        out_offsets.header_size = final_size;
 
         // First pack slice, we align the current 'final_size' to 'pack_slice_alignment' making 'paths_data' start at the next 'pack_slice_alignment' alignment.
         out_offsets.paths_data = detail::increase_size<char>(final_size, paths.size, def_align);
 
+        // Sections data is stored in the same slice as paths so it's loaded when reading up to 'offset_data'.
+        for (HailstormSection& section : sections)
+        {
+            section.offset = detail::increase_size<char>(final_size, section.size, 8);
+        }
+
         // Second pack slice, chunk data is stored at alignment 'pack_slice_alignment' which moves 'final_size' forward until it's aligned.
-        out_offsets.data = align_to(final_size, def_align);
+        out_offsets.data = final_size = align_to(final_size, def_align);
 
         for (HailstormChunk const& chunk : chunks)
         {
@@ -136,6 +522,8 @@ namespace hailstorm::v1
         return final_size;
     }
 
+    //! \note Heuristics are called through the 'ChunkLogic' type, so the default ones can be inlined into the loop.
+    template<detail::IChunkLogic ChunkLogic>
     bool estimate_cluster_chunks(
         hailstorm::v1::HailstormWriteParams const& params,
         hailstorm::v1::HailstormWriteData const& write_data,
@@ -144,16 +532,22 @@ namespace hailstorm::v1
         hailstorm::Array<size_t>& sizes,
         hailstorm::Array<uint32_t>& metatracker,
         HailstormPaths& paths_info,
-        uint32_t res_count
+        HailstormWriteStats& stats,
+        std::span<uint32_t const> order
     ) noexcept
     {
         bool requires_data_writer_callback = false;
+        uint32_t const res_count = uint32_t(order.size());
 
         uint32_t partial_chunk_start = std::numeric_limits<uint32_t>::max();
         uint32_t partial_chunk_count = 0;
         uint32_t covered_multichunk_size = 0;
-        for (uint32_t idx = 0; idx < res_count;)
+        uint32_t created_for_resource = Constant_U32Max;
+        for (uint32_t pos = 0; pos < res_count;)
         {
+            // Resources are assigned in access order, so resources accessed together end up in the same chunks.
+            uint32_t const idx = order[pos];
+
             // If the metadata is shared, check for the already assigned chunk
             uint32_t const metadata_idx = metatracker.any()
                 ? write_data.metadata_mapping[idx]
@@ -162,11 +556,18 @@ namespace hailstorm::v1
             Data const meta = write_data.metadata[metadata_idx];
             Data const data = write_data.data[idx];
 
+            // Deduplicated data is already stored in a chunk and does not require additional space.
+            bool const shared_data = detail::is_deduplicated(write_data, idx);
+            size_t const data_size = shared_data ? 0 : data.size;
+
             // Check if even one data object is not provided.
-            requires_data_writer_callback |= data.location == nullptr;
+            requires_data_writer_callback |= data.location == nullptr && shared_data == false;
+
+            // Relocations are applied to each chunk separately, so relocated resources are never split over partial chunks.
+            bool const splittable_data = detail::has_relocations(write_data, idx) == false;
 
             // Get the selected chunks for the data and metadata.
-            HailstormWriteChunkRef ref = params.fn_select_chunk(meta, data, chunks, partial_chunk_start, partial_chunk_count, params.userdata);
+            HailstormWriteChunkRef ref = ChunkLogic::select_chunk(params, meta, data, chunks, partial_chunk_start, partial_chunk_count);
 
             bool shared_metadata = false;
             if (ref.data_create == false && ref.meta_create == false)
@@ -180,33 +581,48 @@ namespace hailstorm::v1
                     if (metatracker[metadata_idx] != Constant_U32Max)
                     {
                         shared_metadata = true;
-                        ref.meta_chunk = refs[metadata_idx].meta_chunk;
+                        ref.meta_chunk = refs[metatracker[metadata_idx]].meta_chunk;
                     }
                 }
 
-                size_t const data_remaining = covered_multichunk_size + ((chunks[ref.data_chunk].size - sizes[ref.data_chunk]) - static_cast<size_t>(data.align));
-                size_t const meta_remaining = (chunks[ref.meta_chunk].size - sizes[ref.meta_chunk]) - Constant_MetadataMinAlign;
+                // Shared metadata is already stored in a chunk and does not require additional space.
+                size_t const meta_size = shared_metadata ? 0 : meta.size;
+                size_t const data_capacity = covered_multichunk_size + chunks[ref.data_chunk].size;
 
                 // Check if we need to create a new chunk due to size restrictions.
+                //   Entries are placed the same way as when writing, metadata first and both at their minimal alignment.
                 if (ref.data_chunk == ref.meta_chunk)
                 {
-                    ref.data_create |= (data_remaining - meta.size) < data.size;
+                    size_t const meta_end = align_to(sizes[ref.meta_chunk], Constant_MetadataMinAlign) + meta_size;
+                    ref.data_create |= (align_to(meta_end, Constant_DataMinAlign) + data_size) > data_capacity;
                     ref.meta_create = false; // We only want to create one chunk if both data and meta are the same.
                 }
                 else
                 {
-                    ref.data_create |= data_remaining < data.size;
-                    ref.meta_create |= meta_remaining < meta.size;
+                    // Shared metadata is placed only once, so only the data needs to fit into the selected chunk.
+                    size_t const meta_end = align_to(sizes[ref.meta_chunk], Constant_MetadataMinAlign) + meta_size;
+                    ref.data_create |= (align_to(sizes[ref.data_chunk], Constant_DataMinAlign) + data_size) > data_capacity;
+                    ref.meta_create |= shared_metadata == false && meta_end > chunks[ref.meta_chunk].size;
                 }
             }
 
+            // A chunk was already created for this resource, but it might still fail the size check due to alignment.
+            //   In such a case we store the resource in the selected chunk and let it grow instead of creating chunks endlessly.
+            if (created_for_resource == idx && partial_chunk_count == 0)
+            {
+                ref.data_create = false;
+            }
+
+            bool data_chunk_created = false;
             while (ref.data_create)
             {
+                // Chunks can be already full or even bigger than their size, if they store a resource that can't be split.
                 HailstormChunk const& prev_chunk = chunks[ref.data_chunk];
-                if (prev_chunk.flags > 0) // If we can hold partial data...
+                size_t const used_size = align_to(sizes[ref.data_chunk], Constant_DataMinAlign);
+                if (prev_chunk.flags > 0 && splittable_data && used_size < prev_chunk.size) // If we can hold partial data...
                 {
                     // We use all the remaining size of the current chunk before creating the next one.
-                    covered_multichunk_size += (prev_chunk.size - sizes[ref.data_chunk]);
+                    covered_multichunk_size += uint32_t(prev_chunk.size - used_size);
 
                     if (partial_chunk_count == 0)
                     {
@@ -215,9 +631,7 @@ namespace hailstorm::v1
                     partial_chunk_count += 1;
                 }
 
-                HailstormChunk new_chunk = params.fn_create_chunk(
-                    meta, data, chunks[ref.data_chunk], params.userdata
-                );
+                HailstormChunk new_chunk = ChunkLogic::create_chunk(params, meta, data, chunks[ref.data_chunk]);
                 new_chunk.offset = 0;
                 new_chunk.count_entries = 0;
 
@@ -226,9 +640,9 @@ namespace hailstorm::v1
                     new_chunk.flags == 0 || (new_chunk.type == 2 || new_chunk.type == 0)
                 );
 
-                // Either mixed or data only chunks
+                // Either mixed or data only chunks, mixed chunks only hold data if the metadata is already stored in another chunk.
                 assert(
-                    (ref.data_chunk == ref.meta_chunk && new_chunk.type == 3)
+                    ((ref.data_chunk == ref.meta_chunk || shared_metadata) && new_chunk.type == 3)
                     || (new_chunk.type == 2)
                 );
 
@@ -242,11 +656,15 @@ namespace hailstorm::v1
                 // Push the new chunk
                 chunks.push_back(new_chunk);
                 sizes.push_back(0);
+                stats.count_created_chunks += 1;
+                data_chunk_created = true;
 
                 // Unless the covered size along with the new chunk size are big enough to hold the data object, we continue creating chunks.
-                ref.data_create = covered_multichunk_size + new_chunk.size < data.size;
+                //   Resources that can't be split are stored in the new chunk, which grows to fit the data if necessary.
+                ref.data_create = splittable_data && covered_multichunk_size + new_chunk.size < data_size;
                 ref.data_chunk += uint32_t(ref.data_create); // +1 (if we continue adding chunks)
-                assert((ref.data_chunk + 1) == chunks.count()); // TODO: Allow adding continous chunks not only at the end of the chunk list.
+                // The new chunk is always the last one, 'data_chunk' points to it only if we continue adding chunks.
+                assert((ref.data_chunk + 1 + uint32_t(ref.data_create == false)) == chunks.count()); // TODO: Allow adding continous chunks not only at the end of the chunk list.
 
                 // It would be impossible to cover the data object if chunks would not allow for partial data allocation.
                 assert(ref.data_create == false || new_chunk.flags > 0);
@@ -255,9 +673,7 @@ namespace hailstorm::v1
             if (ref.meta_create)
             {
                 assert(shared_metadata == false);
-                HailstormChunk new_chunk = params.fn_create_chunk(
-                    meta, data, chunks[ref.meta_chunk], params.userdata
-                );
+                HailstormChunk new_chunk = ChunkLogic::create_chunk(params, meta, data, chunks[ref.meta_chunk]);
 
                 // Meta only chunks
                 assert(new_chunk.type == 1);
@@ -272,12 +688,22 @@ namespace hailstorm::v1
 
                 // Push the new chunk
                 chunks.push_back(new_chunk);
+                sizes.push_back(0);
+                stats.count_created_chunks += 1;
+            }
+
+            // Data spanning multiple chunks starts in the first partial chunk.
+            if (partial_chunk_count > 0)
+            {
+                ref.data_chunk = partial_chunk_start;
             }
 
-            // If chunks where created, re-do the selection
-            if (ref.data_create || ref.meta_create)
+            // If chunks where created, re-do the selection. Partial chunks are already assigned to the resource.
+            if ((data_chunk_created && partial_chunk_count == 0) || ref.meta_create)
             {
                 // We don't want to increase the index yet
+                created_for_resource = idx;
+                stats.count_selection_retries += 1;
                 continue;
             }
 
@@ -295,13 +721,16 @@ namespace hailstorm::v1
             assert(chunks[ref.data_chunk].type & 0x2); // Data capable chunks
             assert(chunks[ref.meta_chunk].type & 0x1); // Meta capable chunks
 
-            chunks[ref.data_chunk].count_entries += 1;
+            if (shared_data == false)
+            {
+                chunks[ref.data_chunk].count_entries += 1;
+            }
 
             // Udpate the sizes array, however only update meta if it's not shared (not assigned to a chunk yet)
             if (shared_metadata == false)
             {
                 // Add an entry to a meta chunk only if it's not duplicated and if it's not mixed
-                if (ref.data_chunk != ref.meta_chunk)
+                if (ref.data_chunk != ref.meta_chunk || shared_data)
                 {
                     chunks[ref.meta_chunk].count_entries += 1;
                 }
@@ -310,16 +739,23 @@ namespace hailstorm::v1
             }
 
             // Once we enabled partial chunks, we are forced to save the current data in the first partial chunk with data available.
-            if (partial_chunk_count > 0)
+            if (shared_data)
+            {
+                assert(partial_chunk_count == 0);
+            }
+            else if (partial_chunk_count > 0)
             {
                 assert(partial_chunk_start == ref.data_chunk);
-                uint32_t const partial_chunk_end = partial_chunk_start + partial_chunk_count;
+
+                // The last created chunk is not counted as partial, but holds the remaining data.
+                uint32_t const partial_chunk_end = partial_chunk_start + partial_chunk_count + 1;
 
                 size_t remaining_data_size = data.size;
                 while(remaining_data_size > 0)
                 {
+                    assert(ref.data_chunk < partial_chunk_end);
                     size_t const chunk_size = chunks[ref.data_chunk].size;
-                    size_t const used_size = align_to(sizes[ref.data_chunk], data.align);
+                    size_t const used_size = align_to(sizes[ref.data_chunk], Constant_DataMinAlign);
                     size_t const available_size = chunk_size - used_size;
                     size_t const taken_size = std::min<size_t>(available_size, remaining_data_size);
 
@@ -333,15 +769,16 @@ namespace hailstorm::v1
             }
             else
             {
-                sizes[ref.data_chunk] = align_to(sizes[ref.data_chunk], data.align) + data.size;
+                // Data is always placed at the same minimal alignment as used when writing.
+                sizes[ref.data_chunk] = align_to(sizes[ref.data_chunk], Constant_DataMinAlign) + data.size;
             }
 
             // Calculate total size needed for all paths to be stored
             uint32_t const path_size = uint32_t(write_data.paths[idx].size());
             paths_info.size += size_t{ path_size + 1 };
 
-            // Increase index at the end
-            idx += 1;
+            // Increase position at the end
+            pos += 1;
 
             // Since we now 'allocated' chunks for this data object, we reset the 'covered' value
             partial_chunk_start = std::numeric_limits<uint32_t>::max();
@@ -349,9 +786,47 @@ namespace hailstorm::v1
             covered_multichunk_size = 0;
         }
 
+        // Deduplicated resources reference the data chunk of the resource storing the data, which might be assigned later.
+        for (uint32_t idx = 0; idx < res_count && write_data.data_mapping.empty() == false; ++idx)
+        {
+            if (detail::is_deduplicated(write_data, idx))
+            {
+                assert(write_data.data_mapping[idx] < idx);
+                refs[idx].data_chunk = refs[write_data.data_mapping[idx]].data_chunk;
+            }
+        }
+
         return requires_data_writer_callback;
     }
 
+    //! \brief Estimates the final number of chunks based on the size of the given chunk, if no estimate was provided.
+    auto estimated_chunk_count(
+        hailstorm::v1::HailstormWriteParams const& params,
+        hailstorm::v1::HailstormWriteData const& write_data,
+        hailstorm::v1::HailstormChunk const& base_chunk,
+        uint32_t current_count
+    ) noexcept -> uint32_t
+    {
+        if (params.estimated_chunk_count > 0 || base_chunk.size == 0)
+        {
+            return std::max(params.estimated_chunk_count, current_count);
+        }
+
+        size_t total_size = 0;
+        for (hailstorm::Data const& data : write_data.data)
+        {
+            total_size += data.size;
+        }
+        for (hailstorm::Data const& meta : write_data.metadata)
+        {
+            total_size += meta.size;
+        }
+
+        // Every resource creates at most one chunk, unless partial chunks are used, so we don't reserve more than that.
+        size_t const estimated_created = std::min<size_t>(total_size / base_chunk.size + 1, write_data.paths.size());
+        return current_count + uint32_t(estimated_created);
+    }
+
     bool prepare_cluster_info(
         hailstorm::v1::HailstormWriteParams const& params,
         hailstorm::v1::HailstormWriteData const& write_data,
@@ -359,16 +834,31 @@ namespace hailstorm::v1
         hailstorm::Array<HailstormWriteChunkRef>& out_chunks_refs,
         hailstorm::Array<size_t>& out_chunk_sizes,
         hailstorm::Array<uint32_t>& out_metatracker,
-        hailstorm::v1::HailstormPaths& out_paths
+        hailstorm::Array<uint32_t>& out_order,
+        hailstorm::v1::HailstormPaths& out_paths,
+        hailstorm::v1::HailstormWriteStats& out_stats,
+        hailstorm::Allocator& temp_alloc
     ) noexcept
     {
         uint32_t const res_count = uint32_t(write_data.paths.size());
         uint32_t const def_align = std::max<uint32_t>(params.pack_slice_alignment, 8);
 
-        out_chunks.reserve(params.estimated_chunk_count);
+        out_chunks.reserve(std::max(params.estimated_chunk_count, uint32_t(params.initial_chunks.size()) + 1));
         out_chunks.push_back(params.initial_chunks);
 
-        if (out_chunks.count() == 0)
+        // Initial chunks need to follow the same alignment rules as created chunks.
+        if (params.pack_slice_alignment > 0)
+        {
+            for (HailstormChunk& chunk : out_chunks)
+            {
+                chunk.align = params.pack_slice_alignment;
+                chunk.size = align_to(chunk.size, params.pack_slice_alignment);
+            }
+        }
+
+        // The bin-packing planner creates all chunks it needs by itself, so only the sequential planner requires a default one.
+        bool const bin_packing = params.chunk_planner == HailstormChunkPlanner::BinPacking;
+        if (out_chunks.count() == 0 && (bin_packing == false || res_count == 0))
         {
             HailstormChunk new_chunk = params.fn_create_chunk(
                 Data{.align = def_align}, Data{.align = def_align}, Constant_EmptyChunk, params.userdata
@@ -385,12 +875,20 @@ namespace hailstorm::v1
             }
 
             out_chunks.push_back(new_chunk);
+            out_stats.count_created_chunks += 1;
         }
 
+        // Reserve chunk arrays upfront, so they don't need to grow while chunks are created.
+        uint32_t const chunk_capacity = estimated_chunk_count(
+            params, write_data, out_chunks.any() ? out_chunks[out_chunks.count() - 1] : Constant_EmptyChunk, out_chunks.count()
+        );
+        out_chunks.reserve(chunk_capacity);
+
         // Keep an array for all final chunk references.
         out_chunks_refs.resize(res_count);
 
         // Sizes start with 0_B fill.
+        out_chunk_sizes.reserve(chunk_capacity);
         out_chunk_sizes.resize(out_chunks.count());
         out_chunk_sizes.memset(0);
 
@@ -398,10 +896,36 @@ namespace hailstorm::v1
         out_metatracker.resize(uint32_t(write_data.metadata_mapping.size()));
         out_metatracker.memset(Constant_U8Max);
 
+        // Resources are assigned and written in access order, if provided.
+        detail::resource_access_order(write_data, temp_alloc, out_order);
+
         out_paths.size = 8;
-        bool const requires_data_writer_callback = estimate_cluster_chunks(
-            params, write_data, out_chunks, out_chunks_refs, out_chunk_sizes, out_metatracker, out_paths, res_count
-        );
+        bool requires_data_writer_callback = false;
+        if (bin_packing)
+        {
+            requires_data_writer_callback = detail::plan_cluster_chunks(
+                params, write_data, temp_alloc, out_chunks, out_chunks_refs, out_chunk_sizes, out_metatracker, out_paths, out_stats
+            );
+
+            // The planner places resources by size, so only the final chunk placement can follow the access order.
+            if (write_data.access_order.empty() == false)
+            {
+                detail::order_chunks_by_access(out_order, temp_alloc, out_chunks, out_chunks_refs, out_chunk_sizes);
+            }
+        }
+        else if (detail::uses_default_chunk_logic(params))
+        {
+            // Default heuristics are called directly, avoiding two indirect calls for each resource.
+            requires_data_writer_callback = estimate_cluster_chunks<detail::DefaultChunkLogic>(
+                params, write_data, out_chunks, out_chunks_refs, out_chunk_sizes, out_metatracker, out_paths, out_stats, out_order
+            );
+        }
+        else
+        {
+            requires_data_writer_callback = estimate_cluster_chunks<detail::CallbackChunkLogic>(
+                params, write_data, out_chunks, out_chunks_refs, out_chunk_sizes, out_metatracker, out_paths, out_stats, out_order
+            );
+        }
 
         // Paths needs to be aligned to boundary of at least '8' bytes
         out_paths.size = align_to(out_paths.size, std::max<uint32_t>(def_align, 8));
@@ -417,52 +941,354 @@ namespace hailstorm::v1
         return requires_data_writer_callback;
     }
 
-    template<hailstorm::DataWriterMode WriterMode>
-    auto write_cluster_internal(
+    void collect_sections(
         hailstorm::v1::HailstormWriteParams const& params,
-        hailstorm::v1::HailstormAsyncWriteParams const& stream_params,
-        hailstorm::v1::HailstormWriteData const& write_data
-    ) noexcept -> hailstorm::Task
+        hailstorm::v1::HailstormWriteData const& write_data,
+        uint32_t resource_count,
+        uint32_t chunk_count,
+        hailstorm::Array<hailstorm::v1::HailstormSection>& out_sections
+    ) noexcept
     {
-        // TODO: assert(params.pack_slice_alignment is power of '2' or '0');
-        uint32_t const res_count = uint32_t(write_data.paths.size());
-
-        Array<HailstormChunk> chunks{ params.temp_alloc };
-        Array<HailstormWriteChunkRef> refs{ params.temp_alloc };
-        Array<size_t> sizes{ params.temp_alloc };
-        Array<uint32_t> metatracker{ params.temp_alloc };
-        HailstormPaths paths_info{ };
-        bool const requires_writer_callback = prepare_cluster_info(
-            params, write_data, chunks, refs, sizes, metatracker, paths_info
-        );
-
-        if constexpr (WriterMode == DataWriterMode::Synchronous)
+        if (params.create_paths_index)
         {
-            // Either we don't need the callback or we need to have it provided!
-            assert(requires_writer_callback == false || params.fn_resource_write != nullptr);
+            uint32_t const capacity = detail::paths_index_capacity(resource_count);
+            out_sections.push_back({
+                .offset = 0,
+                .size = sizeof(HailstormPathsIndexEntry) * capacity,
+                .type = HailstormSectionType::PathsIndex,
+                .count_entries = capacity
+            });
         }
+        if (params.create_chunk_checksums)
+        {
+            out_sections.push_back({
+                .offset = 0,
+                .size = sizeof(uint32_t) * chunk_count,
+                .type = HailstormSectionType::ChunkChecksums,
+                .count_entries = chunk_count
+            });
+        }
+        if (params.create_chunk_resources_index)
+        {
+            out_sections.push_back({
+                .offset = 0,
+                .size = sizeof(uint32_t) * (size_t{ chunk_count } + 1 + resource_count),
+                .type = HailstormSectionType::ChunkResources,
+                .count_entries = chunk_count
+            });
+        }
+        if (params.create_resource_columns)
+        {
+            out_sections.push_back({
+                .offset = 0,
+                .size = detail::resource_columns_size(resource_count, chunk_count),
+                .type = HailstormSectionType::ResourceColumns,
+                .count_entries = resource_count
+            });
+        }
+        if (write_data.relocations.empty() == false)
+        {
+            uint32_t const relocation_count = detail::count_relocations(write_data);
+            out_sections.push_back({
+                .offset = 0,
+                .size = detail::relocations_size(chunk_count, relocation_count),
+                .type = HailstormSectionType::Relocations,
+                .count_entries = relocation_count
+            });
+        }
+    }
 
-        // Calculate an estimated size for the whole cluster.
-        // TODO: This size is currently exact, but once we start compressing / encrypting this will no longer be the case.
-        detail::Offsets offsets;
-        size_t const final_cluster_size = cluster_size_info(params.pack_slice_alignment, res_count, chunks, paths_info, offsets);
-
-        // Fill-in header data
-        HailstormHeader header{
-            .offset_next = final_cluster_size,
-            .offset_data = offsets.data,
-            .version = { },
-            .is_encrypted = false,
-            .is_expansion = false,
-            .is_patch = false,
-            .is_baked = false,
+    //! \brief Fills section data, needs to be called after all chunk data was written.
+    template<typename Writer>
+    bool build_section_data(
+        Writer& writer,
+        hailstorm::v1::HailstormSection const& section,
+        hailstorm::v1::HailstormWriteData const& write_data,
+        std::span<std::string_view const> paths,
+        std::span<hailstorm::v1::HailstormChunk const> chunks,
+        std::span<hailstorm::v1::HailstormResource const> resources,
+        void* section_data
+    ) noexcept
+    {
+        if (section.type == HailstormSectionType::PathsIndex)
+        {
+            detail::build_paths_index(
+                paths, std::span{ reinterpret_cast<HailstormPathsIndexEntry*>(section_data), section.count_entries }
+            );
+            return true;
+        }
+        else if (section.type == HailstormSectionType::ChunkChecksums)
+        {
+            if constexpr (IChecksumDataWriter<Writer>)
+            {
+                return writer.chunk_checksums(chunks, std::span{ reinterpret_cast<uint32_t*>(section_data), section.count_entries });
+            }
+        }
+        else if (section.type == HailstormSectionType::ChunkResources)
+        {
+            // Counting sort, resources are visited in index order.
+            uint32_t* const offsets = reinterpret_cast<uint32_t*>(section_data);
+            uint32_t* const indices = offsets + chunks.size() + 1;
+            std::memset(offsets, 0, sizeof(uint32_t) * (chunks.size() + 1));
+            for (HailstormResource const& res : resources)
+            {
+                offsets[res.chunk + 1] += 1;
+            }
+            for (size_t idx = 1; idx <= chunks.size(); ++idx)
+            {
+                offsets[idx] += offsets[idx - 1];
+            }
+
+            // Each offset is moved to the end of it's range, which is the start of the next one.
+            for (uint32_t idx = 0; idx < resources.size(); ++idx)
+            {
+                indices[offsets[resources[idx].chunk]++] = idx;
+            }
+            std::memmove(offsets + 1, offsets, sizeof(uint32_t) * chunks.size());
+            offsets[0] = 0;
+
+            // Index order matches the order in each chunk, unless resources were written in a different access order.
+            auto const by_offset = [resources](uint32_t left, uint32_t right) noexcept
+            {
+                return resources[left].offset < resources[right].offset
+                    || (resources[left].offset == resources[right].offset && left < right);
+            };
+            for (size_t idx = 0; idx < chunks.size(); ++idx)
+            {
+                if (std::is_sorted(indices + offsets[idx], indices + offsets[idx + 1], by_offset) == false)
+                {
+                    std::sort(indices + offsets[idx], indices + offsets[idx + 1], by_offset);
+                }
+            }
+            return true;
+        }
+        else if (section.type == HailstormSectionType::ResourceColumns)
+        {
+            size_t const count = resources.size();
+            uint32_t* const columns = reinterpret_cast<uint32_t*>(section_data);
+            for (size_t idx = 0; idx < count; ++idx)
+            {
+                columns[idx] = resources[idx].offset;
+                columns[count + idx] = resources[idx].size;
+                columns[count * 2 + idx] = resources[idx].meta_offset;
+                columns[count * 3 + idx] = resources[idx].meta_size;
+            }
+
+            // Chunk columns are stored using the smallest index size able to reference all chunks.
+            void* const chunk_columns = columns + count * 4;
+            if (detail::resource_columns_index_size(uint32_t(chunks.size())) == sizeof(uint16_t))
+            {
+                uint16_t* const chunk_indices = reinterpret_cast<uint16_t*>(chunk_columns);
+                for (size_t idx = 0; idx < count; ++idx)
+                {
+                    chunk_indices[idx] = uint16_t(resources[idx].chunk);
+                    chunk_indices[count + idx] = uint16_t(resources[idx].meta_chunk);
+                }
+            }
+            else
+            {
+                uint32_t* const chunk_indices = reinterpret_cast<uint32_t*>(chunk_columns);
+                for (size_t idx = 0; idx < count; ++idx)
+                {
+                    chunk_indices[idx] = resources[idx].chunk;
+                    chunk_indices[count + idx] = resources[idx].meta_chunk;
+                }
+            }
+            return true;
+        }
+        else if (section.type == HailstormSectionType::Relocations)
+        {
+            detail::build_relocations(write_data, uint32_t(chunks.size()), resources, section_data);
+            return true;
+        }
+        return false;
+    }
+
+    //! \return The location where header data at the given offset is filled, either in the cluster memory or in the temporary memory.
+    template<typename Writer>
+    auto header_location(Writer& writer, hailstorm::Memory temp_memory, size_t offset) noexcept -> void*
+    {
+        if constexpr (IHeaderMemoryDataWriter<Writer>)
+        {
+            return writer.header_memory(offset);
+        }
+        else
+        {
+            return temp_memory.location;
+        }
+    }
+
+    //! \return A copy of the write data with 'data_mapping' and 'metadata_mapping' set to the given arrays if deduplication was requested.
+    auto deduplicate_resources(
+        hailstorm::v1::HailstormWriteParams const& params,
+        hailstorm::v1::HailstormWriteData const& write_data,
+        hailstorm::Allocator& temp_alloc,
+        hailstorm::Array<uint32_t>& out_mapping,
+        hailstorm::Array<uint32_t>& out_meta_mapping
+    ) noexcept -> hailstorm::v1::HailstormWriteData
+    {
+        hailstorm::v1::HailstormWriteData result = write_data;
+        if (params.deduplicate_data && write_data.data_mapping.empty())
+        {
+            if (detail::find_duplicated_data(write_data.data, write_data.relocations, temp_alloc, out_mapping) > 0)
+            {
+                result.data_mapping = out_mapping;
+            }
+        }
+        if (params.deduplicate_metadata && write_data.metadata_mapping.empty())
+        {
+            // Each metadata entry maps to the first entry with the same contents, which is then stored once.
+            if (detail::find_duplicated_data(write_data.metadata, { }, temp_alloc, out_meta_mapping) > 0)
+            {
+                result.metadata_mapping = out_meta_mapping;
+            }
+        }
+        return result;
+    }
+
+    //! \brief Updates the resource to reference the data stored by another resource.
+    void reference_resource_data(
+        hailstorm::v1::HailstormResource& res,
+        hailstorm::v1::HailstormResource const& source,
+        hailstorm::v1::HailstormWriteStats& stats
+    ) noexcept
+    {
+        res.chunk = source.chunk;
+        res.offset = source.offset;
+        res.size = source.size;
+        res.size_origin = source.size_origin;
+        res.compression_type = source.compression_type;
+        res.compression_level = source.compression_level;
+        res.compression_param = source.compression_param;
+
+        stats.count_deduplicated_resources += 1;
+        stats.deduplicated_size += source.size;
+    }
+
+    template<hailstorm::DataWriterMode WriterMode, typename WriterParams>
+    auto write_cluster_internal(
+        hailstorm::v1::HailstormWriteParams const& params,
+        WriterParams& writer_params,
+        hailstorm::v1::HailstormWriteData const& input_data,
+        hailstorm::Allocator& backing_temp_alloc
+    ) noexcept -> hailstorm::Task
+    {
+        // TODO: assert(params.pack_slice_alignment is power of '2' or '0');
+        uint32_t const res_count = uint32_t(input_data.paths.size());
+
+        // Checksums can only be calculated if the writer has access to the written data.
+        if constexpr (IChecksumDataWriter<DataWriter<WriterMode>> == false)
+        {
+            if (params.create_chunk_checksums)
+            {
+                co_return hailstorm::Memory{ };
+            }
+        }
+
+        // Chunks can only be encrypted if the writer has access to the written data.
+        if constexpr (IEncryptingDataWriter<DataWriter<WriterMode>> == false)
+        {
+            if (params.encryption_key != nullptr)
+            {
+                co_return hailstorm::Memory{ };
+            }
+        }
+
+        // Compressed data of all resources would be kept in memory until written, breaking the bounded memory usage.
+        if constexpr (WriterMode == DataWriterMode::Streamed)
+        {
+            if (params.compression_type != detail::Constant_CompressionNone)
+            {
+                co_return hailstorm::Memory{ };
+            }
+        }
+
+        if (detail::validate_relocations(input_data) == false)
+        {
+            co_return hailstorm::Memory{ };
+        }
+
+        // All temporary allocations go through the profiler, so it can track them if statistics are requested.
+        detail::WriteProfiler profiler{ params, backing_temp_alloc };
+        hailstorm::Allocator& temp_alloc = profiler.temp_allocator();
+
+        // Find duplicated data before compression, so each unique resource is only compressed once.
+        if (params.deduplicate_data || params.deduplicate_metadata)
+        {
+            profiler.enter(HailstormWritePhase::Deduplication);
+        }
+        Array<uint32_t> data_mapping{ temp_alloc };
+        Array<uint32_t> metadata_mapping{ temp_alloc };
+        hailstorm::v1::HailstormWriteData const deduplicated_data = deduplicate_resources(
+            params, input_data, temp_alloc, data_mapping, metadata_mapping
+        );
+
+        // Compress resources first so chunks are selected and sized based on the final data sizes.
+        profiler.enter(HailstormWritePhase::Compression);
+        detail::CompressedResources compressed{ temp_alloc };
+        if constexpr (WriterMode == DataWriterMode::Parallel)
+        {
+            if (detail::compress_resources(params, &writer_params, deduplicated_data, compressed) == false)
+            {
+                co_return hailstorm::Memory{ };
+            }
+        }
+        else if (detail::compress_resources(params, nullptr, deduplicated_data, compressed) == false)
+        {
+            co_return hailstorm::Memory{ };
+        }
+
+        hailstorm::v1::HailstormWriteData const& write_data = compressed.write_data;
+
+        profiler.enter(HailstormWritePhase::ChunkEstimation);
+        Array<HailstormChunk> chunks{ temp_alloc };
+        Array<HailstormWriteChunkRef> refs{ temp_alloc };
+        Array<size_t> sizes{ temp_alloc };
+        Array<uint32_t> metatracker{ temp_alloc };
+        Array<uint32_t> order{ temp_alloc };
+        HailstormPaths paths_info{ };
+        bool const requires_writer_callback = prepare_cluster_info(
+            params, write_data, chunks, refs, sizes, metatracker, order, paths_info, profiler.stats, temp_alloc
+        );
+        profiler.prepare_chunks(chunks.count());
+
+        if constexpr (WriterMode != DataWriterMode::Asynchronous)
+        {
+            // Either we don't need the callback or we need to have it provided!
+            assert(requires_writer_callback == false || params.fn_resource_write != nullptr);
+        }
+
+        // Collect all optional sections, data is filled after all resources are written.
+        Array<HailstormSection> sections{ temp_alloc };
+        collect_sections(params, write_data, res_count, chunks.count(), sections);
+
+        // Calculate the size for the whole cluster.
+        // NOTE: This size is exact since data is compressed before chunks are sized.
+        detail::Offsets offsets;
+        size_t const final_cluster_size = cluster_size_info(
+            params.pack_slice_alignment, res_count, chunks, sections, paths_info, offsets
+        );
+
+        // Fill-in header data
+        HailstormHeader header{
+            .offset_next = final_cluster_size,
+            .offset_data = offsets.data,
+            .version = { },
+            .is_encrypted = params.encryption_key != nullptr,
+            .is_expansion = params.is_expansion,
+            .is_patch = params.is_patch,
+            .is_baked = params.is_baked,
+            .has_sections = sections.any(),
             .count_chunks = chunks.count(),
             .count_resources = res_count,
-            .pack_slice_alignment = params.pack_slice_alignment
+            .pack_slice_alignment = params.pack_slice_alignment,
+            .pack_id = params.pack_id,
+            .pack_expansion_ver = params.pack_expansion_ver,
+            .pack_patch_ver = params.pack_patch_ver
         };
         header.magic = Constant_HailstormMagic;
         header.header_version = Constant_HailstormHeaderVersionV0;
-        header.header_size = offsets.resources + sizeof(hailstorm::v1::HailstormResource) * header.count_resources;
+        header.header_size = offsets.header_size;
         paths_info.offset = offsets.paths_data;
 
         // Copy custom values into the final header.
@@ -483,38 +1309,51 @@ namespace hailstorm::v1
         {
             if constexpr (WriterMode == DataWriterMode::Asynchronous)
             {
-                return DataWriter<WriterMode>{ stream_params, final_cluster_size };
+                return DataWriter<WriterMode>{ writer_params, final_cluster_size };
+            }
+            else if constexpr (WriterMode == DataWriterMode::Streamed)
+            {
+                return DataWriter<WriterMode>{ writer_params, temp_alloc, final_cluster_size };
+            }
+            else if constexpr (WriterMode == DataWriterMode::Segments)
+            {
+                return DataWriter<WriterMode>{
+                    writer_params, temp_alloc, write_data, data_view(compressed.memory), chunks, offsets.data, final_cluster_size
+                };
             }
             else
             {
-                return DataWriter<WriterMode>{ params, params.cluster_alloc, final_cluster_size };
+                return DataWriter<WriterMode>{ writer_params, params.cluster_alloc, final_cluster_size };
             }
         }();
 
         // Copy over all chunk data
+        profiler.enter(HailstormWritePhase::Header);
         co_await writer.write_header(data_view(header), 0);
         co_await writer.write_header(data_view(paths_info), offsets.paths_info);
         co_await writer.write_header(chunks.data_view(), offsets.chunks);
 
-        // Prepare temporary data for resources and paths
-        TrackedMemory temp_resource_mem{ params.temp_alloc, sizeof(HailstormResource) * res_count };
-        TrackedMemory temp_paths_mem{ params.temp_alloc, paths_info.size };
+        // Prepare temporary data for resources and paths, unless the writer allows to fill them in place.
+        constexpr bool header_in_place = IHeaderMemoryDataWriter<decltype(writer)>;
+        TrackedMemory temp_resource_mem{ temp_alloc, header_in_place ? 0 : sizeof(HailstormResource) * res_count };
+        TrackedMemory temp_paths_mem{ temp_alloc, header_in_place ? 0 : paths_info.size };
 
         HailstormResource* const pack_resources = reinterpret_cast<HailstormResource*>(
-            temp_resource_mem.location
+            header_location(writer, temp_resource_mem, offsets.resources)
         );
 
         uint32_t paths_offset = 0;
         char* const paths_data = reinterpret_cast<char*>(
-            temp_paths_mem.location
+            header_location(writer, temp_paths_mem, offsets.paths_data)
         );
 
         // Clear sizes
         sizes.memset(0);
         metatracker.memset(Constant_U8Max);
 
-        // We now go over the list again, this time already filling data in.
-        for (uint32_t idx = 0; idx < res_count; ++idx)
+        // We now go over the list again in the same order, this time already filling data in.
+        profiler.enter(HailstormWritePhase::ResourceData);
+        for (uint32_t const idx : order)
         {
             HailstormResource& res = pack_resources[idx];
             res.chunk = refs[idx].data_chunk;
@@ -546,8 +1385,9 @@ namespace hailstorm::v1
                     write_data, meta_idx, meta_chunk.offset + meta_chunk_used
                 );
 
-                // Need to update the 'used' variable after we wrote the metadata
-                meta_chunk_used = align_to(meta_chunk_used + data.size, meta_chunk.align);
+                // Need to update the 'used' variable after we wrote the metadata, same alignment as used when estimating.
+                meta_chunk_used = align_to(meta_chunk_used + data.size, Constant_MetadataMinAlign);
+                profiler.add_chunk_data(res.meta_chunk, data.size);
             }
             else
             {
@@ -555,6 +1395,14 @@ namespace hailstorm::v1
                 res.meta_offset = pack_resources[meta_map_idx].meta_offset;
             }
 
+            // Deduplicated resources are updated after all resource data was written.
+            if (detail::is_deduplicated(write_data, idx))
+            {
+                assert(write_data.data_mapping[idx] < idx);
+                assert(write_data.data_mapping[write_data.data_mapping[idx]] == write_data.data_mapping[idx]);
+                continue;
+            }
+
 #if 0
             {
                 size_t& data_chunk_used = sizes[res.chunk];
@@ -580,6 +1428,20 @@ namespace hailstorm::v1
                 // Store data location
                 res.size = uint32_t(data.size); // set the whole size, even when stored across multiple chunks
                 res.offset = uint32_t(sizes[res.chunk]); // offset in the initial chunk
+                res.size_origin = res.size;
+                res.compression_type = 0;
+                res.compression_level = 0;
+                res.compression_param = 0;
+
+                // Resources compressed by the builtin stage, keep the compression details.
+                if (compressed.info.any())
+                {
+                    HailstormWriteCompressionInfo const& info = compressed.info[idx];
+                    res.size_origin = info.origin_size;
+                    res.compression_type = info.compression_type;
+                    res.compression_level = info.compression_level;
+                    res.compression_param = info.compression_param;
+                }
 
                 size_t data_remaining = data.size;
                 uint32_t write_chunk = res.chunk;
@@ -594,47 +1456,49 @@ namespace hailstorm::v1
                     size_t const data_chunk_written = std::min(data_chunk_available, data_remaining);
 
                     data_remaining -= data_chunk_written;
-                    data_chunk_used = align_to(data_chunk_used + data_chunk_written, 8);
+                    data_chunk_used = align_to(data_chunk_used + data_chunk_written, Constant_DataMinAlign);
+                    profiler.add_chunk_data(write_chunk, data_chunk_written);
 
                     write_chunk += 1;
                 }
 
-                hailstorm::v1::HailstormWriteInfo write_info{
-                    .resource_index = idx,
-                    .compression = { .compression_type = 0, .origin_size = res.size }
-                };
+                // Relocations are applied to each loaded chunk separately, so relocated values can't be stored across chunks.
+                co_await DataWriterStage{ write_chunk <= res.chunk + 1 || detail::has_relocations(write_data, idx) == false };
 
-                co_await writer.write_resource(
-                    write_data, write_info, chunks[res.chunk].offset + res.offset
-                );
+                // The parallel writer handles all resources at once after their locations are known.
+                if constexpr (WriterMode != DataWriterMode::Parallel)
+                {
+                    hailstorm::v1::HailstormWriteInfo write_info = initial_write_info(idx, res);
 
-                // Unless compressed, 'origin_size' needs to equal 'size' but we don't care about the compressed size and how it compares to the uncompressed version.
-                assert(res.compression_type != 0 || res.size == write_info.compression.origin_size);
+                    co_await writer.write_resource(
+                        write_data, write_info, chunks[res.chunk].offset + res.offset
+                    );
 
-                // Copy over all compression information.
-                res.compression_type = write_info.compression.compression_type;
-                res.compression_level = write_info.compression.compression_level;
-                res.compression_param = write_info.compression.compression_param;
-                res.size_origin = write_info.compression.origin_size;
+                    apply_write_info(res, write_info);
+                }
 
                 // Ensure the data view has an alignment smaller or equal to the chunk alignment.
-                assert(data.align <= 8);
+                assert(data.align <= Constant_DataMinAlign);
             }
 #endif
+        }
 
-            {
-                res.path_size = uint32_t(write_data.paths[idx].size());
-                res.path_offset = paths_offset;
+        if constexpr (WriterMode == DataWriterMode::Parallel)
+        {
+            co_await writer.write_resources(write_data, chunks, std::span{ pack_resources, res_count });
+        }
 
-                // Copy and increment the offset with an '\0' character added.
-                size_t const path_size = size_t{ res.path_size };
-                std::memcpy(paths_data + paths_offset, write_data.paths[idx].data(), write_data.paths[idx].size());
-                paths_offset += res.path_size + 1;
-                paths_data[paths_offset - 1] = '\0';
+        // The compression details of resources written using callbacks are only known now.
+        for (uint32_t idx = 0; idx < res_count && write_data.data_mapping.empty() == false; ++idx)
+        {
+            if (detail::is_deduplicated(write_data, idx))
+            {
+                reference_resource_data(pack_resources[idx], pack_resources[write_data.data_mapping[idx]], profiler.stats);
             }
         }
 
         // Write all custom chunks
+        profiler.enter(HailstormWritePhase::CustomChunks);
         auto it = chunks.begin();
         auto const end = chunks.end();
         while(it != end && it->type == 0)
@@ -643,13 +1507,94 @@ namespace hailstorm::v1
             it += 1;
         }
 
+        // Encrypt all chunks after their data was written, checksums are calculated from the encrypted data.
+        if constexpr (IEncryptingDataWriter<decltype(writer)>)
+        {
+            if (params.encryption_key != nullptr)
+            {
+                profiler.enter(HailstormWritePhase::Encryption);
+                co_await DataWriterStage{ writer.encrypt_chunks(chunks, *params.encryption_key) };
+            }
+        }
+
+        // Copy all paths, each followed by an '\0' character.
+        profiler.enter(HailstormWritePhase::Paths);
+        for (uint32_t idx = 0; idx < res_count; ++idx)
+        {
+            HailstormResource& res = pack_resources[idx];
+            res.path_size = uint32_t(write_data.paths[idx].size());
+            res.path_offset = paths_offset;
+
+            // Resources replacing another resource by index store the index instead of the path location.
+            if (write_data.replaced_resources.empty() == false
+                && write_data.replaced_resources[idx] != Constant_HailstormInvalidIndex)
+            {
+                res.path_size = 0;
+                res.path_offset = write_data.replaced_resources[idx];
+            }
+
+            std::memcpy(paths_data + paths_offset, write_data.paths[idx].data(), write_data.paths[idx].size());
+            paths_offset += uint32_t(write_data.paths[idx].size() + 1);
+            paths_data[paths_offset - 1] = '\0';
+        }
+
         // Clear the final bytes required to be zeroed in the paths block
         std::memset(ptr_add(paths_data, paths_offset), 0, paths_info.size - paths_offset);
 
+        // Write all sections, memory is kept until the end since writes might still be pending.
+        profiler.enter(HailstormWritePhase::Sections);
+        HailstormSections const sections_info{ .count = sections.count(), ._unused4B = 0 };
+        size_t sections_data_size = 0;
+        for (HailstormSection const& section : sections)
+        {
+            sections_data_size = align_to(sections_data_size + section.size, 8);
+        }
+
+        TrackedMemory sections_mem{ temp_alloc, header_in_place ? 0 : sections_data_size };
+        if (sections.any())
+        {
+            co_await writer.write_header(data_view(sections_info), offsets.sections);
+            co_await writer.write_header(sections.data_view(), offsets.sections + sizeof(HailstormSections));
+
+            size_t section_data_offset = 0;
+            for (HailstormSection const& section : sections)
+            {
+                void* const section_data = header_in_place
+                    ? header_location(writer, sections_mem, section.offset)
+                    : ptr_add(sections_mem.location, section_data_offset);
+                co_await DataWriterStage{
+                    build_section_data(
+                        writer, section, write_data, write_data.paths, chunks, std::span{ pack_resources, res_count }, section_data
+                    )
+                };
+                if constexpr (header_in_place == false)
+                {
+                    co_await writer.write_header({ section_data, section.size, 8 }, section.offset);
+                }
+                section_data_offset = align_to(section_data_offset + section.size, 8);
+            }
+        }
+
         // Write final memory information
-        co_await writer.write_header(data_view(temp_paths_mem), offsets.paths_data);
-        co_await writer.write_header(data_view(temp_resource_mem), offsets.resources);
-        co_return writer.finalize();
+        profiler.enter(HailstormWritePhase::Header);
+        if constexpr (header_in_place == false)
+        {
+            co_await writer.write_header(data_view(temp_paths_mem), offsets.paths_data);
+            co_await writer.write_header(data_view(temp_resource_mem), offsets.resources);
+        }
+
+        // All memory passed to the writer needs to be valid until pending writes are finished.
+        if constexpr (WriterMode == DataWriterMode::Asynchronous)
+        {
+            co_await writer.wait_pending();
+        }
+
+        hailstorm::Memory const result = writer.finalize();
+        if (result.size > 0)
+        {
+            profiler.report(chunks, final_cluster_size);
+        }
+        co_return result;
     }
 
     auto write_cluster(
@@ -659,10 +1604,10 @@ namespace hailstorm::v1
     {
         uint32_t const count_ids = uint32_t(data.paths.size());
         assert(count_ids == data.data.size());
+        assert(data.data_mapping.empty() || count_ids == data.data_mapping.size());
         assert(count_ids == data.metadata.size() || count_ids <= data.metadata_mapping.size());
 
-        HailstormAsyncWriteParams async_params_empty{ .base_params = params };
-        return write_cluster_internal<DataWriterMode::Synchronous>(params, async_params_empty, data).result_memory();
+        return write_cluster_internal<DataWriterMode::Synchronous>(params, params, data, params.temp_alloc).result_memory();
     }
 
     bool write_cluster_async(
@@ -672,73 +1617,894 @@ namespace hailstorm::v1
     {
         uint32_t const count_ids = uint32_t(data.paths.size());
         assert(count_ids == data.data.size());
+        assert(data.data_mapping.empty() || count_ids == data.data_mapping.size());
         assert(count_ids == data.metadata.size() || count_ids <= data.metadata_mapping.size());
 
-        write_cluster_internal<DataWriterMode::Asynchronous>(params.base_params, params, data);
-        return true;
+        HailstormAsyncWriteCompletion completion{ params };
+        bool success = false;
+        {
+            hailstorm::Task task = write_cluster_internal<DataWriterMode::Asynchronous>(
+                params.base_params, completion, data, params.base_params.temp_alloc
+            );
+
+            // The coroutine suspends when waiting for pending writes, we resume it on this thread once it can continue.
+            while (task == false && hailstorm::detail::async_write_resume(completion))
+            {
+                task.resume();
+            }
+
+            // Even if the operation failed, some writes might still reference memory owned by the coroutine.
+            hailstorm::detail::async_write_wait_idle(completion);
+            success = task && completion.failed == false;
+        }
+
+        if (completion.opened)
+        {
+            success &= params.fn_async_close(params.async_userdata);
+        }
+        return success;
     }
 
-    auto prefixed_resource_paths_size(
-        hailstorm::v1::HailstormPaths const& paths_info,
-        uint32_t count_resources,
-        std::string_view prefix
-    ) noexcept -> size_t
+    void complete_async_write(
+        hailstorm::v1::HailstormAsyncWriteCompletion* completion,
+        bool success
+    ) noexcept
     {
-        size_t const extended_size = { count_resources * prefix.size() };
-        return paths_info.size + extended_size;
+        assert(completion != nullptr && completion->pending > 0);
+
+        // Notify while holding the lock, the completion object might be destroyed as soon as it's released.
+        std::lock_guard lock{ completion->mutex };
+        completion->pending -= 1;
+        completion->failed |= success == false;
+        completion->cv_completed.notify_all();
     }
 
-    bool prefix_resource_paths(
-        hailstorm::v1::HailstormPaths const& paths_info,
-        std::span<hailstorm::v1::HailstormResource> resources,
-        hailstorm::Memory paths_data,
-        std::string_view prefix
+    auto write_cluster_parallel(
+        hailstorm::v1::HailstormParallelWriteParams const& params,
+        hailstorm::v1::HailstormWriteData const& data
+    ) noexcept -> hailstorm::Memory
+    {
+        uint32_t const count_ids = uint32_t(data.paths.size());
+        assert(count_ids == data.data.size());
+        assert(data.data_mapping.empty() || count_ids == data.data_mapping.size());
+        assert(count_ids == data.metadata.size() || count_ids <= data.metadata_mapping.size());
+
+        return write_cluster_internal<DataWriterMode::Parallel>(
+            params.base_params, params, data, params.base_params.temp_alloc
+        ).result_memory();
+    }
+
+    bool write_clusters(
+        hailstorm::v1::HailstormBatchWriteParams const& params,
+        std::span<hailstorm::v1::HailstormWriteData const> clusters,
+        std::span<hailstorm::Memory> out_clusters
     ) noexcept
     {
-        size_t const count_resources = resources.size();
-        size_t const size_extended_paths = prefixed_resource_paths_size(
-            paths_info, count_resources, prefix
-        );
-        if (size_extended_paths > paths_data.size)
+        assert(out_clusters.size() >= clusters.size());
+        for (hailstorm::v1::HailstormWriteData const& data : clusters)
         {
-            return false;
+            uint32_t const count_ids = uint32_t(data.paths.size());
+            assert(count_ids == data.data.size());
+            assert(data.data_mapping.empty() || count_ids == data.data_mapping.size());
+            assert(count_ids == data.metadata.size() || count_ids <= data.metadata_mapping.size());
         }
 
-        size_t const size_prefix = prefix.size();
-        size_t const size_extending = size_prefix * count_resources;
-
-        // We find the first non '0' character. The .hsc ensures the last few bytes in the pats chunk are zeros.
-        char* const paths_start = reinterpret_cast<char*>(paths_data.location);
-        char* paths_end = paths_start + paths_info.size;
-        char* ex_paths_end = paths_end + size_extending;
-        while (paths_end[-1] == '\0')
+        // All clusters would be encrypted using the same key and nonce, reusing the keystream.
+        if (params.base_params.encryption_key != nullptr)
         {
-            paths_end -= 1;
-            ex_paths_end -= 1;
+            for (hailstorm::Memory& cluster : out_clusters.first(clusters.size()))
+            {
+                cluster = { };
+            }
+            return false;
         }
 
-        // Iterate over each resource, update it's path (from last to first)
-        uint32_t resource_idx;
-        for (resource_idx = count_resources; ex_paths_end > paths_start && resource_idx > 0; --resource_idx)
+        struct JobData
         {
-            v1::HailstormResource& res = resources[resource_idx - 1];
-            *ex_paths_end = '\0';
+            hailstorm::v1::HailstormBatchWriteParams const& params;
+            std::span<hailstorm::v1::HailstormWriteData const> clusters;
+            std::span<hailstorm::Memory> out_clusters;
+            std::atomic_bool failed;
 
-            ex_paths_end -= res.path_size;
-            std::memcpy(ex_paths_end, paths_start + res.path_offset, res.path_size);
+            //! \brief Arenas not used by any job, new arenas are only created if all existing ones are in use.
+            std::mutex arenas_mutex;
+            hailstorm::Array<hailstorm::v1::ArenaAllocator*> arenas;
+            hailstorm::Array<hailstorm::v1::ArenaAllocator*> free_arenas;
 
-            ex_paths_end -= size_prefix;
-            std::memcpy(ex_paths_end, prefix.data(), size_prefix);
+            auto acquire_arena() noexcept -> hailstorm::v1::ArenaAllocator*
+            {
+                std::lock_guard lock{ arenas_mutex };
+                if (free_arenas.any())
+                {
+                    hailstorm::v1::ArenaAllocator* const arena = free_arenas[free_arenas.count() - 1];
+                    free_arenas.resize(free_arenas.count() - 1);
+                    return arena;
+                }
 
-            // Update resource path information
-            res.path_offset = ptr_distance<uint32_t>(paths_start, ex_paths_end);
-            res.path_size += size_prefix;
-            ex_paths_end -= 1;
-        }
+                hailstorm::Allocator& alloc = params.base_params.temp_alloc;
+                hailstorm::Memory const memory = alloc.allocate(sizeof(hailstorm::v1::ArenaAllocator));
+                if (memory.location == nullptr)
+                {
+                    return nullptr;
+                }
 
-        // Ensure we finished at the proper location
-        assert((ex_paths_end + 1) == paths_start);
+                hailstorm::v1::ArenaAllocator* const arena = new (memory.location) hailstorm::v1::ArenaAllocator{
+                    alloc, params.arena_block_size
+                };
+                arenas.push_back(arena);
+                return arena;
+            }
+
+            void release_arena(hailstorm::v1::ArenaAllocator* arena) noexcept
+            {
+                arena->reset();
+
+                std::lock_guard lock{ arenas_mutex };
+                free_arenas.push_back(arena);
+            }
+        };
+
+        // Clusters of jobs that where not executed stay empty.
+        for (hailstorm::Memory& cluster : out_clusters)
+        {
+            cluster = { };
+        }
+
+        // Each job writes a whole cluster, so clusters are planned and written at the same time.
+        auto const fn_job = [](void* job_data, uint32_t job_index) noexcept
+        {
+            JobData& job = *reinterpret_cast<JobData*>(job_data);
+            hailstorm::v1::ArenaAllocator* const arena = job.acquire_arena();
+            if (arena == nullptr)
+            {
+                job.out_clusters[job_index] = { };
+                job.failed.store(true, std::memory_order_relaxed);
+                return;
+            }
+
+            hailstorm::v1::HailstormWriteParams const& base_params = job.params.base_params;
+            job.out_clusters[job_index] = write_cluster_internal<DataWriterMode::Synchronous>(
+                base_params, base_params, job.clusters[job_index], *arena
+            ).result_memory();
+            job.release_arena(arena);
+
+            if (job.out_clusters[job_index].location == nullptr)
+            {
+                job.failed.store(true, std::memory_order_relaxed);
+            }
+        };
+
+        JobData job_data{
+            .params = params,
+            .clusters = clusters,
+            .out_clusters = out_clusters,
+            .failed = false,
+            .arenas_mutex = { },
+            .arenas = { params.base_params.temp_alloc },
+            .free_arenas = { params.base_params.temp_alloc },
+        };
+
+        bool executed = true;
+        if (params.fn_parallel_for != nullptr)
+        {
+            executed = params.fn_parallel_for(uint32_t(clusters.size()), fn_job, &job_data, params.parallel_userdata);
+        }
+        else
+        {
+            parallel_for_builtin(uint32_t(clusters.size()), fn_job, &job_data, params.worker_count);
+        }
+
+        for (hailstorm::v1::ArenaAllocator* arena : job_data.arenas)
+        {
+            arena->~ArenaAllocator();
+            params.base_params.temp_alloc.deallocate(arena);
+        }
+        return executed && job_data.failed.load(std::memory_order_relaxed) == false;
+    }
+
+    bool write_cluster_streamed(
+        hailstorm::v1::HailstormStreamWriteParams const& params,
+        hailstorm::v1::HailstormWriteData const& data
+    ) noexcept
+    {
+        uint32_t const count_ids = uint32_t(data.paths.size());
+        assert(count_ids == data.data.size());
+        assert(data.data_mapping.empty() || count_ids == data.data_mapping.size());
+        assert(count_ids == data.metadata.size() || count_ids <= data.metadata_mapping.size());
+
+        hailstorm::Task const task = write_cluster_internal<DataWriterMode::Streamed>(
+            params.base_params, params, data, params.base_params.temp_alloc
+        );
+        return task && task.result_memory().size > 0;
+    }
+
+    bool write_cluster_segments(
+        hailstorm::v1::HailstormWriteParams const& params,
+        hailstorm::v1::HailstormWriteData const& data,
+        hailstorm::v1::HailstormWriteSegments& out_segments
+    ) noexcept
+    {
+        uint32_t const count_ids = uint32_t(data.paths.size());
+        assert(count_ids == data.data.size());
+        assert(data.data_mapping.empty() || count_ids == data.data_mapping.size());
+        assert(count_ids == data.metadata.size() || count_ids <= data.metadata_mapping.size());
+
+        out_segments = { };
+        SegmentsWriterParams writer_params{ .params = params, .out_segments = out_segments };
+        hailstorm::Task const task = write_cluster_internal<DataWriterMode::Segments>(
+            params, writer_params, data, params.temp_alloc
+        );
+        return task && task.result_memory().size > 0;
+    }
+
+    auto repack_cluster_internal(
+        hailstorm::v1::HailstormWriteParams const& input_params,
+        hailstorm::SegmentsWriterParams& writer_params,
+        hailstorm::v1::HailstormRepackData const& repack_data
+    ) noexcept -> hailstorm::Task
+    {
+        hailstorm::v1::HailstormData const& pack = repack_data.pack;
+        uint32_t const old_res_count = uint32_t(pack.resources.size());
+        uint32_t const old_chunk_count = uint32_t(pack.chunks.size());
+
+        // Existing chunks can only be reused if the slice alignment stays the same.
+        hailstorm::v1::HailstormWriteParams params = input_params;
+        params.pack_slice_alignment = pack.header.pack_slice_alignment;
+        params.chunk_planner = HailstormChunkPlanner::BinPacking;
+        uint32_t const def_align = std::max<uint32_t>(params.pack_slice_alignment, 8);
+
+        detail::WriteProfiler profiler{ params, params.temp_alloc };
+        hailstorm::Allocator& temp_alloc = profiler.temp_allocator();
+
+        // Paths of the existing resources are copied, so they need to be available.
+        if (pack.paths_data.location == nullptr)
+        {
+            co_return hailstorm::Memory{ };
+        }
+
+        // Chunks are encrypted based on their index, which changes when chunks are reused.
+        if (pack.header.is_encrypted || params.encryption_key != nullptr)
+        {
+            co_return hailstorm::Memory{ };
+        }
+
+        // Relocations of reused chunks would need to be copied over, which is not supported.
+        if (repack_data.resources.relocations.empty() == false)
+        {
+            co_return hailstorm::Memory{ };
+        }
+        for (HailstormSection const& section : pack.sections)
+        {
+            if (section.type == HailstormSectionType::Relocations)
+            {
+                co_return hailstorm::Memory{ };
+            }
+        }
+
+        // Ensure all chunks referenced by the new cluster are within the provided data.
+        for (HailstormChunk const& chunk : pack.chunks)
+        {
+            if (chunk.offset > repack_data.pack_data.size || repack_data.pack_data.size - chunk.offset < chunk.size)
+            {
+                co_return hailstorm::Memory{ };
+            }
+        }
+
+        Array<uint8_t> removed{ temp_alloc };
+        removed.resize(old_res_count);
+        removed.memset(0);
+        for (uint32_t const removed_idx : repack_data.removed_resources)
+        {
+            if (removed_idx >= old_res_count)
+            {
+                co_return hailstorm::Memory{ };
+            }
+            removed[removed_idx] = 1;
+        }
+
+        if (params.deduplicate_data || params.deduplicate_metadata)
+        {
+            profiler.enter(HailstormWritePhase::Deduplication);
+        }
+        Array<uint32_t> data_mapping{ temp_alloc };
+        Array<uint32_t> metadata_mapping{ temp_alloc };
+        hailstorm::v1::HailstormWriteData const deduplicated_data = deduplicate_resources(
+            params, repack_data.resources, temp_alloc, data_mapping, metadata_mapping
+        );
+
+        profiler.enter(HailstormWritePhase::Compression);
+        detail::CompressedResources compressed{ temp_alloc };
+        if (detail::compress_resources(params, nullptr, deduplicated_data, compressed) == false)
+        {
+            co_return hailstorm::Memory{ };
+        }
+
+        hailstorm::v1::HailstormWriteData const& write_data = compressed.write_data;
+        uint32_t const new_res_count = uint32_t(write_data.paths.size());
+
+        // Find existing resources replaced by new resources with the same path.
+        profiler.enter(HailstormWritePhase::ChunkEstimation);
+        Array<uint32_t> replaced_by{ temp_alloc };
+        replaced_by.resize(old_res_count);
+        replaced_by.memset(Constant_U8Max);
+        if (pack.paths_index.empty() == false)
+        {
+            for (uint32_t idx = 0; idx < new_res_count; ++idx)
+            {
+                uint32_t const old_idx = find_resource(pack, write_data.paths[idx]);
+                if (old_idx < old_res_count && removed[old_idx] == 0)
+                {
+                    replaced_by[old_idx] = idx;
+                }
+            }
+        }
+        else if (new_res_count > 0)
+        {
+            // Index the new paths instead, so each existing path is only checked once.
+            Array<HailstormPathsIndexEntry> index{ temp_alloc };
+            index.resize(detail::paths_index_capacity(new_res_count));
+            detail::build_paths_index(write_data.paths, index);
+
+            uint64_t const slot_mask = index.count() - 1;
+            for (uint32_t old_idx = 0; old_idx < old_res_count; ++old_idx)
+            {
+                HailstormResource const& res = pack.resources[old_idx];
+                if (removed[old_idx] != 0 || res.path_size == 0)
+                {
+                    continue;
+                }
+
+                std::string_view const path = detail::resource_path(pack, res);
+                uint64_t const hash = hash_path(path);
+                for (uint64_t slot = hash & slot_mask; index[slot].resource != Constant_HailstormInvalidIndex; slot = (slot + 1) & slot_mask)
+                {
+                    if (index[slot].hash == hash && write_data.paths[index[slot].resource] == path)
+                    {
+                        replaced_by[old_idx] = index[slot].resource;
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Final resource indices, existing resources keep their order and new resources are stored after them.
+        Array<uint32_t> new_res_target{ temp_alloc };
+        new_res_target.resize(new_res_count);
+        new_res_target.memset(Constant_U8Max);
+
+        uint32_t res_count = 0;
+        for (uint32_t old_idx = 0; old_idx < old_res_count; ++old_idx)
+        {
+            if (removed[old_idx] == 0)
+            {
+                if (replaced_by[old_idx] != Constant_U32Max)
+                {
+                    new_res_target[replaced_by[old_idx]] = res_count;
+                }
+                res_count += 1;
+            }
+        }
+        for (uint32_t& target : new_res_target)
+        {
+            if (target == Constant_U32Max)
+            {
+                target = res_count;
+                res_count += 1;
+            }
+        }
+
+        // Calculate the used space of each existing chunk and check which chunks still hold unchanged resources.
+        Array<size_t> old_used{ temp_alloc };
+        old_used.resize(old_chunk_count);
+        old_used.memset(0);
+        Array<uint32_t> chunk_map{ temp_alloc };
+        chunk_map.resize(old_chunk_count);
+        chunk_map.memset(Constant_U8Max);
+
+        bool valid_resources = true;
+        for (uint32_t old_idx = 0; old_idx < old_res_count && valid_resources; ++old_idx)
+        {
+            HailstormResource const& res = pack.resources[old_idx];
+            bool const is_kept = removed[old_idx] == 0 && replaced_by[old_idx] == Constant_U32Max;
+
+            valid_resources = res.meta_chunk < old_chunk_count
+                && res.meta_offset + size_t{ res.meta_size } <= pack.chunks[res.meta_chunk].size;
+            if (valid_resources)
+            {
+                size_t& meta_used = old_used[res.meta_chunk];
+                meta_used = std::max<size_t>(meta_used, align_to(res.meta_offset + size_t{ res.meta_size }, Constant_MetadataMinAlign));
+                if (is_kept)
+                {
+                    chunk_map[res.meta_chunk] = 0;
+                }
+            }
+
+            // Data might be stored across multiple chunks, all of them need to be kept together.
+            size_t data_offset = res.offset;
+            size_t data_remaining = res.size;
+            uint32_t data_chunk = res.chunk;
+            while (data_remaining > 0 && valid_resources)
+            {
+                valid_resources = data_chunk < old_chunk_count && data_offset <= pack.chunks[data_chunk].size;
+                if (valid_resources)
+                {
+                    size_t const written = std::min<size_t>(pack.chunks[data_chunk].size - data_offset, data_remaining);
+                    size_t& data_used = old_used[data_chunk];
+                    data_used = std::max<size_t>(data_used, align_to(data_offset + written, Constant_DataMinAlign));
+                    if (is_kept)
+                    {
+                        chunk_map[data_chunk] = 0;
+                    }
+
+                    data_remaining -= written;
+                    data_offset = 0;
+                    data_chunk += 1;
+                }
+            }
+        }
+
+        if (valid_resources == false)
+        {
+            co_return hailstorm::Memory{ };
+        }
+
+        // Keep the reused chunks in their original order, so custom chunks stay in front and split resources stay continuous.
+        Array<HailstormChunk> chunks{ temp_alloc };
+        Array<size_t> sizes{ temp_alloc };
+        chunks.reserve(old_chunk_count + 1);
+        sizes.reserve(old_chunk_count + 1);
+        for (uint32_t old_chunk = 0; old_chunk < old_chunk_count; ++old_chunk)
+        {
+            HailstormChunk const& chunk = pack.chunks[old_chunk];
+            if (chunk_map[old_chunk] != Constant_U32Max || chunk.type == 0)
+            {
+                // Custom chunks have no entries, so we keep them whole.
+                old_used[old_chunk] = chunk.type == 0 ? chunk.size : std::min<size_t>(old_used[old_chunk], chunk.size);
+                chunk_map[old_chunk] = chunks.count();
+                chunks.push_back(chunk);
+                sizes.push_back(old_used[old_chunk]);
+            }
+        }
+        uint32_t const reused_chunk_count = chunks.count();
+
+        // Reused chunks only keep entries of unchanged resources, entries of new resources are counted when placed.
+        // Deduplicated data and metadata is counted once, and metadata stored next to its data is not counted, same as when writing.
+        struct StoredEntry
+        {
+            uint32_t chunk;
+            uint64_t offset;
+            uint32_t data_chunk;
+            uint32_t resource;
+        };
+        Array<StoredEntry> stored_data{ temp_alloc };
+        Array<StoredEntry> stored_meta{ temp_alloc };
+        for (uint32_t old_idx = 0; old_idx < old_res_count; ++old_idx)
+        {
+            HailstormResource const& res = pack.resources[old_idx];
+            if (removed[old_idx] == 0 && replaced_by[old_idx] == Constant_U32Max)
+            {
+                stored_data.push_back({ .chunk = res.chunk, .offset = res.offset, .data_chunk = res.chunk, .resource = old_idx });
+                stored_meta.push_back({ .chunk = res.meta_chunk, .offset = res.meta_offset, .data_chunk = res.chunk, .resource = old_idx });
+            }
+        }
+
+        auto const by_location = [](StoredEntry const& left, StoredEntry const& right) noexcept
+        {
+            if (left.chunk != right.chunk)
+            {
+                return left.chunk < right.chunk;
+            }
+            if (left.offset != right.offset)
+            {
+                return left.offset < right.offset;
+            }
+            return left.resource < right.resource;
+        };
+        std::sort(stored_data.begin(), stored_data.end(), by_location);
+        std::sort(stored_meta.begin(), stored_meta.end(), by_location);
+
+        for (HailstormChunk& chunk : chunks)
+        {
+            if (chunk.type != 0)
+            {
+                chunk.count_entries = 0;
+            }
+        }
+        for (uint32_t idx = 0; idx < stored_data.count(); ++idx)
+        {
+            StoredEntry const& entry = stored_data[idx];
+            if (idx == 0 || entry.chunk != stored_data[idx - 1].chunk || entry.offset != stored_data[idx - 1].offset)
+            {
+                chunks[chunk_map[entry.chunk]].count_entries += 1;
+            }
+        }
+        for (uint32_t idx = 0; idx < stored_meta.count(); ++idx)
+        {
+            // The first resource using the metadata is the one it was stored with.
+            StoredEntry const& entry = stored_meta[idx];
+            if ((idx == 0 || entry.chunk != stored_meta[idx - 1].chunk || entry.offset != stored_meta[idx - 1].offset)
+                && entry.chunk != entry.data_chunk)
+            {
+                chunks[chunk_map[entry.chunk]].count_entries += 1;
+            }
+        }
+
+        // Place new resources into the free space of reused chunks or into new chunks.
+        Array<HailstormWriteChunkRef> refs{ temp_alloc };
+        refs.resize(new_res_count);
+        Array<uint32_t> metatracker{ temp_alloc };
+        metatracker.resize(uint32_t(write_data.metadata_mapping.size()));
+        metatracker.memset(Constant_U8Max);
+
+        HailstormPaths new_paths_info{ };
+        bool const requires_writer_callback = detail::plan_cluster_chunks(
+            params, write_data, temp_alloc, chunks, refs, sizes, metatracker, new_paths_info, profiler.stats
+        );
+        assert(requires_writer_callback == false || params.fn_resource_write != nullptr);
+
+        // Readers require at least one chunk to be present.
+        if (chunks.empty())
+        {
+            HailstormChunk new_chunk = params.fn_create_chunk(
+                Data{ .location = nullptr, .size = 0, .align = def_align }, Data{ .location = nullptr, .size = 0, .align = def_align }, Constant_EmptyChunk, params.userdata
+            );
+            if (params.pack_slice_alignment > 0)
+            {
+                new_chunk.align = params.pack_slice_alignment;
+            }
+            chunks.push_back(new_chunk);
+            sizes.push_back(0);
+            profiler.stats.count_created_chunks += 1;
+        }
+
+        // Only created chunks are reduced, reused chunks keep their size.
+        for (uint32_t chunk_idx = reused_chunk_count; chunk_idx < chunks.count(); ++chunk_idx)
+        {
+            chunks[chunk_idx].size = align_to(sizes[chunk_idx], chunks[chunk_idx].align);
+        }
+        profiler.prepare_chunks(chunks.count());
+
+        // Collect the paths of all resources, in their final order.
+        profiler.enter(HailstormWritePhase::Paths);
+        Array<std::string_view> paths{ temp_alloc };
+        paths.resize(res_count);
+        // Resources replacing another resource by index keep storing the index instead of the path location.
+        Array<uint32_t> path_replaced{ temp_alloc };
+        path_replaced.resize(res_count);
+        path_replaced.memset(Constant_U8Max);
+        for (uint32_t old_idx = 0, idx = 0; old_idx < old_res_count; ++old_idx)
+        {
+            if (removed[old_idx] == 0)
+            {
+                HailstormResource const& res = pack.resources[old_idx];
+                if (res.path_size == 0)
+                {
+                    path_replaced[idx] = res.path_offset;
+                }
+                else
+                {
+                    paths[idx] = detail::resource_path(pack, res);
+                }
+                idx += 1;
+            }
+        }
+        for (uint32_t idx = 0; idx < new_res_count; ++idx)
+        {
+            uint32_t const res_idx = new_res_target[idx];
+            paths[res_idx] = write_data.paths[idx];
+            path_replaced[res_idx] = Constant_HailstormInvalidIndex;
+            if (write_data.replaced_resources.empty() == false)
+            {
+                path_replaced[res_idx] = write_data.replaced_resources[idx];
+            }
+        }
+
+        HailstormPaths paths_info{ .offset = 0, .size = 8 };
+        for (std::string_view const path : paths)
+        {
+            paths_info.size += path.size() + 1;
+        }
+        paths_info.size = align_to(paths_info.size, def_align);
+
+        Array<HailstormSection> sections{ temp_alloc };
+        collect_sections(params, write_data, res_count, chunks.count(), sections);
+
+        detail::Offsets offsets;
+        size_t const final_cluster_size = cluster_size_info(
+            params.pack_slice_alignment, res_count, chunks, sections, paths_info, offsets
+        );
+
+        // Keep all values of the existing header, only the layout is updated.
+        HailstormHeader header = pack.header;
+        header.header_size = offsets.header_size;
+        header.offset_next = final_cluster_size;
+        header.offset_data = offsets.data;
+        header.is_baked = params.is_baked;
+        header.has_sections = sections.any();
+        header.count_chunks = chunks.count();
+        header.count_resources = res_count;
+        paths_info.offset = offsets.paths_data;
+
+        size_t chunk_offset = offsets.data;
+        for (HailstormChunk& chunk : chunks)
+        {
+            chunk.offset = std::exchange(chunk_offset, align_to(chunk_offset + chunk.size, def_align));
+        }
+
+        DataWriter<DataWriterMode::Segments> writer{
+            writer_params, temp_alloc, write_data, data_view(compressed.memory), chunks, offsets.data, final_cluster_size
+        };
+
+        profiler.enter(HailstormWritePhase::Header);
+        co_await writer.write_header(data_view(header), 0);
+        co_await writer.write_header(data_view(paths_info), offsets.paths_info);
+        co_await writer.write_header(chunks.data_view(), offsets.chunks);
+
+        // Reused chunks are referenced up to their last stored byte, the remaining space might be used by new resources.
+        for (uint32_t old_chunk = 0; old_chunk < old_chunk_count; ++old_chunk)
+        {
+            uint32_t const chunk_idx = chunk_map[old_chunk];
+            if (chunk_idx != Constant_U32Max)
+            {
+                co_await writer.write_reference(
+                    { ptr_add(repack_data.pack_data.location, pack.chunks[old_chunk].offset), old_used[old_chunk], 8 },
+                    chunks[chunk_idx].offset
+                );
+                profiler.add_chunk_data(chunk_idx, old_used[old_chunk]);
+            }
+        }
+
+        // The segments writer owns the header block, so header data is filled in place.
+        static_assert(IHeaderMemoryDataWriter<decltype(writer)>);
+        HailstormResource* const pack_resources = reinterpret_cast<HailstormResource*>(writer.header_memory(offsets.resources));
+
+        // Unchanged resources are only updated to the new chunk indices.
+        profiler.enter(HailstormWritePhase::ResourceData);
+        for (uint32_t old_idx = 0, idx = 0; old_idx < old_res_count; ++old_idx)
+        {
+            if (removed[old_idx] == 0)
+            {
+                HailstormResource& res = pack_resources[idx];
+                res = pack.resources[old_idx];
+                res.chunk = chunk_map[res.chunk];
+                res.meta_chunk = chunk_map[res.meta_chunk];
+                idx += 1;
+            }
+        }
+
+        // Reset the used space to the state before planning.
+        sizes.memset(0);
+        for (uint32_t old_chunk = 0; old_chunk < old_chunk_count; ++old_chunk)
+        {
+            if (chunk_map[old_chunk] != Constant_U32Max)
+            {
+                sizes[chunk_map[old_chunk]] = old_used[old_chunk];
+            }
+        }
+        metatracker.memset(Constant_U8Max);
+
+        for (uint32_t idx = 0; idx < new_res_count; ++idx)
+        {
+            HailstormResource& res = pack_resources[new_res_target[idx]];
+            res = HailstormResource{ };
+            res.chunk = refs[idx].data_chunk;
+            res.meta_chunk = refs[idx].meta_chunk;
+
+            uint32_t meta_idx = idx;
+            uint32_t meta_map_idx = Constant_U32Max;
+            if (metatracker.any())
+            {
+                meta_idx = write_data.metadata_mapping[idx];
+                meta_map_idx = std::exchange(metatracker[meta_idx], idx);
+            }
+
+            if (meta_map_idx == Constant_U32Max)
+            {
+                size_t& meta_chunk_used = sizes[res.meta_chunk];
+                Data const meta = write_data.metadata[meta_idx];
+                res.meta_size = uint32_t(meta.size);
+                res.meta_offset = uint32_t(meta_chunk_used);
+
+                co_await writer.write_metadata(write_data, meta_idx, chunks[res.meta_chunk].offset + meta_chunk_used);
+
+                meta_chunk_used = align_to(meta_chunk_used + meta.size, Constant_MetadataMinAlign);
+                profiler.add_chunk_data(res.meta_chunk, meta.size);
+            }
+            else
+            {
+                res.meta_size = pack_resources[new_res_target[meta_map_idx]].meta_size;
+                res.meta_offset = pack_resources[new_res_target[meta_map_idx]].meta_offset;
+            }
+
+            if (detail::is_deduplicated(write_data, idx))
+            {
+                assert(write_data.data_mapping[idx] < idx);
+                continue;
+            }
+
+            // New resources are never split between chunks.
+            Data const data = write_data.data[idx];
+            size_t& data_chunk_used = sizes[res.chunk];
+            res.size = uint32_t(data.size);
+            res.offset = uint32_t(data_chunk_used);
+            res.size_origin = res.size;
+            if (compressed.info.any())
+            {
+                HailstormWriteCompressionInfo const& info = compressed.info[idx];
+                res.size_origin = info.origin_size;
+                res.compression_type = info.compression_type;
+                res.compression_level = info.compression_level;
+                res.compression_param = info.compression_param;
+            }
+
+            hailstorm::v1::HailstormWriteInfo write_info = initial_write_info(idx, res);
+            co_await writer.write_resource(write_data, write_info, chunks[res.chunk].offset + res.offset);
+            apply_write_info(res, write_info);
+
+            data_chunk_used = align_to(data_chunk_used + data.size, Constant_DataMinAlign);
+            assert(data_chunk_used <= chunks[res.chunk].size);
+            profiler.add_chunk_data(res.chunk, data.size);
+        }
+
+        for (uint32_t idx = 0; idx < new_res_count && write_data.data_mapping.empty() == false; ++idx)
+        {
+            if (detail::is_deduplicated(write_data, idx))
+            {
+                reference_resource_data(
+                    pack_resources[new_res_target[idx]],
+                    pack_resources[new_res_target[write_data.data_mapping[idx]]],
+                    profiler.stats
+                );
+            }
+        }
+
+        // Copy all paths, each followed by an '\0' character.
+        profiler.enter(HailstormWritePhase::Paths);
+        char* const paths_data = reinterpret_cast<char*>(writer.header_memory(offsets.paths_data));
+        uint32_t paths_offset = 0;
+        for (uint32_t idx = 0; idx < res_count; ++idx)
+        {
+            HailstormResource& res = pack_resources[idx];
+            res.path_size = uint32_t(paths[idx].size());
+            res.path_offset = paths_offset;
+            if (path_replaced[idx] != Constant_HailstormInvalidIndex)
+            {
+                res.path_size = 0;
+                res.path_offset = path_replaced[idx];
+            }
+
+            std::memcpy(paths_data + paths_offset, paths[idx].data(), paths[idx].size());
+            paths_offset += uint32_t(paths[idx].size() + 1);
+            paths_data[paths_offset - 1] = '\0';
+        }
+        std::memset(ptr_add(paths_data, paths_offset), 0, paths_info.size - paths_offset);
+
+        profiler.enter(HailstormWritePhase::Sections);
+        HailstormSections const sections_info{ .count = sections.count(), ._unused4B = 0 };
+        if (sections.any())
+        {
+            co_await writer.write_header(data_view(sections_info), offsets.sections);
+            co_await writer.write_header(sections.data_view(), offsets.sections + sizeof(HailstormSections));
+
+            for (HailstormSection const& section : sections)
+            {
+                co_await DataWriterStage{
+                    build_section_data(
+                        writer, section, write_data, paths, chunks, std::span{ pack_resources, res_count }, writer.header_memory(section.offset)
+                    )
+                };
+            }
+        }
+
+        hailstorm::Memory const result = writer.finalize();
+        if (result.size > 0)
+        {
+            profiler.report(chunks, final_cluster_size);
+        }
+        co_return result;
+    }
+
+    bool repack_cluster(
+        hailstorm::v1::HailstormWriteParams const& params,
+        hailstorm::v1::HailstormRepackData const& data,
+        hailstorm::v1::HailstormWriteSegments& out_segments
+    ) noexcept
+    {
+        uint32_t const count_ids = uint32_t(data.resources.paths.size());
+        assert(count_ids == data.resources.data.size());
+        assert(data.resources.data_mapping.empty() || count_ids == data.resources.data_mapping.size());
+        assert(count_ids == data.resources.metadata.size() || count_ids <= data.resources.metadata_mapping.size());
+
+        out_segments = { };
+        SegmentsWriterParams writer_params{ .params = params, .out_segments = out_segments };
+        hailstorm::Task const task = repack_cluster_internal(params, writer_params, data);
+        return task && task.result_memory().size > 0;
+    }
+
+    auto prefixed_resource_paths_size(
+        hailstorm::v1::HailstormPaths const& paths_info,
+        uint32_t count_resources,
+        std::string_view prefix
+    ) noexcept -> size_t
+    {
+        size_t const extended_size = { count_resources * prefix.size() };
+        return paths_info.size + extended_size;
+    }
+
+    bool prefix_resource_paths(
+        hailstorm::v1::HailstormPaths const& paths_info,
+        std::span<hailstorm::v1::HailstormResource> resources,
+        hailstorm::Memory paths_data,
+        std::string_view prefix
+    ) noexcept
+    {
+        size_t const count_resources = resources.size();
+        size_t const size_extended_paths = prefixed_resource_paths_size(
+            paths_info, count_resources, prefix
+        );
+        if (size_extended_paths > paths_data.size)
+        {
+            return false;
+        }
+
+        size_t const size_prefix = prefix.size();
+        size_t const size_extending = size_prefix * count_resources;
+
+        // We find the first non '0' character. The .hsc ensures the last few bytes in the pats chunk are zeros.
+        char* const paths_start = reinterpret_cast<char*>(paths_data.location);
+        char* paths_end = paths_start + paths_info.size;
+        char* ex_paths_end = paths_end + size_extending;
+        while (paths_end[-1] == '\0')
+        {
+            paths_end -= 1;
+            ex_paths_end -= 1;
+        }
+
+        // Iterate over each resource, update it's path (from last to first)
+        uint32_t resource_idx;
+        for (resource_idx = count_resources; ex_paths_end > paths_start && resource_idx > 0; --resource_idx)
+        {
+            v1::HailstormResource& res = resources[resource_idx - 1];
+            *ex_paths_end = '\0';
+
+            // The source and destination ranges overlap for short paths or prefixes.
+            ex_paths_end -= res.path_size;
+            std::memmove(ex_paths_end, paths_start + res.path_offset, res.path_size);
+
+            ex_paths_end -= size_prefix;
+            std::memcpy(ex_paths_end, prefix.data(), size_prefix);
+
+            // Update resource path information
+            res.path_offset = ptr_distance<uint32_t>(paths_start, ex_paths_end);
+            res.path_size += size_prefix;
+            ex_paths_end -= 1;
+        }
+
+        // Ensure we finished at the proper location
+        assert((ex_paths_end + 1) == paths_start);
         return resource_idx == 0 && (ex_paths_end + 1) == paths_start;
     }
 
+    bool prefix_resource_paths(
+        hailstorm::v1::HailstormData& hailstorm,
+        std::span<hailstorm::v1::HailstormResource> resources,
+        hailstorm::Memory paths_data,
+        std::string_view prefix
+    ) noexcept
+    {
+        assert(resources.size() == hailstorm.resources.size());
+        if (prefix_resource_paths(hailstorm.paths, resources, paths_data, prefix) == false)
+        {
+            return false;
+        }
+
+        // Hashes in the index don't match the prefixed paths anymore, paths are compared one by one instead.
+        size_t const paths_size = prefixed_resource_paths_size(hailstorm.paths, uint32_t(resources.size()), prefix);
+        hailstorm.resources = resources;
+        hailstorm.paths.size = uint32_t(paths_size);
+        hailstorm.paths_data = Data{ .location = paths_data.location, .size = paths_size, .align = paths_data.align };
+        hailstorm.paths_index = { };
+        return true;
+    }
+
 } // namespace hailstorm::v1
@@ -0,0 +1,307 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include <hailstorm/hailstorm_pack_reader.hxx>
+#include <hailstorm/hailstorm_operations.hxx>
+#include "hailstorm_memutils.hxx"
+#include "hailstorm_file.hxx"
+#include "hailstorm_chunk_info.hxx"
+#include "hailstorm_array.hxx"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <limits>
+#include <new>
+
+namespace hailstorm::v1
+{
+
+    namespace detail
+    {
+
+        auto chunk_view(hailstorm::Data mapped_pack, hailstorm::v1::HailstormChunk const& chunk) noexcept -> hailstorm::Data
+        {
+            return { ptr_add(mapped_pack.location, chunk.offset), chunk.size, chunk.align };
+        }
+
+    } // namespace detail
+
+    PackReader::PackReader(hailstorm::Allocator& alloc) noexcept
+        : _allocator{ alloc }
+        , _file{ Constant_InvalidFileHandle }
+        , _owns_file{ false }
+        , _mapping_base{ nullptr }
+        , _mapping_size{ 0 }
+        , _mapping_native{ 0 }
+        , _mapping_data{ }
+        , _data{ }
+        , _chunk_refs{ }
+    {
+    }
+
+    PackReader::~PackReader() noexcept
+    {
+        close();
+    }
+
+    auto PackReader::open(char const* path, uint64_t pack_offset) noexcept -> hailstorm::Result
+    {
+        close();
+
+        hailstorm::NativeFileHandle const file = file_open(path, FileOpenFlags::Read);
+        if (file == Constant_InvalidFileHandle)
+        {
+            return Result::E_FileAccessError;
+        }
+
+        hailstorm::Result const result = open_internal(file, pack_offset);
+        if (result == Result::Success)
+        {
+            _owns_file = true;
+        }
+        else
+        {
+            file_close(file);
+        }
+        return result;
+    }
+
+    auto PackReader::open(hailstorm::NativeFileHandle file, uint64_t pack_offset) noexcept -> hailstorm::Result
+    {
+        close();
+        return open_internal(file, pack_offset);
+    }
+
+    auto PackReader::open_internal(hailstorm::NativeFileHandle file, uint64_t pack_offset) noexcept -> hailstorm::Result
+    {
+        // Read the header first to know how much data we need to map.
+        HailstormHeader header{ };
+        if (file_read_at(file, { &header, sizeof(header), alignof(HailstormHeader) }, pack_offset) == false)
+        {
+            return Result::E_IncompleteHeaderData;
+        }
+
+        if (header.magic != Constant_HailstormMagic || header.header_version != Constant_HailstormHeaderVersionV0)
+        {
+            return Result::E_InvalidPackData;
+        }
+
+        uint64_t const file_size = hailstorm::file_size(file);
+        if (file_size < pack_offset || (file_size - pack_offset) < header.offset_next)
+        {
+            return Result::E_IncompleteHeaderData;
+        }
+
+        if (header.offset_next > std::numeric_limits<size_t>::max())
+        {
+            return Result::E_LargePackNotSupported;
+        }
+
+        FileMapping mapping{ };
+        if (file_map(file, pack_offset, size_t(header.offset_next), mapping) == false)
+        {
+            return Result::E_FileAccessError;
+        }
+
+        hailstorm::Result const result = read_header(
+            { mapping.data.location, mapping.data.size, alignof(HailstormHeader) }, _data
+        );
+        if (result != Result::Success)
+        {
+            file_unmap(mapping);
+            _data = { };
+            return result;
+        }
+
+        _chunk_refs = _allocator.allocate(sizeof(std::atomic<uint32_t>) * _data.chunks.size());
+        if (_chunk_refs.location == nullptr && _data.chunks.empty() == false)
+        {
+            file_unmap(mapping);
+            _data = { };
+            return Result::E_InvalidArgument;
+        }
+
+        _file = file;
+        _mapping_base = mapping.base;
+        _mapping_size = mapping.base_size;
+        _mapping_native = mapping.native_mapping;
+        _mapping_data = mapping.data;
+
+        // Chunks that should be always loaded are requested immediately and keep a reference forever.
+        std::atomic<uint32_t>* const refs = reinterpret_cast<std::atomic<uint32_t>*>(_chunk_refs.location);
+        for (uint32_t idx = 0; idx < _data.chunks.size(); ++idx)
+        {
+            HailstormChunk const& chunk = _data.chunks[idx];
+            new (refs + idx) std::atomic<uint32_t>{ uint32_t(chunk.persistance == detail::Constant_PersistanceLoadAlways) };
+
+            if (chunk.persistance == detail::Constant_PersistanceLoadAlways)
+            {
+                memory_advise(detail::chunk_view(_mapping_data, chunk), MemoryAdvice::WillNeed);
+            }
+        }
+        return Result::Success;
+    }
+
+    void PackReader::close() noexcept
+    {
+        if (_mapping_base != nullptr)
+        {
+            FileMapping mapping{
+                .base = _mapping_base,
+                .base_size = _mapping_size,
+                .data = _mapping_data,
+                .native_mapping = _mapping_native
+            };
+            file_unmap(mapping);
+        }
+
+        if (_owns_file)
+        {
+            file_close(_file);
+        }
+
+        if (_chunk_refs.location != nullptr)
+        {
+            _allocator.deallocate(_chunk_refs);
+        }
+
+        _file = Constant_InvalidFileHandle;
+        _owns_file = false;
+        _mapping_base = nullptr;
+        _mapping_size = 0;
+        _mapping_native = 0;
+        _mapping_data = { };
+        _data = { };
+        _chunk_refs = { };
+    }
+
+    auto PackReader::acquire_chunk(uint32_t chunk_idx) noexcept -> hailstorm::Data
+    {
+        assert(chunk_idx < _data.chunks.size());
+        std::atomic<uint32_t>& refs = reinterpret_cast<std::atomic<uint32_t>*>(_chunk_refs.location)[chunk_idx];
+
+        hailstorm::Data const chunk_data = detail::chunk_view(_mapping_data, _data.chunks[chunk_idx]);
+        if (refs.fetch_add(1, std::memory_order_relaxed) == 0)
+        {
+            memory_advise(chunk_data, MemoryAdvice::WillNeed);
+        }
+        return chunk_data;
+    }
+
+    void PackReader::release_chunk(uint32_t chunk_idx) noexcept
+    {
+        assert(chunk_idx < _data.chunks.size());
+        std::atomic<uint32_t>& refs = reinterpret_cast<std::atomic<uint32_t>*>(_chunk_refs.location)[chunk_idx];
+        assert(refs.load(std::memory_order_relaxed) > 0);
+
+        // The mapping is read-only, so advising pages of a chunk acquired again by another thread only causes them to be reloaded.
+        HailstormChunk const& chunk = _data.chunks[chunk_idx];
+        if (refs.fetch_sub(1, std::memory_order_relaxed) == 1)
+        {
+            if (chunk.persistance == detail::Constant_PersistanceTemporary)
+            {
+                memory_advise(detail::chunk_view(_mapping_data, chunk), MemoryAdvice::DontNeed);
+            }
+            else if (chunk.persistance == detail::Constant_PersistanceRegular)
+            {
+                memory_advise(detail::chunk_view(_mapping_data, chunk), MemoryAdvice::Cold);
+            }
+        }
+    }
+
+    auto PackReader::resource_data(uint32_t resource_idx) const noexcept -> hailstorm::Data
+    {
+        assert(resource_idx < _data.resources.size());
+        HailstormResource const& res = _data.resources[resource_idx];
+        HailstormChunk const& chunk = _data.chunks[res.chunk];
+
+        // Resources spanning multiple chunks are stored continuously, so a single view is enough.
+        return { ptr_add(_mapping_data.location, chunk.offset + res.offset), res.size, chunk.align };
+    }
+
+    auto PackReader::acquire_resource_range(uint32_t resource_idx, uint64_t offset, uint64_t size) noexcept -> hailstorm::Data
+    {
+        uint64_t location = 0;
+        uint32_t first_chunk = 0;
+        uint32_t count_chunks = 0;
+        if (detail::resource_range_chunks(_data, resource_idx, offset, size, location, first_chunk, count_chunks) == false)
+        {
+            return { };
+        }
+
+        for (uint32_t chunk_idx = first_chunk; chunk_idx < first_chunk + count_chunks; ++chunk_idx)
+        {
+            acquire_chunk(chunk_idx);
+        }
+        return { ptr_add(_mapping_data.location, location), size, 1 };
+    }
+
+    void PackReader::release_resource_range(uint32_t resource_idx, uint64_t offset, uint64_t size) noexcept
+    {
+        uint64_t location = 0;
+        uint32_t first_chunk = 0;
+        uint32_t count_chunks = 0;
+        if (detail::resource_range_chunks(_data, resource_idx, offset, size, location, first_chunk, count_chunks) == false)
+        {
+            return;
+        }
+
+        for (uint32_t chunk_idx = first_chunk; chunk_idx < first_chunk + count_chunks; ++chunk_idx)
+        {
+            release_chunk(chunk_idx);
+        }
+    }
+
+    auto PackReader::resource_metadata(uint32_t resource_idx) const noexcept -> hailstorm::Data
+    {
+        assert(resource_idx < _data.resources.size());
+        HailstormResource const& res = _data.resources[resource_idx];
+        HailstormChunk const& chunk = _data.chunks[res.meta_chunk];
+        return { ptr_add(_mapping_data.location, chunk.offset + res.meta_offset), res.meta_size, 8 };
+    }
+
+    void PackReader::prefetch(std::span<uint32_t const> resources) const noexcept
+    {
+        uint32_t const chunk_count = uint32_t(_data.chunks.size());
+        hailstorm::Array<uint8_t> requested{ _allocator };
+        requested.resize(chunk_count);
+        requested.memset(0);
+
+        for (uint32_t const resource_idx : resources)
+        {
+            assert(resource_idx < _data.resources.size());
+            HailstormResource const& res = _data.resources[resource_idx];
+            requested[res.meta_chunk] = 1;
+
+            uint64_t location = 0;
+            uint32_t first_chunk = res.chunk;
+            uint32_t count_chunks = 1;
+            detail::resource_range_chunks(_data, resource_idx, 0, res.size, location, first_chunk, count_chunks);
+            for (uint32_t chunk_idx = first_chunk; chunk_idx < first_chunk + count_chunks; ++chunk_idx)
+            {
+                requested[chunk_idx] = 1;
+            }
+        }
+
+        // Requested chunks placed one after another are advised as a single range.
+        uint32_t chunk_idx = 0;
+        while (chunk_idx < chunk_count)
+        {
+            if (requested[chunk_idx] == 0)
+            {
+                chunk_idx += 1;
+                continue;
+            }
+
+            HailstormChunk const& first = _data.chunks[chunk_idx];
+            uint64_t range_end = first.offset + first.size;
+            while (++chunk_idx < chunk_count && requested[chunk_idx] != 0 && _data.chunks[chunk_idx].offset <= range_end)
+            {
+                range_end = std::max(range_end, _data.chunks[chunk_idx].offset + _data.chunks[chunk_idx].size);
+            }
+
+            memory_advise({ ptr_add(_mapping_data.location, first.offset), range_end - first.offset, first.align }, MemoryAdvice::WillNeed);
+        }
+    }
+
+} // namespace hailstorm::v1
@@ -0,0 +1,583 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include <hailstorm/hailstorm_pack_set.hxx>
+#include <hailstorm/hailstorm_operations.hxx>
+#include "hailstorm_array.hxx"
+#include "hailstorm_paths.hxx"
+#include "hailstorm_file.hxx"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <compare>
+#include <new>
+#include <thread>
+#include <utility>
+
+namespace hailstorm::v1
+{
+
+    namespace detail
+    {
+
+        //! \brief Key used to order packs, so each pack is applied after the pack it overrides.
+        //! \note Compared member by member, since all identity values together don't fit into a single 64bit value.
+        struct PackApplyKey
+        {
+            uint32_t pack_id;
+            uint16_t pack_expansion_ver;
+            bool is_patch;
+            uint16_t pack_patch_ver;
+
+            auto operator<=>(PackApplyKey const&) const noexcept = default;
+        };
+
+        auto pack_apply_key(hailstorm::v1::HailstormHeader const& header) noexcept -> PackApplyKey
+        {
+            return PackApplyKey{
+                .pack_id = header.pack_id,
+                .pack_expansion_ver = header.pack_expansion_ver,
+                .is_patch = header.is_patch != 0,
+                .pack_patch_ver = header.pack_patch_ver,
+            };
+        }
+
+        //! \brief Finds the root of the given resource, updating visited entries to point closer to it.
+        auto resolution_root(hailstorm::Array<uint32_t>& parents, uint32_t global_idx) noexcept -> uint32_t
+        {
+            while (parents[global_idx] != global_idx)
+            {
+                parents[global_idx] = parents[parents[global_idx]];
+                global_idx = parents[global_idx];
+            }
+            return global_idx;
+        }
+
+    } // namespace detail
+
+    //! \brief Resolution table published by 'build', never changed once published.
+    struct PackSet::Table
+    {
+        Table(hailstorm::Allocator& alloc) noexcept
+            : packs{ alloc }
+            , first_resource{ alloc }
+            , resolution{ alloc }
+            , paths{ alloc }
+        {
+        }
+
+        //! \brief Packs added before the table was built, readers are owned by the set.
+        hailstorm::Array<hailstorm::v1::PackReader*> packs;
+
+        //! \brief Global index of the first resource for each pack, with the total number of resources at the end.
+        hailstorm::Array<uint32_t> first_resource;
+
+        //! \brief The final version of each resource, indexed with global resource indices.
+        hailstorm::Array<hailstorm::v1::PackSetResource> resolution;
+
+        //! \brief Hash table of all paths in the set, entries store the global index of the first resource with the path.
+        hailstorm::Array<hailstorm::v1::HailstormPathsIndexEntry> paths;
+
+        auto local_index(uint32_t global_idx) const noexcept -> hailstorm::v1::PackSetResource
+        {
+            uint32_t const* const it = std::upper_bound(
+                &first_resource[0], &first_resource[0] + packs.count(), global_idx
+            );
+            uint32_t const pack_idx = uint32_t(it - &first_resource[0]) - 1;
+            return { pack_idx, global_idx - first_resource[pack_idx] };
+        }
+
+        auto path(uint32_t global_idx) const noexcept -> std::string_view
+        {
+            hailstorm::v1::PackSetResource const resource = local_index(global_idx);
+            hailstorm::v1::HailstormData const& data = packs[resource.pack]->data();
+            return detail::resource_path(data, data.resources[resource.resource]);
+        }
+
+        //! \brief Creates the resolution table for all packs in the 'packs' list.
+        auto build(hailstorm::Allocator& alloc) noexcept -> hailstorm::Result;
+    };
+
+    struct PackSet::Internal
+    {
+        static constexpr uint32_t Constant_ReaderStripes = 16;
+        static constexpr size_t Constant_CacheLineSize = 64;
+
+        //! \brief Number of active lookups, padded so threads using different stripes don't share cache lines.
+        //! \note Padding is used instead of 'alignas', since the allocator only guarantees an alignment of '8'.
+        struct ReaderCounter
+        {
+            std::atomic<uint32_t> value{ 0 };
+            char padding[Constant_CacheLineSize - sizeof(std::atomic<uint32_t>)];
+        };
+
+        Internal(hailstorm::Allocator& alloc) noexcept
+            : files{ alloc }
+            , packs{ alloc }
+        {
+        }
+
+        //! \brief Files opened by the set.
+        hailstorm::Array<hailstorm::NativeFileHandle> files;
+
+        //! \brief All added packs, including packs added after the table was published.
+        hailstorm::Array<hailstorm::v1::PackReader*> packs;
+
+        //! \brief Number of added packs, can be read while files are added.
+        std::atomic<uint32_t> count_packs{ 0 };
+
+        //! \brief The table used by lookups, replaced on each successful build.
+        std::atomic<Table*> table{ nullptr };
+
+        //! \brief Lookups count themselves in the counters of the current epoch, so a replaced table can be released
+        //!   once all counters of the previous epoch reach zero.
+        std::atomic<uint32_t> epoch{ 0 };
+        ReaderCounter readers[2][Constant_ReaderStripes];
+
+        //! \brief Replaces the published table and waits for all lookups that could still use the previous one.
+        //! \return The previous table, which is no longer accessed by any thread.
+        auto publish(Table* new_table) noexcept -> Table*
+        {
+            Table* const previous = table.exchange(new_table, std::memory_order_seq_cst);
+            uint32_t const previous_epoch = epoch.fetch_add(1, std::memory_order_seq_cst);
+
+            ReaderCounter const* const counters = readers[previous_epoch & 1];
+            for (uint32_t stripe = 0; stripe < Constant_ReaderStripes; ++stripe)
+            {
+                while (counters[stripe].value.load(std::memory_order_seq_cst) > 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            return previous;
+        }
+
+        //! \brief Keeps the published table alive for the duration of a lookup.
+        class ReadScope final
+        {
+        public:
+            explicit ReadScope(Internal& internal) noexcept
+            {
+                uint32_t const stripe = reader_stripe();
+                uint32_t current_epoch = internal.epoch.load(std::memory_order_seq_cst);
+                for (;;)
+                {
+                    _counter = &internal.readers[current_epoch & 1][stripe].value;
+                    _counter->fetch_add(1, std::memory_order_seq_cst);
+
+                    // If a table was published in the meantime, the writer might have missed this lookup.
+                    uint32_t const checked_epoch = internal.epoch.load(std::memory_order_seq_cst);
+                    if (checked_epoch == current_epoch)
+                    {
+                        break;
+                    }
+
+                    _counter->fetch_sub(1, std::memory_order_release);
+                    current_epoch = checked_epoch;
+                }
+                _table = internal.table.load(std::memory_order_seq_cst);
+            }
+
+            ~ReadScope() noexcept
+            {
+                _counter->fetch_sub(1, std::memory_order_release);
+            }
+
+            auto table() const noexcept -> Table const* { return _table; }
+
+            ReadScope(ReadScope const&) noexcept = delete;
+            auto operator=(ReadScope const&) noexcept -> ReadScope& = delete;
+
+        private:
+            //! \brief Threads are assigned stripes in order, so up to 'Constant_ReaderStripes' threads never share a counter.
+            static auto reader_stripe() noexcept -> uint32_t
+            {
+                static std::atomic<uint32_t> next_stripe{ 0 };
+                thread_local uint32_t const stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % Constant_ReaderStripes;
+                return stripe;
+            }
+
+        private:
+            std::atomic<uint32_t>* _counter;
+            Table const* _table;
+        };
+    };
+
+    PackSet::PackSet(hailstorm::Allocator& alloc) noexcept
+        : _allocator{ alloc }
+        , _internal{ new (alloc.allocate(sizeof(Internal)).location) Internal{ alloc } }
+    {
+    }
+
+    PackSet::~PackSet() noexcept
+    {
+        close();
+        _internal->~Internal();
+        _allocator.deallocate(_internal);
+    }
+
+    auto PackSet::add_file(char const* path) noexcept -> hailstorm::Result
+    {
+        hailstorm::NativeFileHandle const file = file_open(path, FileOpenFlags::Read);
+        if (file == Constant_InvalidFileHandle)
+        {
+            return Result::E_FileAccessError;
+        }
+
+        hailstorm::Result const result = add_file_internal(file);
+        if (result == Result::Success)
+        {
+            _internal->files.push_back(file);
+        }
+        else
+        {
+            file_close(file);
+        }
+        return result;
+    }
+
+    auto PackSet::add_file(hailstorm::NativeFileHandle file) noexcept -> hailstorm::Result
+    {
+        return add_file_internal(file);
+    }
+
+    auto PackSet::add_file_internal(hailstorm::NativeFileHandle file) noexcept -> hailstorm::Result
+    {
+        Internal& internal = *_internal;
+        uint32_t const first_pack = internal.packs.count();
+        uint64_t const file_size = hailstorm::file_size(file);
+
+        // Follow the chain of packs until there is no more data for another header.
+        hailstorm::Result result = Result::Success;
+        uint64_t pack_offset = 0;
+        do
+        {
+            PackReader* const reader = new (_allocator.allocate(sizeof(PackReader)).location) PackReader{ _allocator };
+            internal.packs.push_back(reader);
+
+            result = reader->open(file, pack_offset);
+            if (result == Result::Success && reader->data().header.offset_next < sizeof(HailstormHeader))
+            {
+                result = Result::E_InvalidPackData;
+            }
+            if (result != Result::Success)
+            {
+                break;
+            }
+
+            pack_offset += reader->data().header.offset_next;
+        } while (file_size - pack_offset >= sizeof(HailstormHeader));
+
+        if (result != Result::Success)
+        {
+            for (uint32_t idx = first_pack; idx < internal.packs.count(); ++idx)
+            {
+                internal.packs[idx]->~PackReader();
+                _allocator.deallocate(internal.packs[idx]);
+            }
+            internal.packs.resize(first_pack);
+        }
+
+        internal.count_packs.store(internal.packs.count(), std::memory_order_release);
+        return result;
+    }
+
+    auto PackSet::Table::build(hailstorm::Allocator& alloc) noexcept -> hailstorm::Result
+    {
+        uint32_t const count_packs = packs.count();
+
+        first_resource.resize(count_packs + 1);
+        first_resource[0] = 0;
+        for (uint32_t idx = 0; idx < count_packs; ++idx)
+        {
+            uint32_t const pack_resources = uint32_t(packs[idx]->data().resources.size());
+            first_resource[idx + 1] = first_resource[idx] + pack_resources;
+        }
+        uint32_t const count_resources = first_resource[count_packs];
+
+        // Packs are applied in order of their identity, patches are applied after the pack they target.
+        hailstorm::Array<uint32_t> order{ alloc };
+        order.resize(count_packs);
+        for (uint32_t idx = 0; idx < count_packs; ++idx)
+        {
+            order[idx] = idx;
+        }
+        std::sort(order.begin(), order.end(), [this](uint32_t left, uint32_t right) noexcept
+            {
+                detail::PackApplyKey const left_key = detail::pack_apply_key(packs[left]->data().header);
+                detail::PackApplyKey const right_key = detail::pack_apply_key(packs[right]->data().header);
+                return left_key < right_key || (left_key == right_key && left < right);
+            }
+        );
+
+        // Each resource points to the resource overriding it, roots are the final versions.
+        hailstorm::Array<uint32_t> parents{ alloc };
+        parents.resize(count_resources);
+        for (uint32_t idx = 0; idx < count_resources; ++idx)
+        {
+            parents[idx] = idx;
+        }
+
+        paths.resize(detail::paths_index_capacity(count_resources));
+        for (HailstormPathsIndexEntry& entry : paths)
+        {
+            entry = { .hash = 0, .resource = Constant_HailstormInvalidIndex, .collision = 0 };
+        }
+
+        // Path hashes of a single pack, taken from the 'PathsIndex' section if available.
+        hailstorm::Array<uint64_t> hashes{ alloc };
+        uint64_t const slot_mask = paths.count() - 1;
+
+        detail::PackApplyKey previous_key{ };
+        for (uint32_t order_idx = 0; order_idx < count_packs; ++order_idx)
+        {
+            uint32_t const pack_idx = order[order_idx];
+            HailstormData const& data = packs[pack_idx]->data();
+            HailstormHeader const& header = data.header;
+
+            detail::PackApplyKey const key = detail::pack_apply_key(header);
+            if (order_idx > 0 && key == previous_key)
+            {
+                return Result::E_InvalidPackChain;
+            }
+            previous_key = key;
+
+            // Find the pack this pack applies to, it was already applied since it's key is smaller.
+            bool const is_update = header.is_patch || header.is_expansion;
+            uint32_t target_pack = Constant_HailstormInvalidIndex;
+            if (is_update)
+            {
+                if (header.is_patch == false && header.pack_expansion_ver == 0)
+                {
+                    return Result::E_InvalidPackChain;
+                }
+
+                uint16_t const target_expansion_ver = header.pack_expansion_ver - uint16_t(header.is_patch == false);
+                for (uint32_t idx = 0; idx < order_idx; ++idx)
+                {
+                    HailstormHeader const& target = packs[order[idx]]->data().header;
+                    if (target.is_patch == false
+                        && target.pack_id == header.pack_id
+                        && target.pack_expansion_ver == target_expansion_ver)
+                    {
+                        target_pack = order[idx];
+                    }
+                }
+
+                if (target_pack == Constant_HailstormInvalidIndex)
+                {
+                    return Result::E_InvalidPackChain;
+                }
+            }
+
+            bool const has_paths = data.paths_data.location != nullptr;
+            if (has_paths && data.paths_index.empty() == false)
+            {
+                hashes.resize(uint32_t(data.resources.size()));
+                for (HailstormPathsIndexEntry const& entry : data.paths_index)
+                {
+                    if (entry.resource < hashes.count())
+                    {
+                        hashes[entry.resource] = entry.hash;
+                    }
+                }
+            }
+
+            uint32_t const pack_first_resource = first_resource[pack_idx];
+            for (uint32_t res_idx = 0; res_idx < data.resources.size(); ++res_idx)
+            {
+                HailstormResource const& res = data.resources[res_idx];
+                uint32_t const global_idx = pack_first_resource + res_idx;
+
+                // Resources without a path override a resource by index.
+                if (is_update && res.path_size == 0)
+                {
+                    uint32_t const target_resources = uint32_t(packs[target_pack]->data().resources.size());
+                    if (res.path_offset >= target_resources)
+                    {
+                        return Result::E_InvalidPackData;
+                    }
+
+                    uint32_t const replaced = first_resource[target_pack] + res.path_offset;
+                    parents[detail::resolution_root(parents, replaced)] = global_idx;
+                    continue;
+                }
+
+                if (has_paths == false)
+                {
+                    continue;
+                }
+
+                std::string_view const res_path = detail::resource_path(data, res);
+                uint64_t const hash = data.paths_index.empty() ? hash_path(res_path) : hashes[res_idx];
+
+                // Find the path in the table or an empty slot to insert it.
+                uint64_t slot = hash & slot_mask;
+                bool collision = false;
+                while (paths[uint32_t(slot)].resource != Constant_HailstormInvalidIndex)
+                {
+                    HailstormPathsIndexEntry& entry = paths[uint32_t(slot)];
+                    if (entry.hash == hash)
+                    {
+                        if (path(entry.resource) == res_path)
+                        {
+                            break;
+                        }
+
+                        entry.collision = 1;
+                        collision = true;
+                    }
+                    slot = (slot + 1) & slot_mask;
+                }
+
+                HailstormPathsIndexEntry& entry = paths[uint32_t(slot)];
+                if (entry.resource == Constant_HailstormInvalidIndex)
+                {
+                    entry = { .hash = hash, .resource = global_idx, .collision = uint32_t(collision) };
+                }
+                else
+                {
+                    parents[detail::resolution_root(parents, entry.resource)] = global_idx;
+                }
+            }
+        }
+
+        // Store the final version of each resource, roots are not updated before all their children are.
+        resolution.resize(count_resources);
+        for (uint32_t pack_idx = 0; pack_idx < count_packs; ++pack_idx)
+        {
+            for (uint32_t idx = first_resource[pack_idx]; idx < first_resource[pack_idx + 1]; ++idx)
+            {
+                resolution[idx] = { pack_idx, idx - first_resource[pack_idx] };
+            }
+        }
+        for (uint32_t idx = 0; idx < count_resources; ++idx)
+        {
+            resolution[idx] = resolution[detail::resolution_root(parents, idx)];
+        }
+
+        return Result::Success;
+    }
+
+    auto PackSet::build() noexcept -> hailstorm::Result
+    {
+        Internal& internal = *_internal;
+
+        // Lookups keep using the published table, until the new one is fully built.
+        Table* const table = new (_allocator.allocate(sizeof(Table)).location) Table{ _allocator };
+        table->packs.push_back(std::span<PackReader* const>{ internal.packs.begin(), internal.packs.end() });
+
+        hailstorm::Result const result = table->build(_allocator);
+        if (result != Result::Success)
+        {
+            table->~Table();
+            _allocator.deallocate(table);
+            return result;
+        }
+
+        Table* const previous = internal.publish(table);
+        if (previous != nullptr)
+        {
+            previous->~Table();
+            _allocator.deallocate(previous);
+        }
+        return Result::Success;
+    }
+
+    void PackSet::close() noexcept
+    {
+        Internal& internal = *_internal;
+
+        // No lookups are allowed at this point, so the table can be released immediately.
+        Table* const table = internal.table.exchange(nullptr);
+        if (table != nullptr)
+        {
+            table->~Table();
+            _allocator.deallocate(table);
+        }
+
+        for (PackReader* reader : internal.packs)
+        {
+            reader->~PackReader();
+            _allocator.deallocate(reader);
+        }
+        for (hailstorm::NativeFileHandle file : internal.files)
+        {
+            file_close(file);
+        }
+
+        internal.files.resize(0);
+        internal.packs.resize(0);
+        internal.count_packs.store(0, std::memory_order_release);
+    }
+
+    auto PackSet::count_packs() const noexcept -> uint32_t
+    {
+        return _internal->count_packs.load(std::memory_order_acquire);
+    }
+
+    auto PackSet::pack(uint32_t pack_idx) noexcept -> hailstorm::v1::PackReader&
+    {
+        return const_cast<PackReader&>(std::as_const(*this).pack(pack_idx));
+    }
+
+    auto PackSet::pack(uint32_t pack_idx) const noexcept -> hailstorm::v1::PackReader const&
+    {
+        // Readers are never moved, packs added after the last build are only visible to the thread adding them.
+        {
+            Internal::ReadScope const scope{ *_internal };
+            Table const* const table = scope.table();
+            if (table != nullptr && pack_idx < table->packs.count())
+            {
+                return *table->packs[pack_idx];
+            }
+        }
+
+        assert(pack_idx < _internal->packs.count());
+        return *_internal->packs[pack_idx];
+    }
+
+    auto PackSet::resolve(uint32_t pack_idx, uint32_t resource_idx) const noexcept -> hailstorm::v1::PackSetResource
+    {
+        Internal::ReadScope const scope{ *_internal };
+        Table const* const table = scope.table();
+        assert(table != nullptr);
+        assert(pack_idx < table->packs.count());
+        assert(resource_idx < table->first_resource[pack_idx + 1] - table->first_resource[pack_idx]);
+        return table->resolution[table->first_resource[pack_idx] + resource_idx];
+    }
+
+    auto PackSet::find_resource(std::string_view path) const noexcept -> hailstorm::v1::PackSetResource
+    {
+        Internal::ReadScope const scope{ *_internal };
+        Table const* const table = scope.table();
+        assert(table != nullptr);
+
+        uint64_t const hash = hash_path(path);
+        uint64_t const slot_mask = table->paths.count() - 1;
+        uint64_t slot = hash & slot_mask;
+
+        // The table has always empty slots so this loop will end.
+        while (table->paths[uint32_t(slot)].resource != Constant_HailstormInvalidIndex)
+        {
+            HailstormPathsIndexEntry const& entry = table->paths[uint32_t(slot)];
+            if (entry.hash == hash && (entry.collision == 0 || table->path(entry.resource) == path))
+            {
+                return table->resolution[entry.resource];
+            }
+            slot = (slot + 1) & slot_mask;
+        }
+        return { };
+    }
+
+    auto PackSet::resource_data(hailstorm::v1::PackSetResource resource) const noexcept -> hailstorm::Data
+    {
+        return pack(resource.pack).resource_data(resource.resource);
+    }
+
+    auto PackSet::resource_metadata(hailstorm::v1::PackSetResource resource) const noexcept -> hailstorm::Data
+    {
+        return pack(resource.pack).resource_metadata(resource.resource);
+    }
+
+} // namespace hailstorm::v1
@@ -0,0 +1,204 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include "hailstorm_paths.hxx"
+#include "hailstorm_memutils.hxx"
+#include <cassert>
+#include <cstring>
+#include <bit>
+
+namespace hailstorm::v1
+{
+
+    namespace detail
+    {
+
+        static constexpr uint64_t Constant_FNV1a64_Offset = 0xcbf2'9ce4'8422'2325ull;
+        static constexpr uint64_t Constant_FNV1a64_Prime = 0x0000'0100'0000'01b3ull;
+
+        auto resource_path(
+            hailstorm::v1::HailstormData const& hailstorm,
+            hailstorm::v1::HailstormResource const& res
+        ) noexcept -> std::string_view
+        {
+            return { reinterpret_cast<char const*>(hailstorm.paths_data.location) + res.path_offset, res.path_size };
+        }
+
+        auto paths_index_capacity(uint32_t resource_count) noexcept -> uint32_t
+        {
+            return std::bit_ceil(std::max<uint32_t>(resource_count, 1) * 2);
+        }
+
+        void build_paths_index(
+            std::span<std::string_view const> paths,
+            std::span<hailstorm::v1::HailstormPathsIndexEntry> out_entries
+        ) noexcept
+        {
+            assert(std::has_single_bit(out_entries.size()));
+            assert(out_entries.size() >= paths.size() * 2);
+
+            for (HailstormPathsIndexEntry& entry : out_entries)
+            {
+                entry = { .hash = 0, .resource = Constant_HailstormInvalidIndex, .collision = 0 };
+            }
+
+            uint64_t const slot_mask = out_entries.size() - 1;
+            for (uint32_t idx = 0; idx < paths.size(); ++idx)
+            {
+                uint64_t const hash = hash_path(paths[idx]);
+                uint64_t slot = hash & slot_mask;
+
+                // Linear probing, mark all entries with the same hash so readers know when to compare paths.
+                bool collision = false;
+                while (out_entries[slot].resource != Constant_HailstormInvalidIndex)
+                {
+                    if (out_entries[slot].hash == hash)
+                    {
+                        out_entries[slot].collision = 1;
+                        collision = true;
+                    }
+                    slot = (slot + 1) & slot_mask;
+                }
+
+                out_entries[slot] = { .hash = hash, .resource = idx, .collision = uint32_t(collision) };
+            }
+        }
+
+    } // namespace detail
+
+    auto hash_path(std::string_view path) noexcept -> uint64_t
+    {
+        uint64_t hash = detail::Constant_FNV1a64_Offset;
+        for (char const c : path)
+        {
+            hash ^= uint64_t(uint8_t(c));
+            hash *= detail::Constant_FNV1a64_Prime;
+        }
+        return hash;
+    }
+
+    auto find_resource(
+        hailstorm::v1::HailstormData const& hailstorm,
+        std::string_view path
+    ) noexcept -> uint32_t
+    {
+        bool const has_paths = hailstorm.paths_data.location != nullptr;
+
+        // Without the index we can only compare each path.
+        if (hailstorm.paths_index.empty())
+        {
+            if (has_paths == false)
+            {
+                return Constant_HailstormInvalidIndex;
+            }
+
+            uint32_t idx = 0;
+            for (HailstormResource const& res : hailstorm.resources)
+            {
+                if (detail::resource_path(hailstorm, res) == path)
+                {
+                    return idx;
+                }
+                idx += 1;
+            }
+            return Constant_HailstormInvalidIndex;
+        }
+
+        uint64_t const hash = hash_path(path);
+        uint64_t const slot_mask = hailstorm.paths_index.size() - 1;
+        uint64_t slot = hash & slot_mask;
+
+        // The table has always empty slots, the probe is still limited in case the index was provided by the user.
+        for (size_t probe = 0; probe < hailstorm.paths_index.size(); ++probe)
+        {
+            HailstormPathsIndexEntry const& entry = hailstorm.paths_index[slot];
+            if (entry.resource == Constant_HailstormInvalidIndex)
+            {
+                break;
+            }
+
+            if (entry.hash == hash)
+            {
+                if (entry.collision == 0)
+                {
+                    return entry.resource;
+                }
+
+                // We can't tell which resource is the right one without the paths data.
+                if (has_paths == false)
+                {
+                    return Constant_HailstormInvalidIndex;
+                }
+
+                if (entry.resource < hailstorm.resources.size()
+                    && detail::resource_path(hailstorm, hailstorm.resources[entry.resource]) == path)
+                {
+                    return entry.resource;
+                }
+            }
+            slot = (slot + 1) & slot_mask;
+        }
+        return Constant_HailstormInvalidIndex;
+    }
+
+    auto validate_paths(
+        hailstorm::v1::HailstormData const& hailstorm
+    ) noexcept -> hailstorm::Result
+    {
+        if (hailstorm.paths_data.location == nullptr)
+        {
+            return Result::E_InvalidArgument;
+        }
+
+        bool const is_update = hailstorm.header.is_patch || hailstorm.header.is_expansion;
+        char const* const paths = reinterpret_cast<char const*>(hailstorm.paths_data.location);
+        size_t const paths_size = hailstorm.paths_data.size;
+
+        for (HailstormResource const& res : hailstorm.resources)
+        {
+            if (is_update && res.path_size == 0)
+            {
+                continue;
+            }
+
+            // The terminator needs to be part of the paths data as well.
+            if (res.path_offset >= paths_size || (paths_size - res.path_offset) <= res.path_size)
+            {
+                return Result::E_InvalidPackData;
+            }
+
+            // 'memchr' is vectorized on all major platforms, so this check runs close to memory bandwidth.
+            char const* const path = paths + res.path_offset;
+            if (path[res.path_size] != '\0' || std::memchr(path, '\0', res.path_size) != nullptr)
+            {
+                return Result::E_InvalidPackData;
+            }
+        }
+        return Result::Success;
+    }
+
+    bool split_paths(
+        hailstorm::v1::HailstormData const& hailstorm,
+        std::span<std::string_view> out_paths
+    ) noexcept
+    {
+        if (hailstorm.paths_data.location == nullptr || out_paths.size() < hailstorm.resources.size())
+        {
+            return false;
+        }
+
+        bool const is_update = hailstorm.header.is_patch || hailstorm.header.is_expansion;
+        char const* const paths = reinterpret_cast<char const*>(hailstorm.paths_data.location);
+
+        std::string_view* out_it = out_paths.data();
+        for (HailstormResource const& res : hailstorm.resources)
+        {
+            *out_it = (is_update && res.path_size == 0)
+                ? std::string_view{ }
+                : std::string_view{ paths + res.path_offset, res.path_size };
+            out_it += 1;
+        }
+        return true;
+    }
+
+} // namespace hailstorm::v1
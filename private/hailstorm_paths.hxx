@@ -0,0 +1,25 @@
+#pragma once
+#include <hailstorm/hailstorm_operations.hxx>
+
+namespace hailstorm::v1::detail
+{
+
+    //! \return The path of the given resource.
+    //! \pre The 'paths_data' of the pack needs to be available.
+    auto resource_path(
+        hailstorm::v1::HailstormData const& hailstorm,
+        hailstorm::v1::HailstormResource const& res
+    ) noexcept -> std::string_view;
+
+    //! \brief Returns the number of slots used for a 'PathsIndex' section holding the given number of resources.
+    //! \note Always a power of '2' with a load factor of at most '0.5'.
+    auto paths_index_capacity(uint32_t resource_count) noexcept -> uint32_t;
+
+    //! \brief Fills the 'PathsIndex' hash table for all paths in the given write data.
+    //! \pre The memory block needs to hold 'paths_index_capacity(paths.size())' entries.
+    void build_paths_index(
+        std::span<std::string_view const> paths,
+        std::span<hailstorm::v1::HailstormPathsIndexEntry> out_entries
+    ) noexcept;
+
+} // namespace hailstorm::v1::detail
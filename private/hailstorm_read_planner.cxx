@@ -0,0 +1,310 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include <hailstorm/hailstorm_operations.hxx>
+#include "hailstorm_memutils.hxx"
+#include "hailstorm_array.hxx"
+#include "hailstorm_chunk_info.hxx"
+#include <algorithm>
+
+namespace hailstorm::v1
+{
+
+    static constexpr uint32_t Constant_ReadMinAlign = 8;
+
+    namespace
+    {
+
+        //! \brief Aligned byte range of a single resource data or metadata block.
+        struct ReadRange
+        {
+            uint64_t begin;
+            uint64_t end;
+
+            //! \brief Offset of the requested data, 'begin' might be located before it due to alignment or whole chunk reads.
+            uint64_t location;
+
+            uint32_t target;
+            uint32_t read;
+            bool metadata;
+        };
+
+        auto make_range(
+            hailstorm::v1::HailstormData const& hailstorm,
+            uint32_t chunk_idx,
+            uint64_t offset,
+            uint64_t size,
+            bool whole_chunks,
+            uint32_t align
+        ) noexcept -> ReadRange
+        {
+            HailstormChunk const& chunk = hailstorm.chunks[chunk_idx];
+            uint64_t const location = chunk.offset + offset;
+            uint64_t begin = location;
+            uint64_t end = location + size;
+
+            if (whole_chunks)
+            {
+                // Resources spanning multiple chunks are stored continuously over all 'Partial' chunks following the first one.
+                uint32_t last_chunk = chunk_idx;
+                while (last_chunk + 1 < hailstorm.chunks.size()
+                    && hailstorm.chunks[last_chunk].offset + hailstorm.chunks[last_chunk].size < end)
+                {
+                    last_chunk += 1;
+                }
+
+                begin = chunk.offset;
+                end = std::max(end, hailstorm.chunks[last_chunk].offset + hailstorm.chunks[last_chunk].size);
+            }
+
+            return ReadRange{
+                .begin = begin & ~uint64_t{ align - 1 },
+                .end = align_to(end, align),
+                .location = location,
+                .target = 0,
+                .read = 0,
+                .metadata = false,
+            };
+        }
+
+    } // namespace
+
+    bool detail::resource_range_chunks(
+        hailstorm::v1::HailstormData const& hailstorm,
+        uint32_t resource_idx,
+        uint64_t offset,
+        uint64_t size,
+        uint64_t& out_location,
+        uint32_t& out_first_chunk,
+        uint32_t& out_count_chunks
+    ) noexcept
+    {
+        if (resource_idx >= hailstorm.resources.size())
+        {
+            return false;
+        }
+
+        uint64_t const data_size = resource_size(hailstorm, resource_idx);
+        if (offset > data_size || size > data_size - offset)
+        {
+            return false;
+        }
+
+        uint32_t chunk_idx = resource_chunk(hailstorm, resource_idx);
+        if (chunk_idx >= hailstorm.chunks.size())
+        {
+            return false;
+        }
+
+        // Resources spanning multiple chunks are stored continuously over all 'Partial' chunks following the first one.
+        uint64_t const location = hailstorm.chunks[chunk_idx].offset + resource_offset(hailstorm, resource_idx) + offset;
+        while (chunk_idx + 1 < hailstorm.chunks.size()
+            && hailstorm.chunks[chunk_idx].offset + hailstorm.chunks[chunk_idx].size <= location)
+        {
+            chunk_idx += 1;
+        }
+
+        uint32_t last_chunk = chunk_idx;
+        while (last_chunk + 1 < hailstorm.chunks.size()
+            && hailstorm.chunks[last_chunk].offset + hailstorm.chunks[last_chunk].size < location + size)
+        {
+            last_chunk += 1;
+        }
+
+        // The range can't extend past the last chunk of the pack.
+        HailstormChunk const& end_chunk = hailstorm.chunks[last_chunk];
+        if (end_chunk.offset + end_chunk.size < location + size)
+        {
+            return false;
+        }
+
+        out_location = location;
+        out_first_chunk = chunk_idx;
+        out_count_chunks = size == 0 ? 0 : (last_chunk - chunk_idx) + 1;
+        return true;
+    }
+
+    auto resource_range_map(
+        hailstorm::v1::HailstormData const& hailstorm,
+        uint32_t resource_idx,
+        hailstorm::v1::HailstormByteRange const& range,
+        std::span<hailstorm::v1::HailstormResourceRangePart> out_parts,
+        uint32_t& out_count
+    ) noexcept -> hailstorm::Result
+    {
+        uint64_t location = 0;
+        uint32_t first_chunk = 0;
+        out_count = 0;
+        if (detail::resource_range_chunks(hailstorm, resource_idx, range.offset, range.size, location, first_chunk, out_count) == false)
+        {
+            return Result::E_InvalidArgument;
+        }
+        if (out_count > out_parts.size())
+        {
+            return Result::E_InvalidArgument;
+        }
+
+        uint64_t const end = location + range.size;
+        for (uint32_t idx = 0; idx < out_count; ++idx)
+        {
+            HailstormChunk const& chunk = hailstorm.chunks[first_chunk + idx];
+            uint64_t const part_begin = std::max(location, chunk.offset);
+            uint64_t const part_end = std::min(end, chunk.offset + chunk.size);
+
+            out_parts[idx] = HailstormResourceRangePart{
+                .chunk = first_chunk + idx,
+                .chunk_offset = part_begin - chunk.offset,
+                .resource_offset = range.offset + (part_begin - location),
+                .size = part_end - part_begin,
+            };
+        }
+        return Result::Success;
+    }
+
+    auto plan_reads(
+        hailstorm::v1::HailstormReadPlanParams const& params,
+        hailstorm::v1::HailstormData const& hailstorm,
+        std::span<uint32_t const> resources,
+        hailstorm::v1::HailstormReadPlan& out_plan
+    ) noexcept -> hailstorm::Result
+    {
+        uint32_t align = params.read_alignment;
+        if (align == 0)
+        {
+            align = std::max(hailstorm.header.pack_slice_alignment, Constant_ReadMinAlign);
+        }
+        if ((align & (align - 1)) != 0)
+        {
+            return Result::E_InvalidArgument;
+        }
+
+        for (uint32_t resource_idx : resources)
+        {
+            if (resource_idx >= hailstorm.resources.size())
+            {
+                return Result::E_InvalidArgument;
+            }
+        }
+
+        hailstorm::Array<ReadRange> ranges{ params.alloc };
+        ranges.reserve(uint32_t(resources.size()) * (params.read_metadata ? 2 : 1));
+        for (uint32_t target = 0; target < resources.size(); ++target)
+        {
+            uint32_t const resource_idx = resources[target];
+
+            ReadRange range = make_range(
+                hailstorm,
+                resource_chunk(hailstorm, resource_idx),
+                resource_offset(hailstorm, resource_idx),
+                resource_size(hailstorm, resource_idx),
+                params.read_whole_chunks,
+                align
+            );
+            range.target = target;
+            range.metadata = false;
+            ranges.push_back(range);
+
+            if (params.read_metadata)
+            {
+                range = make_range(
+                    hailstorm,
+                    resource_meta_chunk(hailstorm, resource_idx),
+                    resource_meta_offset(hailstorm, resource_idx),
+                    resource_meta_size(hailstorm, resource_idx),
+                    params.read_whole_chunks,
+                    align
+                );
+                range.target = target;
+                range.metadata = true;
+                ranges.push_back(range);
+            }
+        }
+
+        std::sort(ranges.begin(), ranges.end(), [](ReadRange const& left, ReadRange const& right) noexcept
+            {
+                return left.begin < right.begin || (left.begin == right.begin && left.end > right.end);
+            }
+        );
+
+        // Overlapping ranges are always merged, other ranges only if the gap and resulting read size are small enough.
+        uint32_t count_reads = 0;
+        uint64_t read_begin = 0;
+        uint64_t read_end = 0;
+        for (ReadRange& range : ranges)
+        {
+            bool const overlaps = count_reads > 0 && range.begin < read_end;
+            bool const mergeable = count_reads > 0
+                && range.begin - std::min(range.begin, read_end) <= params.merge_gap_threshold
+                && (params.max_read_size == 0 || std::max(read_end, range.end) - read_begin <= params.max_read_size);
+
+            if (overlaps || mergeable)
+            {
+                read_end = std::max(read_end, range.end);
+            }
+            else
+            {
+                count_reads += 1;
+                read_begin = range.begin;
+                read_end = range.end;
+            }
+            range.read = count_reads - 1;
+        }
+
+        out_plan = HailstormReadPlan{ .reads = { }, .targets = { }, .memory_size = 0, .memory_align = align, .memory = { } };
+        if (resources.empty())
+        {
+            return Result::Success;
+        }
+
+        size_t const reads_size = sizeof(HailstormReadOp) * count_reads;
+        out_plan.memory = params.alloc.allocate(reads_size + sizeof(HailstormReadTarget) * resources.size());
+        if (out_plan.memory.location == nullptr)
+        {
+            out_plan = HailstormReadPlan{ .reads = { }, .targets = { }, .memory_size = 0, .memory_align = align, .memory = { } };
+            return Result::E_OutOfMemory;
+        }
+
+        HailstormReadOp* const reads = reinterpret_cast<HailstormReadOp*>(out_plan.memory.location);
+        HailstormReadTarget* const targets = reinterpret_cast<HailstormReadTarget*>(ptr_add(out_plan.memory.location, reads_size));
+
+        // Reads are stored one after another in the destination buffer, their sizes are already aligned.
+        for (uint32_t idx = 0; idx < ranges.count(); ++idx)
+        {
+            ReadRange const& range = ranges[idx];
+            HailstormReadOp& read = reads[range.read];
+            if (idx == 0 || ranges[idx - 1].read != range.read)
+            {
+                read = HailstormReadOp{ .offset = range.begin, .size = 0, .memory_offset = out_plan.memory_size };
+            }
+
+            uint64_t const end = std::max(read.offset + read.size, range.end);
+            out_plan.memory_size += end - (read.offset + read.size);
+            read.size = end - read.offset;
+        }
+
+        for (HailstormReadTarget* target = targets; target != targets + resources.size(); ++target)
+        {
+            *target = HailstormReadTarget{ .data_offset = 0, .meta_offset = 0, .data_read = 0, .meta_read = Constant_HailstormInvalidIndex };
+        }
+        for (ReadRange const& range : ranges)
+        {
+            HailstormReadOp const& read = reads[range.read];
+            HailstormReadTarget& target = targets[range.target];
+            if (range.metadata)
+            {
+                target.meta_offset = read.memory_offset + (range.location - read.offset);
+                target.meta_read = range.read;
+            }
+            else
+            {
+                target.data_offset = read.memory_offset + (range.location - read.offset);
+                target.data_read = range.read;
+            }
+        }
+
+        out_plan.reads = std::span{ reads, count_reads };
+        out_plan.targets = std::span{ targets, resources.size() };
+        return Result::Success;
+    }
+
+} // namespace hailstorm::v1
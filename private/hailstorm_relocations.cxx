@@ -0,0 +1,172 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include "hailstorm_relocations.hxx"
+#include "hailstorm_deduplication.hxx"
+#include "hailstorm_memutils.hxx"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+namespace hailstorm::v1
+{
+
+    namespace detail
+    {
+
+        bool validate_relocations(hailstorm::v1::HailstormWriteData const& write_data) noexcept
+        {
+            if (write_data.relocations.empty())
+            {
+                return true;
+            }
+
+            if (write_data.relocations.size() != write_data.data.size())
+            {
+                return false;
+            }
+
+            for (uint32_t idx = 0; idx < write_data.relocations.size(); ++idx)
+            {
+                size_t const size = write_data.data[idx].size;
+                for (uint32_t const offset : write_data.relocations[idx])
+                {
+                    if (size < sizeof(uint64_t) || offset > size - sizeof(uint64_t))
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        auto count_relocations(hailstorm::v1::HailstormWriteData const& write_data) noexcept -> uint32_t
+        {
+            size_t count = 0;
+            for (uint32_t idx = 0; idx < write_data.relocations.size(); ++idx)
+            {
+                if (is_deduplicated(write_data, idx) == false)
+                {
+                    count += write_data.relocations[idx].size();
+                }
+            }
+            return uint32_t(count);
+        }
+
+        void build_relocations(
+            hailstorm::v1::HailstormWriteData const& write_data,
+            uint32_t chunk_count,
+            std::span<hailstorm::v1::HailstormResource const> resources,
+            void* section_data
+        ) noexcept
+        {
+            // Same layout as the 'ChunkResources' section, counting sort over the chunk each resource starts in.
+            uint32_t* const offsets = reinterpret_cast<uint32_t*>(section_data);
+            HailstormRelocation* const entries = reinterpret_cast<HailstormRelocation*>(offsets + chunk_count + 1);
+            std::memset(offsets, 0, sizeof(uint32_t) * (size_t{ chunk_count } + 1));
+            for (uint32_t idx = 0; idx < write_data.relocations.size(); ++idx)
+            {
+                if (is_deduplicated(write_data, idx) == false)
+                {
+                    offsets[resources[idx].chunk + 1] += uint32_t(write_data.relocations[idx].size());
+                }
+            }
+            for (uint32_t idx = 1; idx <= chunk_count; ++idx)
+            {
+                offsets[idx] += offsets[idx - 1];
+            }
+
+            // Each offset is moved to the end of it's range, which is the start of the next one.
+            for (uint32_t idx = 0; idx < write_data.relocations.size(); ++idx)
+            {
+                if (is_deduplicated(write_data, idx))
+                {
+                    continue;
+                }
+
+                HailstormResource const& res = resources[idx];
+                for (uint32_t const offset : write_data.relocations[idx])
+                {
+                    assert(size_t{ res.offset } + offset <= std::numeric_limits<uint32_t>::max());
+                    entries[offsets[res.chunk]++] = HailstormRelocation{ .offset = res.offset + offset, .resource_offset = res.offset };
+                }
+            }
+            std::memmove(offsets + 1, offsets, sizeof(uint32_t) * chunk_count);
+            offsets[0] = 0;
+
+            // Relocations are applied in a single pass over the chunk, so they are ordered by the patched location.
+            auto const by_offset = [](HailstormRelocation const& left, HailstormRelocation const& right) noexcept
+            {
+                return left.offset < right.offset;
+            };
+            for (uint32_t idx = 0; idx < chunk_count; ++idx)
+            {
+                if (std::is_sorted(entries + offsets[idx], entries + offsets[idx + 1], by_offset) == false)
+                {
+                    std::sort(entries + offsets[idx], entries + offsets[idx + 1], by_offset);
+                }
+            }
+        }
+
+    } // namespace detail
+
+    auto chunk_relocations(
+        hailstorm::v1::HailstormData const& hailstorm,
+        uint32_t chunk_idx
+    ) noexcept -> std::span<hailstorm::v1::HailstormRelocation const>
+    {
+        if (size_t{ chunk_idx } + 1 >= hailstorm.relocation_offsets.size())
+        {
+            return { };
+        }
+
+        uint32_t const first = hailstorm.relocation_offsets[chunk_idx];
+        uint32_t const last = hailstorm.relocation_offsets[chunk_idx + 1];
+        return hailstorm.relocations.subspan(first, last - first);
+    }
+
+    auto apply_relocations(
+        hailstorm::v1::HailstormData const& hailstorm,
+        uint32_t chunk_idx,
+        hailstorm::Memory chunk_memory
+    ) noexcept -> hailstorm::Result
+    {
+        if (size_t{ chunk_idx } + 1 >= hailstorm.relocation_offsets.size())
+        {
+            return Result::E_InvalidArgument;
+        }
+
+        std::span<HailstormRelocation const> const relocations = chunk_relocations(hailstorm, chunk_idx);
+        if (relocations.empty())
+        {
+            return Result::Success;
+        }
+
+        // Bounds are checked upfront, so the memory is either fully patched or not changed at all.
+        uint32_t max_offset = 0;
+        for (HailstormRelocation const& relocation : relocations)
+        {
+            max_offset = std::max(max_offset, relocation.offset);
+        }
+        if (chunk_memory.location == nullptr || chunk_memory.size < sizeof(uint64_t)
+            || max_offset > chunk_memory.size - sizeof(uint64_t))
+        {
+            return Result::E_InvalidArgument;
+        }
+
+        // Values are not required to be aligned, the 'memcpy' allows unaligned loads and stores.
+        uint64_t const chunk_address = reinterpret_cast<uintptr_t>(chunk_memory.location);
+        for (HailstormRelocation const& relocation : relocations)
+        {
+            void* const location = ptr_add(chunk_memory.location, relocation.offset);
+
+            uint64_t value;
+            std::memcpy(&value, location, sizeof(value));
+            value += chunk_address + relocation.resource_offset;
+            std::memcpy(location, &value, sizeof(value));
+        }
+        return Result::Success;
+    }
+
+} // namespace hailstorm::v1
@@ -0,0 +1,33 @@
+#pragma once
+#include <hailstorm/hailstorm_operations.hxx>
+
+namespace hailstorm::v1::detail
+{
+
+    //! \return 'true' if relocations where provided for the given resource.
+    inline bool has_relocations(hailstorm::v1::HailstormWriteData const& write_data, uint32_t idx) noexcept
+    {
+        return write_data.relocations.empty() == false && write_data.relocations[idx].empty() == false;
+    }
+
+    //! \return Size in bytes of the 'Relocations' section.
+    inline auto relocations_size(uint32_t chunk_count, uint32_t relocation_count) noexcept -> size_t
+    {
+        return sizeof(uint32_t) * (size_t{ chunk_count } + 1) + sizeof(HailstormRelocation) * relocation_count;
+    }
+
+    //! \return 'true' if no relocations where provided or all relocated values are stored within their resource data.
+    bool validate_relocations(hailstorm::v1::HailstormWriteData const& write_data) noexcept;
+
+    //! \return The number of relocations stored in the pack, resources mapped to another resource don't store their own.
+    auto count_relocations(hailstorm::v1::HailstormWriteData const& write_data) noexcept -> uint32_t;
+
+    //! \brief Fills the 'Relocations' section, needs to be called after locations of all resources are known.
+    void build_relocations(
+        hailstorm::v1::HailstormWriteData const& write_data,
+        uint32_t chunk_count,
+        std::span<hailstorm::v1::HailstormResource const> resources,
+        void* section_data
+    ) noexcept;
+
+} // namespace hailstorm::v1::detail
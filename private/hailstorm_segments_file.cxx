@@ -0,0 +1,70 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include <hailstorm/hailstorm_operations.hxx>
+#include "hailstorm_staging_ring.hxx"
+#include "hailstorm_memutils.hxx"
+#include "hailstorm_file.hxx"
+#include <cstring>
+
+namespace hailstorm::v1
+{
+
+    bool write_segments_file(
+        hailstorm::v1::HailstormFileWriteParams const& params,
+        std::span<hailstorm::Data const> segments
+    ) noexcept
+    {
+        uint32_t const align = params.unbuffered ? params.io_alignment : 1;
+        if (align == 0 || (align & (align - 1)) != 0)
+        {
+            return false;
+        }
+
+        FileOpenFlags flags = FileOpenFlags::Write | FileOpenFlags::Create;
+        if (params.unbuffered)
+        {
+            flags = flags | FileOpenFlags::Unbuffered;
+        }
+
+        hailstorm::NativeFileHandle const file = file_open(params.path, flags);
+        if (file == Constant_InvalidFileHandle)
+        {
+            return false;
+        }
+
+        uint64_t offset = 0;
+        bool success = false;
+        {
+            StagingRing ring{ params.alloc, file, 0, params.staging_buffer_size, params.staging_buffer_count, align };
+            success = ring.valid();
+
+            // Writes are split at buffer boundaries, so every buffer except the last one is filled completely and stays aligned.
+            size_t const buffer_size = ring.buffer_size();
+            for (hailstorm::Data const segment : segments)
+            {
+                size_t written = 0;
+                while (success && written < segment.size)
+                {
+                    size_t const write_size = std::min(segment.size - written, buffer_size - size_t(offset % buffer_size));
+                    hailstorm::Memory const memory = ring.acquire(offset, write_size);
+                    success = memory.location != nullptr;
+                    if (success)
+                    {
+                        std::memcpy(memory.location, ptr_add(segment.location, written), write_size);
+                        written += write_size;
+                        offset += write_size;
+                    }
+                }
+            }
+
+            success = success && ring.pad_to(align_to(offset, align)) && ring.flush();
+        }
+
+        // Remove the padding of the last block, which is only necessary for unaligned clusters.
+        success = success && (align_to(offset, align) == offset || file_resize(file, offset));
+        file_close(file);
+        return success;
+    }
+
+} // namespace hailstorm::v1
@@ -0,0 +1,240 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include "hailstorm_staging_ring.hxx"
+#include "hailstorm_memutils.hxx"
+#include "hailstorm_file.hxx"
+#include <cassert>
+#include <cstring>
+#include <system_error>
+
+namespace hailstorm
+{
+
+    StagingRing::StagingRing(
+        hailstorm::Allocator& alloc,
+        hailstorm::NativeFileHandle file,
+        uint64_t file_offset,
+        size_t buffer_size,
+        uint32_t buffer_count,
+        uint32_t alignment
+    ) noexcept
+        : _allocator{ alloc }
+        , _file{ file }
+        , _file_offset{ file_offset }
+        , _alignment{ std::max<uint32_t>(alignment, 1) }
+        , _buffer_size{ align_to(std::max<size_t>(buffer_size, 4 * Constant_1KiB), _alignment) }
+        , _buffer_count{ std::max<uint32_t>(buffer_count, 1) }
+        , _buffers{ nullptr }
+        , _current_active{ false }
+        , _high_water{ 0 }
+        , _filled{ 0 }
+        , _submitted{ 0 }
+        , _completed{ 0 }
+        , _stop{ false }
+        , _failed{ false }
+    {
+        hailstorm::Memory const buffers_mem = _allocator.allocate(sizeof(Buffer) * _buffer_count);
+        _buffers = reinterpret_cast<Buffer*>(buffers_mem.location);
+        _failed = _buffers == nullptr;
+
+        for (uint32_t idx = 0; _failed == false && idx < _buffer_count; ++idx)
+        {
+            _buffers[idx] = Buffer{ .memory = {}, .data = nullptr, .offset = 0, .used = 0 };
+        }
+
+        for (uint32_t idx = 0; _failed == false && idx < _buffer_count; ++idx)
+        {
+            // The allocator interface does not take an alignment, so aligned buffers are over-allocated.
+            _buffers[idx].memory = _allocator.allocate(_buffer_size + (_alignment > 1 ? _alignment : 0));
+            _buffers[idx].data = align_to(_buffers[idx].memory.location, _alignment);
+            _failed = _buffers[idx].memory.location == nullptr;
+        }
+
+        // Thread creation reports failures using exceptions, which are not allowed to leave the constructor.
+        if (_failed == false)
+        {
+            try
+            {
+                _thread = std::thread{ [this]() noexcept { io_thread(); } };
+            }
+            catch (std::system_error const&)
+            {
+                _failed = true;
+            }
+        }
+    }
+
+    StagingRing::~StagingRing() noexcept
+    {
+        if (_thread.joinable())
+        {
+            flush();
+            {
+                std::lock_guard lk{ _mutex };
+                _stop = true;
+            }
+            _cv_submitted.notify_one();
+            _thread.join();
+        }
+
+        if (_buffers != nullptr)
+        {
+            for (uint32_t idx = 0; idx < _buffer_count; ++idx)
+            {
+                if (_buffers[idx].memory.location != nullptr)
+                {
+                    _allocator.deallocate(_buffers[idx].memory);
+                }
+            }
+            _allocator.deallocate(_buffers);
+        }
+    }
+
+    bool StagingRing::valid() const noexcept
+    {
+        return _failed.load(std::memory_order_relaxed) == false;
+    }
+
+    auto StagingRing::acquire(uint64_t offset, size_t size) noexcept -> hailstorm::Memory
+    {
+        assert(size <= _buffer_size);
+        if (valid() == false)
+        {
+            return {};
+        }
+
+        if (_current_active)
+        {
+            Buffer& current = _buffers[_filled % _buffer_count];
+            uint64_t const current_end = current.offset + current.used;
+
+            // We can only fill the gap if nothing was ever written past the current buffer.
+            bool const continuous = offset == current_end
+                || (offset > current_end && current_end == _high_water);
+
+            if (continuous && (offset + size) <= (current.offset + _buffer_size))
+            {
+                std::memset(ptr_add(current.data, current.used), 0, offset - current_end);
+                current.used = (offset - current.offset) + size;
+                _high_water = std::max(_high_water, offset + size);
+
+                return hailstorm::Memory{
+                    .location = ptr_add(current.data, offset - current.offset),
+                    .size = size,
+                    .align = 1
+                };
+            }
+
+            submit_current();
+        }
+
+        // Wait for a free buffer
+        {
+            std::unique_lock lk{ _mutex };
+            _cv_completed.wait(lk, [this]() noexcept { return (_filled - _completed) < _buffer_count; });
+        }
+
+        Buffer& next = _buffers[_filled % _buffer_count];
+        next.offset = offset;
+        next.used = size;
+        _current_active = true;
+        _high_water = std::max(_high_water, offset + size);
+        return hailstorm::Memory{ .location = next.data, .size = size, .align = 1 };
+    }
+
+    bool StagingRing::write(uint64_t offset, hailstorm::Data data) noexcept
+    {
+        size_t written = 0;
+        while (written < data.size)
+        {
+            size_t const write_size = std::min(data.size - written, _buffer_size);
+            hailstorm::Memory const mem = acquire(offset + written, write_size);
+            if (mem.location == nullptr)
+            {
+                return false;
+            }
+
+            std::memcpy(mem.location, ptr_add(data.location, written), write_size);
+            written += write_size;
+        }
+        return valid();
+    }
+
+    bool StagingRing::pad_to(uint64_t offset) noexcept
+    {
+        while (_high_water < offset)
+        {
+            size_t const pad_size = size_t(std::min<uint64_t>(offset - _high_water, _buffer_size));
+            hailstorm::Memory const mem = acquire(_high_water, pad_size);
+            if (mem.location == nullptr)
+            {
+                return false;
+            }
+            std::memset(mem.location, 0, pad_size);
+        }
+        return valid();
+    }
+
+    bool StagingRing::flush() noexcept
+    {
+        if (_current_active)
+        {
+            submit_current();
+        }
+
+        std::unique_lock lk{ _mutex };
+        _cv_completed.wait(lk, [this]() noexcept { return _completed == _filled; });
+        return valid();
+    }
+
+    void StagingRing::submit_current() noexcept
+    {
+        assert(_current_active);
+        _current_active = false;
+        {
+            std::lock_guard lk{ _mutex };
+            _filled += 1;
+            _submitted = _filled;
+        }
+        _cv_submitted.notify_one();
+    }
+
+    void StagingRing::io_thread() noexcept
+    {
+        std::unique_lock lk{ _mutex };
+        while (true)
+        {
+            _cv_submitted.wait(lk, [this]() noexcept { return _stop || _completed != _submitted; });
+            if (_completed == _submitted && _stop)
+            {
+                break;
+            }
+
+            // Write buffers without holding the lock, the filling thread never touches submitted buffers.
+            uint32_t const pending_end = _submitted;
+            uint32_t pending = _completed;
+            lk.unlock();
+
+            while (pending != pending_end)
+            {
+                Buffer const& buffer = _buffers[pending % _buffer_count];
+                bool const aligned = ((_file_offset + buffer.offset) % _alignment) == 0 && (buffer.used % _alignment) == 0;
+                if (valid() && (aligned == false || file_write_at(_file, { buffer.data, buffer.used, _alignment }, _file_offset + buffer.offset) == false))
+                {
+                    _failed.store(true, std::memory_order_relaxed);
+                }
+
+                pending += 1;
+                {
+                    std::lock_guard lk_completed{ _mutex };
+                    _completed = pending;
+                }
+                _cv_completed.notify_one();
+            }
+
+            lk.lock();
+        }
+    }
+
+} // namespace hailstorm
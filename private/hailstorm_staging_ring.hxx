@@ -0,0 +1,97 @@
+#pragma once
+#include <hailstorm/hailstorm_types.hxx>
+#include <condition_variable>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace hailstorm
+{
+
+    //! \brief A bounded ring of staging buffers that are written to a file on a background thread.
+    //! \details Writes are gathered into the current buffer as long as they are continuous. Once a write can't be
+    //!   placed in the current buffer, it's submitted for writing and the next free buffer is used. If all buffers
+    //!   are in-flight the caller blocks until one of them is written.
+    //!
+    //! \note With an 'alignment' bigger than '1', buffer memory, sizes and file offsets are aligned as required for
+    //!   unbuffered file access. Each submitted buffer is checked and the ring fails instead of issuing a misaligned write.
+    class StagingRing final
+    {
+    public:
+        StagingRing(
+            hailstorm::Allocator& alloc,
+            hailstorm::NativeFileHandle file,
+            uint64_t file_offset,
+            size_t buffer_size,
+            uint32_t buffer_count,
+            uint32_t alignment = 1
+        ) noexcept;
+
+        ~StagingRing() noexcept;
+
+        //! \return 'true' if no errors happened so far.
+        bool valid() const noexcept;
+
+        //! \return The maximum size that can be requested using 'acquire'.
+        auto buffer_size() const noexcept -> size_t { return _buffer_size; }
+
+        //! \brief Returns staging memory that will be written at the given offset.
+        //! \note The memory is only valid until the next call to any of the ring methods.
+        //! \pre The size is not bigger than 'buffer_size()'.
+        //! \return An empty memory block if an error happened.
+        auto acquire(uint64_t offset, size_t size) noexcept -> hailstorm::Memory;
+
+        //! \brief Copies the data into staging buffers, splitting it if necessary.
+        bool write(uint64_t offset, hailstorm::Data data) noexcept;
+
+        //! \brief Ensures all bytes up to the given offset exist in the file, filling the tail with zeros if necessary.
+        bool pad_to(uint64_t offset) noexcept;
+
+        //! \brief Submits the current buffer and waits for all writes to finish.
+        bool flush() noexcept;
+
+        StagingRing(StagingRing const&) noexcept = delete;
+        auto operator=(StagingRing const&) noexcept -> StagingRing& = delete;
+
+    private:
+        struct Buffer
+        {
+            hailstorm::Memory memory;
+
+            //! \brief Start of the buffer data, aligned to the ring alignment.
+            void* data;
+            uint64_t offset;
+            size_t used;
+        };
+
+        void submit_current() noexcept;
+        void io_thread() noexcept;
+
+    private:
+        hailstorm::Allocator& _allocator;
+        hailstorm::NativeFileHandle const _file;
+        uint64_t const _file_offset;
+        uint32_t const _alignment;
+        size_t const _buffer_size;
+        uint32_t const _buffer_count;
+
+        Buffer* _buffers;
+        bool _current_active;
+
+        //! \brief The end of the highest range ever requested. Gaps past this offset can be safely zero-filled.
+        uint64_t _high_water;
+
+        // Monotonic counters, the buffer index is 'counter % _buffer_count'.
+        uint32_t _filled;
+        uint32_t _submitted;
+        uint32_t _completed;
+        bool _stop;
+
+        std::atomic_bool _failed;
+        std::mutex _mutex;
+        std::condition_variable _cv_submitted;
+        std::condition_variable _cv_completed;
+        std::thread _thread;
+    };
+
+} // namespace hailstorm
@@ -11,7 +11,7 @@ namespace hailstorm
         inline auto get_return_object() noexcept -> Task;
 
         constexpr auto initial_suspend() const noexcept { return std::suspend_never{}; }
-        constexpr auto final_suspend() const noexcept { return std::suspend_never{}; }
+        constexpr auto final_suspend() const noexcept { return std::suspend_always{}; }
         constexpr void unhandled_exception() const noexcept { }
 
         inline void return_value(hailstorm::Memory memory) noexcept
@@ -19,7 +19,7 @@ namespace hailstorm
             _result = memory;
         }
 
-        hailstorm::Memory _result;
+        hailstorm::Memory _result{ };
     };
 
     class Task final
@@ -32,11 +32,17 @@ namespace hailstorm
         {
         }
 
-        // We don't destroy the coro, since we already never suspend on the final suspend point.
-        inline ~Task() noexcept = default;
+        // The coroutine is either done, or was suspended after a failed stage and will never be resumed.
+        inline ~Task() noexcept { _coro.destroy(); }
+
+        Task(Task const&) = delete;
+        auto operator=(Task const&) -> Task& = delete;
 
         inline operator bool() const noexcept { return _coro.done(); }
 
+        //! \brief Resumes a coroutine suspended on a stage that is waiting for external work.
+        inline void resume() const noexcept { _coro.resume(); }
+
         inline auto result_memory() const noexcept { return _coro.promise()._result; }
 
     private:
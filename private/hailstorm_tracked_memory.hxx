@@ -6,15 +6,19 @@ namespace hailstorm
 
     struct TrackedMemory final : hailstorm::Memory
     {
+        //! \note Nothing is allocated for a size of '0'.
         inline explicit TrackedMemory(hailstorm::Allocator& alloc, size_t req) noexcept
-            : Memory{ alloc.allocate(req) }
+            : Memory{ req > 0 ? alloc.allocate(req) : hailstorm::Memory{ } }
             , _allocator{ alloc }
         {
         }
 
         inline ~TrackedMemory() noexcept
         {
-            _allocator.deallocate(*this);
+            if (location != nullptr)
+            {
+                _allocator.deallocate(*this);
+            }
         }
 
         hailstorm::Allocator& _allocator;
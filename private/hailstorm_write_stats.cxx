@@ -0,0 +1,171 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#include "hailstorm_write_stats.hxx"
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace hailstorm::v1::detail
+{
+
+    static constexpr char const* Constant_WritePhaseNames[]{
+        "Hailstorm::Deduplication",
+        "Hailstorm::Compression",
+        "Hailstorm::ChunkEstimation",
+        "Hailstorm::Header",
+        "Hailstorm::ResourceData",
+        "Hailstorm::CustomChunks",
+        "Hailstorm::Encryption",
+        "Hailstorm::Paths",
+        "Hailstorm::Sections",
+    };
+
+    static_assert(std::size(Constant_WritePhaseNames) == size_t(HailstormWritePhase::Count));
+
+    TrackingAllocator::TrackingAllocator(hailstorm::Allocator& backing_alloc) noexcept
+        : _backing_alloc{ backing_alloc }
+        , _allocations{ backing_alloc }
+        , _current_size{ 0 }
+        , _peak_size{ 0 }
+        , _count_allocations{ 0 }
+    {
+    }
+
+    auto TrackingAllocator::allocate(size_t size) noexcept -> hailstorm::Memory
+    {
+        hailstorm::Memory const memory = _backing_alloc.allocate(size);
+        if (memory.location != nullptr)
+        {
+            _allocations.push_back({ memory.location, size });
+            _current_size += size;
+            _peak_size = std::max(_peak_size, _current_size);
+            _count_allocations += 1;
+        }
+        return memory;
+    }
+
+    void TrackingAllocator::deallocate(void* ptr) noexcept
+    {
+        release(ptr);
+        _backing_alloc.deallocate(ptr);
+    }
+
+    void TrackingAllocator::deallocate(hailstorm::Memory mem) noexcept
+    {
+        release(mem.location);
+        _backing_alloc.deallocate(mem);
+    }
+
+    void TrackingAllocator::release(void* ptr) noexcept
+    {
+        for (Allocation& allocation : _allocations)
+        {
+            if (allocation.location == ptr)
+            {
+                _current_size -= allocation.size;
+                allocation = _allocations[_allocations.count() - 1];
+                _allocations.resize(_allocations.count() - 1);
+                return;
+            }
+        }
+    }
+
+    WriteProfiler::WriteProfiler(hailstorm::v1::HailstormWriteParams const& params, hailstorm::Allocator& temp_alloc) noexcept
+        : stats{ }
+        , _params{ params }
+        , _temp_alloc{ temp_alloc }
+        , _collect_stats{ params.fn_write_stats != nullptr }
+        , _report_zones{ params.fn_profile_zone_begin != nullptr && params.fn_profile_zone_end != nullptr }
+        , _tracking_alloc{ temp_alloc }
+        , _chunk_stats{ temp_alloc }
+        , _phase_start{ }
+        , _phase{ HailstormWritePhase::Count }
+    {
+    }
+
+    WriteProfiler::~WriteProfiler() noexcept
+    {
+        leave();
+    }
+
+    auto WriteProfiler::temp_allocator() noexcept -> hailstorm::Allocator&
+    {
+        return _collect_stats ? _tracking_alloc : _temp_alloc;
+    }
+
+    void WriteProfiler::enter(hailstorm::v1::HailstormWritePhase phase) noexcept
+    {
+        assert(phase != HailstormWritePhase::Count);
+        leave();
+
+        if (_collect_stats)
+        {
+            _phase_start = std::chrono::steady_clock::now();
+        }
+        if (_report_zones)
+        {
+            _params.fn_profile_zone_begin(phase, Constant_WritePhaseNames[size_t(phase)], _params.userdata);
+        }
+        _phase = phase;
+    }
+
+    void WriteProfiler::leave() noexcept
+    {
+        if (_phase == HailstormWritePhase::Count)
+        {
+            return;
+        }
+
+        if (_collect_stats)
+        {
+            auto const elapsed = std::chrono::steady_clock::now() - _phase_start;
+            stats.phase_time_ns[size_t(_phase)] += uint64_t(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()
+            );
+        }
+        if (_report_zones)
+        {
+            _params.fn_profile_zone_end(_phase, _params.userdata);
+        }
+        _phase = HailstormWritePhase::Count;
+    }
+
+    void WriteProfiler::prepare_chunks(uint32_t chunk_count) noexcept
+    {
+        if (_collect_stats)
+        {
+            _chunk_stats.resize(chunk_count);
+            _chunk_stats.memset(0);
+        }
+    }
+
+    void WriteProfiler::report(
+        std::span<hailstorm::v1::HailstormChunk const> chunks,
+        size_t cluster_size
+    ) noexcept
+    {
+        leave();
+        if (_collect_stats == false)
+        {
+            return;
+        }
+
+        assert(_chunk_stats.count() == chunks.size());
+        for (uint32_t idx = 0; idx < _chunk_stats.count(); ++idx)
+        {
+            HailstormWriteChunkStats& chunk_stats = _chunk_stats[idx];
+            chunk_stats.padding_size = chunks[idx].size - std::min<size_t>(chunks[idx].size, chunk_stats.used_size);
+            stats.padding_size += chunk_stats.padding_size;
+        }
+
+        stats.count_chunks = uint32_t(chunks.size());
+        stats.count_temp_allocations = _tracking_alloc.count_allocations();
+        stats.temp_alloc_peak_size = _tracking_alloc.peak_size();
+        stats.cluster_size = cluster_size;
+
+        std::span<HailstormWriteChunkStats const> const chunk_stats = std::as_const(_chunk_stats);
+        _params.fn_write_stats(stats, chunk_stats, _params.userdata);
+    }
+
+} // namespace hailstorm::v1::detail
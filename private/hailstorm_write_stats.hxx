@@ -0,0 +1,96 @@
+#pragma once
+#include <hailstorm/hailstorm_operations.hxx>
+#include "hailstorm_array.hxx"
+#include <chrono>
+
+namespace hailstorm::v1::detail
+{
+
+    //! \brief Allocator forwarding all requests to a backing allocator while tracking the number of allocated bytes.
+    //! \note Not thread-safe, temporary allocations of a write operation are only made from the thread that started it.
+    class TrackingAllocator final : public hailstorm::Allocator
+    {
+    public:
+        explicit TrackingAllocator(hailstorm::Allocator& backing_alloc) noexcept;
+
+        auto allocate(size_t size) noexcept -> hailstorm::Memory override;
+        void deallocate(void* ptr) noexcept override;
+        void deallocate(hailstorm::Memory mem) noexcept override;
+
+        auto peak_size() const noexcept -> size_t { return _peak_size; }
+        auto count_allocations() const noexcept -> uint32_t { return _count_allocations; }
+
+    private:
+        void release(void* ptr) noexcept;
+
+    private:
+        struct Allocation
+        {
+            void* location;
+            size_t size;
+        };
+
+        hailstorm::Allocator& _backing_alloc;
+
+        //! \brief Live allocations, there are only a few of them at any time so the list is searched linearly.
+        hailstorm::Array<Allocation> _allocations;
+        size_t _current_size;
+        size_t _peak_size;
+        uint32_t _count_allocations;
+    };
+
+    //! \brief Collects statistics and reports profiling zones for a single write operation.
+    //! \note Without 'fn_write_stats' and zone functions provided, all operations are no-ops.
+    class WriteProfiler final
+    {
+    public:
+        //! \param [in] temp_alloc Allocator backing all temporary allocations, usually 'params.temp_alloc'.
+        WriteProfiler(hailstorm::v1::HailstormWriteParams const& params, hailstorm::Allocator& temp_alloc) noexcept;
+
+        //! \note Leaves the current phase, so zones are properly closed even if the write operation failed.
+        ~WriteProfiler() noexcept;
+
+        //! \return The allocator to be used for all temporary allocations of the write operation.
+        auto temp_allocator() noexcept -> hailstorm::Allocator&;
+
+        //! \brief Leaves the current phase, if any, and enters the given one.
+        void enter(hailstorm::v1::HailstormWritePhase phase) noexcept;
+
+        //! \brief Leaves the current phase, if any.
+        void leave() noexcept;
+
+        //! \brief Prepares per-chunk statistics, needs to be called once all chunks are known.
+        void prepare_chunks(uint32_t chunk_count) noexcept;
+
+        //! \brief Tracks bytes of resource data or metadata stored in the given chunk.
+        void add_chunk_data(uint32_t chunk_idx, size_t size) noexcept
+        {
+            if (_chunk_stats.any())
+            {
+                _chunk_stats[chunk_idx].used_size += size;
+            }
+        }
+
+        //! \brief Finishes collecting statistics and calls 'fn_write_stats'.
+        void report(
+            std::span<hailstorm::v1::HailstormChunk const> chunks,
+            size_t cluster_size
+        ) noexcept;
+
+        //! \brief Statistics collected so far, counters are updated directly by the write operation.
+        hailstorm::v1::HailstormWriteStats stats;
+
+    private:
+        hailstorm::v1::HailstormWriteParams const& _params;
+        hailstorm::Allocator& _temp_alloc;
+        bool const _collect_stats;
+        bool const _report_zones;
+
+        TrackingAllocator _tracking_alloc;
+        hailstorm::Array<hailstorm::v1::HailstormWriteChunkStats> _chunk_stats;
+
+        std::chrono::steady_clock::time_point _phase_start;
+        hailstorm::v1::HailstormWritePhase _phase;
+    };
+
+} // namespace hailstorm::v1::detail
@@ -13,6 +13,9 @@ namespace hailstorm
     //! \brief A word value used to identify the Hailstorm format specification version.
     static constexpr uint32_t Constant_HailstormHeaderVersionV0 = 'HSC0';
 
+    //! \brief A value used to represent an invalid resource, chunk or section index.
+    static constexpr uint32_t Constant_HailstormInvalidIndex = 0xffff'ffffu;
+
     //! \brief A base header, always present in any Hailstorm version. Allows to properly select the API version
     //!   and the total size of header data.
     //! \note As long as the whole header size is loaded into memory, all header values, regardless of the version,
@@ -51,7 +54,11 @@ namespace hailstorm
             //! \note All other HS header types (chunk, resource, resource_id, paths) may introduce ABI breaking changes.
             uint8_t version[3];
 
-            //! \brief ALL chunk data is encrypted separately. Load the whole file and decrypt it before reading.
+            //! \brief ALL chunk data is encrypted separately for each chunk, header data, paths and sections are not encrypted.
+            //! \details Chunks are encrypted using ChaCha20 with a nonce derived from the chunk index, so any byte range of a chunk
+            //!   can be decrypted on it's own, allowing to stream or memory map encrypted packs.
+            //! \note Chunk checksums are calculated over the encrypted data.
+            //! \see hailstorm::v1::decrypt_chunk_data, hailstorm::v1::HailstormEncryptionKey
             uint8_t is_encrypted : 1;
 
             //! \brief This is an expansion data pack and does only contain patched or additional game/program data.
@@ -63,11 +70,18 @@ namespace hailstorm
             uint8_t is_patch : 1;
 
             //! \brief The data stored in this pack is pre-baked and can be consumed directly by most engine systems.
+            //! \note Pointers stored in baked data can be restored after loading a chunk using the 'Relocations' section.
+            //! \see hailstorm::v1::apply_relocations
             uint8_t is_baked : 1;
 
+            //! \brief The header contains a list of additional sections stored right after the resources table.
+            //! \see HailstormSections
+            //! \version HSC0-0.0.2
+            uint8_t has_sections : 1;
+
             //! \brief Reserved for future use.
             //! \version HSC0-0.0.1
-            uint8_t _unused04b : 4;
+            uint8_t _unused03b : 3;
 
             //! \brief Number of data chunks in this pack.
             uint32_t count_chunks;
@@ -236,6 +250,133 @@ namespace hailstorm
         static_assert(sizeof(HailstormResource) == 36);
         static_assert(alignof(HailstormChunk) >= alignof(HailstormResource));
 
+        //! \brief Types of optional sections that can be stored in a pack.
+        //! \version HSC0-0.0.2
+        enum class HailstormSectionType : uint32_t
+        {
+            //! \brief Reserved, never written.
+            Invalid = 0,
+
+            //! \brief Hash table mapping resource path hashes to resource indices.
+            //! \see HailstormPathsIndexEntry
+            PathsIndex = 1,
+
+            //! \brief CRC32C checksums of all chunks, 'count_entries' is equal to 'HailstormHeader::count_chunks'.
+            //! \details Each entry is a single 'uint32_t' value, calculated over all 'HailstormChunk::size' bytes of the chunk
+            //!   starting at 'HailstormChunk::offset', including padding between entries.
+            //! \see hailstorm::v1::verify_chunk
+            ChunkChecksums = 2,
+
+            //! \brief Resources grouped by the chunk their data is stored in, 'count_entries' is equal to 'HailstormHeader::count_chunks'.
+            //! \details Starts with 'count_chunks + 1' 'uint32_t' offsets followed by 'count_resources' 'uint32_t' resource indices.
+            //!   Resources of chunk 'N' are stored in the range ['offsets[N]', 'offsets[N + 1]'), ordered by their offset in the chunk.
+            //!   Resources stored across multiple chunks are only listed for the chunk their data starts in.
+            //! \see hailstorm::v1::chunk_resources
+            ChunkResources = 3,
+
+            //! \brief Copy of the most accessed resource fields stored as columns, 'count_entries' is equal to 'HailstormHeader::count_resources'.
+            //! \details Stores 'uint32_t' columns of 'offset', 'size', 'meta_offset' and 'meta_size' values, followed by
+            //!   columns of 'chunk' and 'meta_chunk' values. Chunk columns use 'uint16_t' values if 'count_chunks' is not
+            //!   bigger than '65536', otherwise 'uint32_t' values.
+            //! \see HailstormResourceColumns
+            ResourceColumns = 4,
+
+            //! \brief Locations of pointers stored in resource data grouped by chunk, 'count_entries' is the number of relocations.
+            //! \details Starts with 'count_chunks + 1' 'uint32_t' offsets followed by 'count_entries' 'HailstormRelocation' entries.
+            //!   Relocations of chunk 'N' are stored in the range ['offsets[N]', 'offsets[N + 1]'), ordered by their offset in the chunk.
+            //!   Resources with relocations are always stored within a single chunk.
+            //! \see hailstorm::v1::apply_relocations
+            Relocations = 5,
+        };
+
+        //! \brief Hailstorm sections information. Stored after the resources table, aligned to '8' bytes.
+        //! \note Only present if 'HailstormHeader::has_sections' is set.
+        //! \version HSC0-0.0.2
+        struct HailstormSections
+        {
+            //! \brief Number of 'HailstormSection' entries following this struct.
+            uint32_t count;
+
+            uint32_t _unused4B;
+        };
+
+        static_assert(sizeof(HailstormSections) == 8);
+
+        //! \brief Hailstorm section information, describes an optional data block stored in the pack.
+        //! \note Section data is stored after the 'paths' data and before the first chunk, so loading the pack up to
+        //!   'HailstormHeader::offset_data' provides access to all sections.
+        //! \version HSC0-0.0.2
+        struct HailstormSection
+        {
+            //! \brief Offset in file where section data is stored.
+            uint64_t offset;
+
+            //! \brief Total size of section data.
+            uint64_t size;
+
+            //! \brief The type of data stored in this section.
+            hailstorm::v1::HailstormSectionType type;
+
+            //! \brief Number of entries stored in this section. The meaning depends on the section type.
+            uint32_t count_entries;
+        };
+
+        static_assert(sizeof(HailstormSection) == 24);
+        static_assert((sizeof(HailstormSections) % alignof(HailstormSection)) == 0);
+
+        //! \brief A single slot of the 'PathsIndex' section.
+        //! \details The section is an open-addressing hash table with linear probing. The number of slots is a power of '2'
+        //!   and is stored in 'HailstormSection::count_entries'. The initial slot is selected with 'hash & (count_entries - 1)'.
+        //! \note Path hashes are calculated using 'hailstorm::v1::hash_path'.
+        //! \version HSC0-0.0.2
+        struct HailstormPathsIndexEntry
+        {
+            //! \brief The hash of the resource path.
+            uint64_t hash;
+
+            //! \brief The resource index or 'Constant_HailstormInvalidIndex' if the slot is empty.
+            uint32_t resource;
+
+            //! \brief Set to '1' if at least one other path in the pack has the exact same hash value.
+            //! \note Only in such a case the path needs to be compared to find the proper resource.
+            uint32_t collision;
+        };
+
+        static_assert(sizeof(HailstormPathsIndexEntry) == 16);
+
+        //! \brief View of the 'ResourceColumns' section, allows to scan resource locations without loading whole resource entries.
+        //! \note Use accessors like 'hailstorm::v1::resource_chunk' to access values independent of the available layout.
+        //! \version HSC0-0.0.2
+        struct HailstormResourceColumns
+        {
+            std::span<uint32_t const> offsets;
+            std::span<uint32_t const> sizes;
+            std::span<uint32_t const> meta_offsets;
+            std::span<uint32_t const> meta_sizes;
+
+            //! \brief Chunk index columns, storing 'uint16_t' or 'uint32_t' values depending on 'chunk_index_size'.
+            void const* chunks;
+            void const* meta_chunks;
+
+            //! \brief Size in bytes of a single chunk index, either '2' or '4'. Set to '0' if the section is not available.
+            uint32_t chunk_index_size;
+        };
+
+        //! \brief A single entry of the 'Relocations' section, describing a 64-bit value patched after a chunk was loaded.
+        //! \details The stored value is an offset relative to the start of the resource data. Applying the relocation adds
+        //!   the address of the resource data, so the value becomes a pointer into the loaded chunk.
+        //! \version HSC0-0.0.2
+        struct HailstormRelocation
+        {
+            //! \brief Offset of the patched value relative to the start of the chunk.
+            uint32_t offset;
+
+            //! \brief Offset of the resource data relative to the start of the chunk.
+            uint32_t resource_offset;
+        };
+
+        static_assert(sizeof(HailstormRelocation) == 8);
+
         //! \brief Struct providing access to Hailstorm header data wrapped in a more accessible way.
         //! \note This struct can be filled using the hailstorm::read_header function.
         struct HailstormData
@@ -245,12 +386,54 @@ namespace hailstorm
             std::span<hailstorm::v1::HailstormResource const> resources;
             hailstorm::v1::HailstormPaths paths;
             hailstorm::Data paths_data;
+
+            //! \brief Optional sections stored in the pack. Empty if 'header.has_sections' is not set.
+            std::span<hailstorm::v1::HailstormSection const> sections;
+
+            //! \brief Path hash table, only available if the section was written and it's data was provided to 'read_header'.
+            std::span<hailstorm::v1::HailstormPathsIndexEntry const> paths_index;
+
+            //! \brief Checksums of each chunk, only available if the section was written and it's data was provided to 'read_header'.
+            std::span<uint32_t const> chunk_checksums;
+
+            //! \brief Offsets into 'chunk_resource_indices' for each chunk, followed by the total count.
+            //! \note Only available if the section was written and it's data was provided to 'read_header'.
+            //! \see hailstorm::v1::chunk_resources
+            std::span<uint32_t const> chunk_resource_offsets;
+
+            //! \brief Resource indices grouped by chunk, \see HailstormSectionType::ChunkResources.
+            std::span<uint32_t const> chunk_resource_indices;
+
+            //! \brief Column copy of resource fields, only available if the section was written and it's data was provided to 'read_header'.
+            hailstorm::v1::HailstormResourceColumns resource_columns;
+
+            //! \brief Offsets into 'relocations' for each chunk, followed by the total count.
+            //! \note Only available if the section was written and it's data was provided to 'read_header'.
+            //! \see hailstorm::v1::apply_relocations
+            std::span<uint32_t const> relocation_offsets;
+
+            //! \brief Relocations grouped by chunk, \see HailstormSectionType::Relocations.
+            std::span<hailstorm::v1::HailstormRelocation const> relocations;
         };
 
         struct HailstormReadParams;
+        struct HailstormHeaderLayout;
         struct HailstormWriteParams;
         struct HailstormWriteData;
         struct HailstormAsyncWriteParams;
+        struct HailstormAsyncWriteCompletion;
+        struct HailstormParallelWriteParams;
+        struct HailstormBatchWriteParams;
+        struct HailstormStreamWriteParams;
+        struct HailstormWriteSegments;
+        struct HailstormFileWriteParams;
+        struct HailstormRepackData;
+        struct HailstormVerifyParams;
+        struct HailstormReadPlanParams;
+        struct HailstormReadPlan;
+        struct HailstormByteRange;
+        struct HailstormResourceRangePart;
+        struct HailstormEncryptionKey;
 
     } // namespace v1
 
@@ -259,6 +442,12 @@ namespace hailstorm
     using HailstormPaths = v1::HailstormPaths;
     using HailstormChunk = v1::HailstormChunk;
     using HailstormResource = v1::HailstormResource;
+    using HailstormSectionType = v1::HailstormSectionType;
+    using HailstormSections = v1::HailstormSections;
+    using HailstormSection = v1::HailstormSection;
+    using HailstormPathsIndexEntry = v1::HailstormPathsIndexEntry;
+    using HailstormResourceColumns = v1::HailstormResourceColumns;
+    using HailstormRelocation = v1::HailstormRelocation;
     using HailstormData = v1::HailstormData;
 
 } // namespace hailstorm
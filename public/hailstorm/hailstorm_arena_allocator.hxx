@@ -0,0 +1,73 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <hailstorm/hailstorm_types.hxx>
+
+namespace hailstorm
+{
+
+    namespace v1
+    {
+
+        //! \brief Monotonic allocator handing out memory from large blocks requested from a backing allocator.
+        //!
+        //! \details Deallocations do not release any memory, except for the most recent allocation which is rolled back.
+        //!   All memory is released at once when calling 'reset', however blocks are kept and reused by later allocations.
+        //!   This makes it a good fit for the 'temp_alloc' allocator when writing many packs, since after the first
+        //!   write no more requests are made to the backing allocator.
+        //!
+        //! \note The allocator is not thread-safe.
+        class ArenaAllocator final : public hailstorm::Allocator
+        {
+        public:
+            //! \brief Alignment of all memory returned from the allocator.
+            static constexpr uint32_t Constant_Alignment = 16;
+
+            //! \param [in] backing_alloc Allocator used to allocate blocks.
+            //! \param [in] block_size Minimal size of each block, bigger blocks are allocated for allocations not fitting into it.
+            explicit ArenaAllocator(hailstorm::Allocator& backing_alloc, size_t block_size = 256 * Constant_1KiB) noexcept;
+
+            //! \brief Releases all blocks back to the backing allocator.
+            ~ArenaAllocator() noexcept override;
+
+            auto allocate(size_t size) noexcept -> hailstorm::Memory override;
+            void deallocate(void* ptr) noexcept override;
+            void deallocate(hailstorm::Memory memory) noexcept override;
+
+            //! \brief Releases all allocations at once, blocks are kept for later allocations.
+            //! \pre No memory allocated from this allocator is still in use.
+            void reset() noexcept;
+
+            //! \return The total size of all blocks requested from the backing allocator.
+            auto reserved_size() const noexcept -> size_t { return _reserved_size; }
+
+            ArenaAllocator(ArenaAllocator const&) noexcept = delete;
+            auto operator=(ArenaAllocator const&) noexcept -> ArenaAllocator& = delete;
+
+        private:
+            struct Block;
+
+            bool next_block(size_t size) noexcept;
+
+        private:
+            hailstorm::Allocator& _backing_alloc;
+            size_t const _block_size;
+            size_t _reserved_size;
+
+            Block* _blocks;
+            Block* _current;
+
+            //! \brief The location where the next allocation starts and the end of the current block.
+            char* _cursor;
+            char* _end;
+
+            //! \brief The most recent allocation, can be rolled back when deallocated.
+            char* _last_allocation;
+        };
+
+    } // namespace v1
+
+    using ArenaAllocator = v1::ArenaAllocator;
+
+} // namespace hailstorm
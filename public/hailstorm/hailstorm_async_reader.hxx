@@ -0,0 +1,281 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <hailstorm/hailstorm_types.hxx>
+#include <hailstorm/hailstorm.hxx>
+#include <coroutine>
+
+namespace hailstorm
+{
+
+    namespace v1
+    {
+
+        //! \brief A single read request submitted to an I/O backend.
+        //! \note The request object stays valid and at the same address until 'fn_complete' is called.
+        struct HailstormReadRequest
+        {
+            //! \brief Function signature called by the backend once the request finished.
+            //! \note Can be called from any thread, including the thread submitting the request.
+            //!
+            //! \param [in] request The finished request.
+            //! \param [in] success 'true' if all requested bytes where read.
+            using CompletionFn = void(
+                hailstorm::v1::HailstormReadRequest& request,
+                bool success
+            ) noexcept;
+
+            //! \brief The file to read from.
+            hailstorm::NativeFileHandle file;
+
+            //! \brief Absolute offset in the file where reading should start.
+            uint64_t offset;
+
+            //! \brief Memory where data should be read to, 'memory.size' bytes need to be read.
+            hailstorm::Memory memory;
+
+            //! \brief Please see documentation of CompletionFn.
+            CompletionFn* fn_complete;
+
+            //! \brief Value owned by the request creator, should not be modified by the backend.
+            void* request_userdata;
+        };
+
+        //! \brief A pluggable I/O backend used by the asynchronous reader.
+        //! \note The backend is expected to execute multiple requests at once.
+        struct HailstormIOBackend
+        {
+            //! \brief Function signature for submitting a single read request.
+            //! \note If the function returns 'false' the completion function of the request will not be called.
+            //!
+            //! \param [in] request The request to be executed.
+            //! \param [in] userdata Value passed by the user using the 'HailstormIOBackend' struct.
+            //! \return 'true' if the request was accepted.
+            using SubmitReadFn = auto(
+                hailstorm::v1::HailstormReadRequest& request,
+                void* userdata
+            ) noexcept -> bool;
+
+            //! \brief Please see documentation of SubmitReadFn.
+            SubmitReadFn* fn_submit_read;
+
+            //! \brief User provided value, can be anything, passed to function routines.
+            void* userdata;
+        };
+
+        //! \brief Builtin I/O backend executing requests on a pool of threads using positional reads.
+        //! \note Available on all platforms, the fallback when 'UringIOBackend' is not valid.
+        //! \note The number of requests in flight is equal to the number of threads, all other requests are queued.
+        class ThreadedIOBackend final
+        {
+        public:
+            //! \param [in] alloc Allocator used for internal bookkeeping.
+            //! \param [in] thread_count Number of I/O threads. A value of '0' will use the number of hardware threads.
+            //! \note If not all threads could be created the backend runs with the threads created so far.
+            ThreadedIOBackend(hailstorm::Allocator& alloc, uint32_t thread_count = 0) noexcept;
+
+            //! \note Finishes all submitted requests before returning.
+            ~ThreadedIOBackend() noexcept;
+
+            //! \return 'true' if at least one I/O thread is running. Requests submitted to an invalid backend are rejected.
+            bool valid() const noexcept { return _internal != nullptr; }
+
+            //! \return The backend description to be used with readers.
+            auto backend() noexcept -> hailstorm::v1::HailstormIOBackend;
+
+            ThreadedIOBackend(ThreadedIOBackend const&) noexcept = delete;
+            auto operator=(ThreadedIOBackend const&) noexcept -> ThreadedIOBackend& = delete;
+
+        private:
+            struct Internal;
+
+            hailstorm::Allocator& _allocator;
+            Internal* _internal;
+        };
+
+        //! \brief Builtin I/O backend executing requests using Linux 'io_uring', accessed using raw system calls.
+        //!
+        //! \details Requests are submitted to the kernel directly from the submitting thread, a single completion thread
+        //!   waits for finished reads and calls the completion functions. Short reads are resubmitted until all bytes are read.
+        //!
+        //! \note The backend is only valid on Linux kernels supporting 'io_uring' (5.6 or newer). On all other platforms the
+        //!   backend is never valid, there is no native backend for Windows (IOCP) yet. Use 'ThreadedIOBackend' as the
+        //!   fallback on those platforms and when 'io_uring' is not available.
+        class UringIOBackend final
+        {
+        public:
+            //! \param [in] alloc Allocator used for internal bookkeeping.
+            //! \param [in] queue_depth Number of requests in flight, all other requests are queued.
+            //!   The kernel might round the value up to the next power of two.
+            UringIOBackend(hailstorm::Allocator& alloc, uint32_t queue_depth = 64) noexcept;
+
+            //! \note Finishes all submitted requests before returning.
+            ~UringIOBackend() noexcept;
+
+            //! \return 'true' if the ring was created. Requests submitted to an invalid backend are rejected.
+            bool valid() const noexcept { return _internal != nullptr; }
+
+            //! \return The backend description to be used with readers.
+            auto backend() noexcept -> hailstorm::v1::HailstormIOBackend;
+
+            UringIOBackend(UringIOBackend const&) noexcept = delete;
+            auto operator=(UringIOBackend const&) noexcept -> UringIOBackend& = delete;
+
+        private:
+            struct Internal;
+
+            hailstorm::Allocator& _allocator;
+            Internal* _internal;
+        };
+
+        //! \brief Provides asynchronous access to chunk and resource data of a single Hailstorm pack stored in a file.
+        //!
+        //! \details Only header data is read when opening the pack, all other data is read using the I/O backend
+        //!   by awaiting 'load_chunk' and 'load_resource' operations from a coroutine.
+        //!
+        //! \note The reader itself does not keep any state for pending reads, thus operations can be started from
+        //!   multiple threads at once.
+        //!
+        //! \note Packs written with a 'pack_slice_alignment' can be opened for unbuffered access, bypassing the system
+        //!   file cache. All reads are then extended to the slice alignment and read into aligned memory.
+        class AsyncReader final
+        {
+        public:
+            //! \param [in] alloc Allocator used for header data and memory returned from load operations.
+            //! \param [in] backend The I/O backend used to execute read requests, needs to outlive the reader.
+            AsyncReader(hailstorm::Allocator& alloc, hailstorm::v1::HailstormIOBackend backend) noexcept;
+            ~AsyncReader() noexcept;
+
+            //! \brief Opens the file at the given path and reads the header of the pack starting at 'pack_offset'.
+            //! \param [in] unbuffered If 'true' the file is opened using 'O_DIRECT' / 'FILE_FLAG_NO_BUFFERING'.
+            //! \return 'Result::Success' if the pack was opened, 'Result::E_InvalidArgument' if unbuffered access was requested
+            //!   for a pack without a 'pack_slice_alignment' or at an unaligned offset, otherwise an error describing the issue.
+            auto open(char const* path, uint64_t pack_offset = 0, bool unbuffered = false) noexcept -> hailstorm::Result;
+
+            //! \brief Reads the header of the pack starting at 'pack_offset' from an already opened file.
+            //! \note The file handle is not owned by the reader and needs to stay open as long as the reader is open.
+            //! \param [in] unbuffered If 'true' the file was opened for unbuffered access and all reads need to be aligned.
+            //! \return 'Result::Success' if the pack was opened, otherwise an error describing the issue.
+            auto open(hailstorm::NativeFileHandle file, uint64_t pack_offset = 0, bool unbuffered = false) noexcept -> hailstorm::Result;
+
+            //! \brief Releases header data and closes the file if it was opened by the reader.
+            //! \pre There are no pending load operations.
+            void close() noexcept;
+
+            //! \return 'true' if a pack is currently open.
+            bool is_open() const noexcept { return _header_memory.location != nullptr; }
+
+            //! \return Header information of the opened pack. Path data is always available.
+            auto data() const noexcept -> hailstorm::v1::HailstormData const& { return _data; }
+
+            //! \return The alignment of all reads, or '0' if the pack was opened for buffered access.
+            auto io_alignment() const noexcept -> uint32_t { return _io_alignment; }
+
+            AsyncReader(AsyncReader const&) noexcept = delete;
+            auto operator=(AsyncReader const&) noexcept -> AsyncReader& = delete;
+
+        private:
+            auto open_internal(hailstorm::NativeFileHandle file, uint64_t pack_offset, bool unbuffered) noexcept -> hailstorm::Result;
+
+            friend class AsyncReadOperation;
+
+        private:
+            hailstorm::Allocator& _allocator;
+            hailstorm::v1::HailstormIOBackend const _backend;
+            hailstorm::NativeFileHandle _file;
+            bool _owns_file;
+            uint64_t _pack_offset;
+            uint32_t _io_alignment;
+
+            hailstorm::Memory _header_memory;
+            hailstorm::v1::HailstormData _data;
+        };
+
+        //! \brief The result of an asynchronous load operation.
+        struct HailstormAsyncReadResult
+        {
+            hailstorm::Result result;
+
+            //! \brief Memory holding the loaded data, allocated using the readers allocator. The caller takes ownership.
+            //! \note The memory alignment is the alignment provided by the allocator.
+            hailstorm::Memory memory;
+
+            //! \brief View of the requested data inside 'memory'.
+            //! \note With unbuffered access 'memory' also holds data read before and after the requested range.
+            hailstorm::Data data;
+        };
+
+        //! \brief Awaitable read operation, suspends the awaiting coroutine until data is read.
+        //! \note The coroutine is resumed on the thread completing the request, which depends on the I/O backend used.
+        //! \note Memory for the data is allocated when the operation is created, so the reader allocator is required to be
+        //!   thread-safe if operations are created or results are released on multiple threads.
+        class AsyncReadOperation final
+        {
+        public:
+            AsyncReadOperation(
+                hailstorm::v1::AsyncReader& reader,
+                uint64_t offset,
+                size_t size
+            ) noexcept;
+            ~AsyncReadOperation() noexcept;
+
+            bool await_ready() const noexcept { return _result != Result::Success; }
+            bool await_suspend(std::coroutine_handle<> coro) noexcept;
+            auto await_resume() noexcept -> hailstorm::v1::HailstormAsyncReadResult;
+
+            AsyncReadOperation(AsyncReadOperation const&) noexcept = delete;
+            auto operator=(AsyncReadOperation const&) noexcept -> AsyncReadOperation& = delete;
+
+        private:
+            static void on_complete(hailstorm::v1::HailstormReadRequest& request, bool success) noexcept;
+
+        private:
+            hailstorm::Allocator& _allocator;
+            hailstorm::v1::HailstormIOBackend const _backend;
+            hailstorm::v1::HailstormReadRequest _request;
+
+            //! \brief The allocated memory, the request memory is located inside when reads need to be aligned.
+            hailstorm::Memory _memory;
+            hailstorm::Data _data;
+            std::coroutine_handle<> _coro;
+            hailstorm::Result _result;
+        };
+
+        //! \brief Reads the whole chunk into memory.
+        //! \return Awaitable operation resulting in a 'HailstormAsyncReadResult' value.
+        auto load_chunk(
+            hailstorm::v1::AsyncReader& reader,
+            uint32_t chunk_idx
+        ) noexcept -> hailstorm::v1::AsyncReadOperation;
+
+        //! \brief Reads the stored resource data into memory.
+        //! \note Compressed resources are not decompressed, \see hailstorm::v1::decompress_resource.
+        //! \return Awaitable operation resulting in a 'HailstormAsyncReadResult' value.
+        auto load_resource(
+            hailstorm::v1::AsyncReader& reader,
+            uint32_t resource_idx
+        ) noexcept -> hailstorm::v1::AsyncReadOperation;
+
+        //! \brief Reads a byte range of the stored resource data into memory.
+        //! \note Resources stored across multiple chunks are read without loading the whole resource.
+        //! \pre The range is located inside the resource data.
+        //! \return Awaitable operation resulting in a 'HailstormAsyncReadResult' value.
+        auto load_resource_range(
+            hailstorm::v1::AsyncReader& reader,
+            uint32_t resource_idx,
+            uint64_t offset,
+            size_t size
+        ) noexcept -> hailstorm::v1::AsyncReadOperation;
+
+    } // namespace v1
+
+    using HailstormReadRequest = v1::HailstormReadRequest;
+    using HailstormIOBackend = v1::HailstormIOBackend;
+    using HailstormAsyncReadResult = v1::HailstormAsyncReadResult;
+    using ThreadedIOBackend = v1::ThreadedIOBackend;
+    using UringIOBackend = v1::UringIOBackend;
+    using AsyncReader = v1::AsyncReader;
+    using AsyncReadOperation = v1::AsyncReadOperation;
+
+} // namespace hailstorm
@@ -0,0 +1,135 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <hailstorm/hailstorm_types.hxx>
+#include <hailstorm/hailstorm.hxx>
+
+namespace hailstorm
+{
+
+    namespace v1
+    {
+
+        //! \brief Parameters used to create a chunk cache.
+        struct HailstormChunkCacheParams
+        {
+            //! \brief Function signature for loading chunk data into memory provided by the cache.
+            //! \note Different chunks can be loaded at the same time if the cache is used from multiple threads.
+            //!
+            //! \param [in] chunk_idx Index of the chunk to be loaded.
+            //! \param [in] chunk Chunk information.
+            //! \param [in] memory Memory block of 'chunk.size' bytes aligned to 'chunk.align' where data should be loaded.
+            //! \param [in] userdata Value passed by the user using the 'HailstormChunkCacheParams' struct.
+            //! \return 'true' if the chunk was loaded.
+            using LoadChunkFn = auto(
+                uint32_t chunk_idx,
+                hailstorm::v1::HailstormChunk const& chunk,
+                hailstorm::Memory memory,
+                void* userdata
+            ) noexcept -> bool;
+
+            //! \brief Allocator used to allocate chunk memory and internal bookkeeping.
+            //! \note The allocator is only accessed by one thread at a time.
+            hailstorm::Allocator& alloc;
+
+            //! \brief Chunks that are managed by the cache. The list needs to be valid for the whole cache lifetime.
+            std::span<hailstorm::v1::HailstormChunk const> chunks;
+
+            //! \brief The maximum amount of memory used to keep chunks in memory.
+            //! \note Includes the memory required to align chunk data, a chunk needs 'chunk.size + chunk.align - 1' bytes.
+            size_t memory_budget;
+
+            //! \brief Please see documentation of LoadChunkFn.
+            LoadChunkFn* fn_load_chunk;
+
+            //! \brief Optional checksums of all chunks, if provided chunks are verified after being loaded.
+            //! \note If not empty, the span needs to hold one checksum for each entry in 'chunks'.
+            //! \note Chunks not matching their checksum can't be acquired, same as chunks that failed to load.
+            //! \see HailstormData::chunk_checksums
+            std::span<uint32_t const> chunk_checksums;
+
+            //! \brief Optional key of an encrypted pack, if provided chunks are decrypted in place after being loaded and verified.
+            //! \see HailstormHeader::is_encrypted
+            hailstorm::v1::HailstormEncryptionKey const* decryption_key = nullptr;
+
+            //! \brief Optional pack data with the 'Relocations' section, if provided relocations are applied after chunks are loaded.
+            //! \see hailstorm::v1::apply_relocations
+            hailstorm::v1::HailstormData const* relocations = nullptr;
+
+            //! \brief User provided value, can be anything, passed to function routines.
+            void* userdata = nullptr;
+        };
+
+        //! \brief Keeps chunks in memory within a fixed memory budget.
+        //!
+        //! \details Chunks are loaded on first acquire and kept in memory after being released as long as the budget allows it.
+        //!   When memory is needed, unused chunks are evicted based on their 'HailstormChunk::persistance' value, and
+        //!   starting with the least recently used chunk in each group:
+        //!   * 'Temporary' - chunks are released immediately when no longer used.
+        //!   * 'Regular' - chunks are evicted first.
+        //!   * 'LoadIfPossible' - chunks are evicted only if there are no more 'Regular' chunks to evict.
+        //!   * 'LoadAlways' - chunks are never evicted once loaded.
+        //!
+        //! \note The cache is thread-safe. Each chunk has an atomic reference count, so acquiring chunks that are already in
+        //!   memory and releasing chunks still used by other threads never takes a lock. Releasing the last reference takes the
+        //!   lock to update the eviction order. Loading and evicting chunks is serialised, however chunk data is loaded
+        //!   outside of the lock and threads acquiring a chunk that is being loaded wait only for that chunk.
+        class ChunkCache final
+        {
+        public:
+            explicit ChunkCache(hailstorm::v1::HailstormChunkCacheParams const& params) noexcept;
+            ~ChunkCache() noexcept;
+
+            //! \brief Returns chunk data and keeps it in memory until released. Loads the chunk if necessary.
+            //! \note Each successful call needs to be paired with a call to 'release'.
+            //! \return Chunk data or an empty view if the chunk could not be loaded or does not fit into the budget.
+            auto acquire(uint32_t chunk_idx) noexcept -> hailstorm::Data;
+
+            //! \brief Releases a chunk acquired earlier.
+            void release(uint32_t chunk_idx) noexcept;
+
+            //! \brief Loads all 'LoadAlways' chunks.
+            //! \return 'true' if all chunks where loaded.
+            bool preload() noexcept;
+
+            //! \brief Evicts unused chunks until the resident size is at most the given value.
+            void trim(size_t target_size) noexcept;
+
+            //! \return 'true' if the chunk data is currently in memory.
+            bool is_resident(uint32_t chunk_idx) const noexcept;
+
+            //! \return The total size of all chunks currently in memory, including chunks being loaded.
+            //! \note Each chunk accounts for 'chunk.align - 1' additional bytes, allocated to align the chunk data.
+            auto resident_size() const noexcept -> size_t;
+
+            //! \return The memory budget of the cache.
+            auto memory_budget() const noexcept -> size_t { return _params.memory_budget; }
+
+            ChunkCache(ChunkCache const&) noexcept = delete;
+            auto operator=(ChunkCache const&) noexcept -> ChunkCache& = delete;
+
+        private:
+            struct Entry;
+            struct Internal;
+
+            bool load(uint32_t chunk_idx) noexcept;
+            bool evict(uint32_t chunk_idx) noexcept;
+            bool reserve(size_t size) noexcept;
+            void trim_locked(size_t target_size) noexcept;
+            void link_locked(uint32_t chunk_idx) noexcept;
+            void unlink_locked(uint32_t chunk_idx) noexcept;
+
+        private:
+            hailstorm::v1::HailstormChunkCacheParams const _params;
+            hailstorm::Memory _entries_memory;
+            Entry* _entries;
+            Internal* _internal;
+        };
+
+    } // namespace v1
+
+    using HailstormChunkCacheParams = v1::HailstormChunkCacheParams;
+    using ChunkCache = v1::ChunkCache;
+
+} // namespace hailstorm
@@ -23,6 +23,93 @@ namespace hailstorm
             hailstorm::v1::HailstormData& out_hailstorm
         ) noexcept -> hailstorm::Result;
 
+        //! \brief Number of bytes at the start of a pack required by 'read_header_layout'.
+        static constexpr size_t Constant_HailstormHeaderProbeSize = sizeof(HailstormHeader) + sizeof(HailstormPaths);
+
+        //! \brief First phase of a staged header read, validates the header and returns the location of all header parts.
+        //! \details Allows to inspect a pack identity and version with a single small read, and to read the chunks table,
+        //!   resources table, paths and sections afterwards only when necessary, \see read_header_part.
+        //!
+        //! \param [in] probe_data The start of the pack, at least 'Constant_HailstormHeaderProbeSize' bytes.
+        //! \param [out] out_layout The location of each header part.
+        //! \param [out] out_hailstorm Hailstorm object with only 'header' and 'paths' set, other fields are cleared.
+        //! \return 'Result::Success' if the header is valid, otherwise the same errors as 'read_header'.
+        auto read_header_layout(
+            hailstorm::Data probe_data,
+            hailstorm::v1::HailstormHeaderLayout& out_layout,
+            hailstorm::v1::HailstormData& out_hailstorm
+        ) noexcept -> hailstorm::Result;
+
+        //! \brief Parts of the header data that can be read separately.
+        enum class HailstormHeaderPart : uint8_t
+        {
+            Chunks,
+            Resources,
+            Paths,
+            SectionsTable,
+
+            //! \brief Data of all sections, requires the 'SectionsTable' part to be read first.
+            SectionsData,
+        };
+
+        //! \brief Later phase of a staged header read, updates the hailstorm object with a single header part.
+        //! \note Same as with 'read_header', the hailstorm object references the given data which needs to stay valid.
+        //!
+        //! \param [in] layout The layout returned by 'read_header_layout'.
+        //! \param [in] part The part stored in 'part_data'.
+        //! \param [in] part_data The data of the part, read from the range described in the layout.
+        //! \param [in,out] inout_hailstorm Hailstorm object returned by 'read_header_layout'.
+        //! \return 'Result::Success' if the part was read, 'Result::E_IncompleteHeaderData' if the data is too small or
+        //!   'Result::E_InvalidArgument' if section data is read before sections table.
+        auto read_header_part(
+            hailstorm::v1::HailstormHeaderLayout const& layout,
+            hailstorm::v1::HailstormHeaderPart part,
+            hailstorm::Data part_data,
+            hailstorm::v1::HailstormData& inout_hailstorm
+        ) noexcept -> hailstorm::Result;
+
+        //! \brief Calculates the hash value of a resource path as stored in the 'PathsIndex' section.
+        //! \note The hash function is part of the format and will not change for the 'HSC0' header version.
+        //!
+        //! \param [in] path The path to be hashed.
+        //! \return 64bit hash value of the given path.
+        auto hash_path(std::string_view path) noexcept -> uint64_t;
+
+        //! \brief Finds the index of a resource with the given path.
+        //! \note If the 'PathsIndex' section is available the lookup is O(1) and path data is only accessed if the pack
+        //!   contains multiple paths with the same hash value. Otherwise all paths are compared one by one.
+        //!
+        //! \param [in] hailstorm Hailstorm object filled using 'read_header'.
+        //! \param [in] path The path of the resource to find.
+        //! \return Index of the resource or 'Constant_HailstormInvalidIndex' if it was not found or could not be resolved.
+        auto find_resource(
+            hailstorm::v1::HailstormData const& hailstorm,
+            std::string_view path
+        ) noexcept -> uint32_t;
+
+        //! \brief Checks that the path of each resource is stored within the paths data, is followed by a '\0' character
+        //!   and does not contain any other '\0' characters.
+        //! \note Resources in patch and expansion packs with a 'path_size' of '0' reference other resources by index and are skipped.
+        //!
+        //! \param [in] hailstorm Hailstorm object filled using 'read_header'.
+        //! \return 'Result::Success' if all paths are valid, 'Result::E_InvalidArgument' if the paths data is not available,
+        //!   otherwise 'Result::E_InvalidPackData'.
+        auto validate_paths(
+            hailstorm::v1::HailstormData const& hailstorm
+        ) noexcept -> hailstorm::Result;
+
+        //! \brief Fills the given list with the path of each resource, viewing the paths data directly.
+        //! \note Resources in patch and expansion packs with a 'path_size' of '0' get an empty path.
+        //! \pre Paths are valid, \see validate_paths.
+        //!
+        //! \param [in] hailstorm Hailstorm object filled using 'read_header'.
+        //! \param [out] out_paths List with at least one entry for each resource.
+        //! \return 'true' if all paths where returned, 'false' if paths data is not available or the list is too small.
+        bool split_paths(
+            hailstorm::v1::HailstormData const& hailstorm,
+            std::span<std::string_view> out_paths
+        ) noexcept;
+
         //! \brief Creates a new Hailstorm cluster based on the write params and provided resource information.
         //!
         //! \note Because HS format is quite complex when it comes to writing the creation is handled internally,
@@ -46,6 +133,8 @@ namespace hailstorm
         //! \note This function requires the user to set all async functions to properly handle writing data.
         //!   Additionally there are no guarantees that write requests are in order. Always use the offset to write
         //!   data into it's expected location.
+        //! \note Write callbacks may finish writes later, allowing up to 'max_pending_writes' writes to be in flight.
+        //!   The function returns after all writes finished and 'fn_async_close' was called.
         //! \note Because HS format is quite complex when it comes to writing the creation is handled internally,
         //!   however chunk selection and data writing are defined using the HailstormAsyncWriteParams struct.
         //!   This allows for the main routine to stay stable and handle all boilerplate regarding resource
@@ -56,12 +145,348 @@ namespace hailstorm
         //! \param [in] params Write params containing logic and detailed information on how to create a final HS cluster.
         //! \param [in] data A struct containg the data describing all resources to be stored in this cluster.
         //!
-        //! \return Allocated memory ready to be written to a file. Returns an empty block if the operation fails.
+        //! \return 'true' if all write requests finished successfully.
         bool write_cluster_async(
             hailstorm::v1::HailstormAsyncWriteParams const& params,
             hailstorm::v1::HailstormWriteData const& data
         ) noexcept;
 
+        //! \brief Creates a new Hailstorm cluster based on the write params and provided resource information.
+        //!
+        //! \note Works the same as 'write_cluster', however resource data is written from multiple threads once
+        //!   the location of each resource is known. The 'fn_resource_write' callback is required to be thread-safe.
+        //! \note If compression was requested, resources are also compressed using multiple threads.
+        //!
+        //! \pre All three lists describing resource information are of the same size.
+        //!
+        //! \param [in] params Write params containing logic and detailed information on how to create a final HS cluster.
+        //! \param [in] data A struct containg the data describing all resources to be stored in this cluster.
+        //!
+        //! \return Allocated memory ready to be written to a file. Returns an empty block if the operation fails.
+        auto write_cluster_parallel(
+            hailstorm::v1::HailstormParallelWriteParams const& params,
+            hailstorm::v1::HailstormWriteData const& data
+        ) noexcept -> hailstorm::Memory;
+
+        //! \brief Creates multiple Hailstorm clusters at once, each cluster is planned and written by a separate job.
+        //!
+        //! \note Each cluster is written the same way as with 'write_cluster', clusters don't depend on each other.
+        //! \note Temporary allocations of each job are served from arenas that are reused by later jobs, so only the first
+        //!   clusters written request memory from 'temp_alloc'. \see HailstormBatchWriteParams::base_params.
+        //! \note Encryption is not supported, since all clusters would be encrypted using the same key and nonce.
+        //!
+        //! \pre All three lists describing resource information are of the same size, for each cluster.
+        //!
+        //! \param [in] params Write params used for all clusters and a description of how jobs are executed.
+        //! \param [in] clusters The data describing resources of each cluster.
+        //! \param [out] out_clusters Receives the memory of each cluster, needs to hold an entry for each cluster.
+        //!   Clusters that failed to be written are empty, all other blocks need to be released even if the function failed.
+        //!
+        //! \return 'true' if all clusters where written.
+        bool write_clusters(
+            hailstorm::v1::HailstormBatchWriteParams const& params,
+            std::span<hailstorm::v1::HailstormWriteData const> clusters,
+            std::span<hailstorm::Memory> out_clusters
+        ) noexcept;
+
+        //! \brief Creates a new Hailstorm cluster as a list of segments, without copying resource data provided by the caller.
+        //!
+        //! \note Segments viewing resource data point directly to the views in 'data', all other segments point to
+        //!   memory allocated using 'cluster_alloc'. This includes header data, paths, sections, padding, resources written
+        //!   using 'fn_resource_write', custom chunks and resources compressed by the builtin compression stage.
+        //! \note Writing all segments one after another, for example using 'writev', produces the same data as 'write_cluster'.
+        //!
+        //! \pre All three lists describing resource information are of the same size.
+        //!
+        //! \param [in] params Write params containing logic and detailed information on how to create a final HS cluster.
+        //! \param [in] data A struct containg the data describing all resources to be stored in this cluster.
+        //!   Resource data needs to stay valid as long as the returned segments are used.
+        //! \param [out] out_segments The segments of the cluster, \see HailstormWriteSegments.
+        //!
+        //! \return 'true' if the segments where created.
+        bool write_cluster_segments(
+            hailstorm::v1::HailstormWriteParams const& params,
+            hailstorm::v1::HailstormWriteData const& data,
+            hailstorm::v1::HailstormWriteSegments& out_segments
+        ) noexcept;
+
+        //! \brief Creates a new version of an existing Hailstorm cluster, by adding, replacing and removing resources.
+        //!
+        //! \details Chunks of the existing cluster still holding at least one unchanged resource are reused byte-for-byte,
+        //!   only the header, chunks and resources tables, paths and sections are created again. New resources are placed
+        //!   in the free space of reused chunks or in new chunks, using the 'HailstormChunkPlanner::BinPacking' rules.
+        //!
+        //! \note Chunks without any remaining resources are dropped, however the space of removed resources in reused
+        //!   chunks is not reclaimed. Resources keep their order, new resources are stored after all existing ones.
+        //! \note The header values of the existing cluster, like the pack identity and custom values, are kept.
+        //!   The 'pack_slice_alignment' of the existing cluster is used instead of the value in 'params'.
+        //! \note Reused chunks point directly into 'HailstormRepackData::pack_data', \see write_cluster_segments.
+        //! \note Encrypted clusters are not supported, \see HailstormWriteParams::encryption_key.
+        //! \note Clusters with relocations are not supported, neither existing nor new resources can provide them.
+        //!
+        //! \param [in] params Write params used for new resources, sections and to allocate the returned segments.
+        //! \param [in] data The existing cluster and all changes to be applied.
+        //! \param [out] out_segments The segments of the new cluster, \see HailstormWriteSegments.
+        //!
+        //! \return 'true' if the segments where created, 'false' if writing failed or the existing cluster data is not valid.
+        bool repack_cluster(
+            hailstorm::v1::HailstormWriteParams const& params,
+            hailstorm::v1::HailstormRepackData const& data,
+            hailstorm::v1::HailstormWriteSegments& out_segments
+        ) noexcept;
+
+        //! \brief Creates a new Hailstorm cluster and writes it directly to the given file.
+        //!
+        //! \note Data is written through a bounded set of staging buffers, so the whole cluster is never stored in memory.
+        //!   Peak memory usage is defined by 'staging_buffer_size * staging_buffer_count', additionally resources that
+        //!   need to be written using 'fn_resource_write' and are bigger than a single staging buffer are allocated
+        //!   temporarily using the 'temp_alloc' allocator.
+        //! \note The 'cluster_alloc' allocator is unused.
+        //! \note The builtin compression stage is not supported, since it keeps the compressed data of all resources in memory
+        //!   until it's written. Writes fail if 'compression_type' is set, resources need to be compressed by the caller.
+        //!
+        //! \pre All three lists describing resource information are of the same size.
+        //!
+        //! \param [in] params Write params containing logic and detailed information on how to create a final HS cluster.
+        //! \param [in] data A struct containg the data describing all resources to be stored in this cluster.
+        //!
+        //! \return 'true' if the whole cluster was written to the file.
+        bool write_cluster_streamed(
+            hailstorm::v1::HailstormStreamWriteParams const& params,
+            hailstorm::v1::HailstormWriteData const& data
+        ) noexcept;
+
+        //! \brief Writes cluster segments one after another into a new file, optionally bypassing the system file cache.
+        //! \details Segments are copied into staging buffers that are written in file order, which allows to use
+        //!   unbuffered file access with 'O_DIRECT' / 'FILE_FLAG_NO_BUFFERING', where every write needs to be aligned.
+        //!
+        //! \note With unbuffered access the last block is padded with zeros and the file is truncated to the segments size
+        //!   once all writes are finished. Clusters written with a 'pack_slice_alignment' don't require any padding.
+        //!
+        //! \param [in] params Parameters describing the file and how data is written.
+        //! \param [in] segments Segments to be written, \see write_cluster_segments.
+        //! \return 'true' if all segments where written to the file.
+        bool write_segments_file(
+            hailstorm::v1::HailstormFileWriteParams const& params,
+            std::span<hailstorm::Data const> segments
+        ) noexcept;
+
+        //! \brief Checks if the given compression type can be handled by the builtin compression stage and 'decompress_resource'.
+        //! \note Support for 'ZLib' and 'Zstd' depends on the options the library was built with.
+        //!
+        //! \param [in] compression_type One of the standarized compression types, \see HailstormResource::compression_type.
+        //! \return 'true' if data can be compressed and decompressed using the given type.
+        bool is_compression_supported(uint8_t compression_type) noexcept;
+
+        //! \brief Decompresses resource data that was compressed using one of the builtin compression types.
+        //! \note Each resource is compressed independently and the function does not share any state between calls,
+        //!   so it's safe to decompress multiple resources at the same time from worker threads.
+        //! \note If the resource is not compressed the data is copied over.
+        //!
+        //! \param [in] resource The resource information as stored in the pack.
+        //! \param [in] resource_data The stored resource data, the view needs to be at least 'resource.size' bytes.
+        //! \param [in] out_memory Memory where data will be decompressed, needs to be at least 'resource.size_origin' bytes.
+        //! \return 'Result::Success' if data was decompressed, otherwise an error describing the issue.
+        auto decompress_resource(
+            hailstorm::v1::HailstormResource const& resource,
+            hailstorm::Data resource_data,
+            hailstorm::Memory out_memory
+        ) noexcept -> hailstorm::Result;
+
+        //! \brief Returns all resources with data starting in the given chunk, ordered by their offset in the chunk.
+        //! \note Requires the 'ChunkResources' section data, \see HailstormWriteParams::create_chunk_resources_index.
+        //!
+        //! \param [in] hailstorm The pack header data.
+        //! \param [in] chunk_idx The index of the chunk.
+        //! \return Indices into 'HailstormData::resources', empty if the section is not available or the chunk does not exist.
+        auto chunk_resources(
+            hailstorm::v1::HailstormData const& hailstorm,
+            uint32_t chunk_idx
+        ) noexcept -> std::span<uint32_t const>;
+
+        namespace detail
+        {
+
+            inline auto column_chunk_index(void const* column, uint32_t index_size, uint32_t idx) noexcept -> uint32_t
+            {
+                return index_size == 2
+                    ? reinterpret_cast<uint16_t const*>(column)[idx]
+                    : reinterpret_cast<uint32_t const*>(column)[idx];
+            }
+
+        } // namespace detail
+
+        //! \brief Resource field accessors, reading from the 'ResourceColumns' section if available or the resources table otherwise.
+        //! \note Scanning values of many resources with columns available only touches memory of the accessed field.
+        //! \pre The resource index is valid.
+        inline auto resource_chunk(hailstorm::v1::HailstormData const& hailstorm, uint32_t resource_idx) noexcept -> uint32_t
+        {
+            HailstormResourceColumns const& columns = hailstorm.resource_columns;
+            return columns.chunk_index_size != 0
+                ? detail::column_chunk_index(columns.chunks, columns.chunk_index_size, resource_idx)
+                : hailstorm.resources[resource_idx].chunk;
+        }
+
+        inline auto resource_offset(hailstorm::v1::HailstormData const& hailstorm, uint32_t resource_idx) noexcept -> uint32_t
+        {
+            HailstormResourceColumns const& columns = hailstorm.resource_columns;
+            return columns.chunk_index_size != 0 ? columns.offsets[resource_idx] : hailstorm.resources[resource_idx].offset;
+        }
+
+        inline auto resource_size(hailstorm::v1::HailstormData const& hailstorm, uint32_t resource_idx) noexcept -> uint32_t
+        {
+            HailstormResourceColumns const& columns = hailstorm.resource_columns;
+            return columns.chunk_index_size != 0 ? columns.sizes[resource_idx] : hailstorm.resources[resource_idx].size;
+        }
+
+        inline auto resource_meta_chunk(hailstorm::v1::HailstormData const& hailstorm, uint32_t resource_idx) noexcept -> uint32_t
+        {
+            HailstormResourceColumns const& columns = hailstorm.resource_columns;
+            return columns.chunk_index_size != 0
+                ? detail::column_chunk_index(columns.meta_chunks, columns.chunk_index_size, resource_idx)
+                : hailstorm.resources[resource_idx].meta_chunk;
+        }
+
+        inline auto resource_meta_offset(hailstorm::v1::HailstormData const& hailstorm, uint32_t resource_idx) noexcept -> uint32_t
+        {
+            HailstormResourceColumns const& columns = hailstorm.resource_columns;
+            return columns.chunk_index_size != 0 ? columns.meta_offsets[resource_idx] : hailstorm.resources[resource_idx].meta_offset;
+        }
+
+        inline auto resource_meta_size(hailstorm::v1::HailstormData const& hailstorm, uint32_t resource_idx) noexcept -> uint32_t
+        {
+            HailstormResourceColumns const& columns = hailstorm.resource_columns;
+            return columns.chunk_index_size != 0 ? columns.meta_sizes[resource_idx] : hailstorm.resources[resource_idx].meta_size;
+        }
+
+        //! \brief Calculates the CRC32C checksum of the given data, same as stored in the 'ChunkChecksums' section.
+        auto chunk_checksum(hailstorm::Data data) noexcept -> uint32_t;
+
+        //! \brief Checks the data of a single chunk against the checksum stored in the pack.
+        //! \note Allows to verify chunks lazily, for example right after they where loaded.
+        //!
+        //! \param [in] hailstorm The pack header data, with the 'ChunkChecksums' section data available.
+        //! \param [in] chunk_idx The index of the chunk to be verified.
+        //! \param [in] chunk_data The chunk data, needs to be exactly 'HailstormChunk::size' bytes.
+        //! \return 'Result::Success' if the data matches, 'Result::E_ChecksumMismatch' if not or 'Result::E_InvalidArgument'
+        //!   if the pack has no checksums or the data does not describe the chunk.
+        auto verify_chunk(
+            hailstorm::v1::HailstormData const& hailstorm,
+            uint32_t chunk_idx,
+            hailstorm::Data chunk_data
+        ) noexcept -> hailstorm::Result;
+
+        //! \brief Checks all chunks of a pack against the checksums stored in the pack, using multiple threads.
+        //!
+        //! \param [in] params Parameters describing how jobs are executed and where results are stored.
+        //! \param [in] hailstorm The pack header data, with the 'ChunkChecksums' section data available.
+        //! \param [in] pack_data View of the whole pack, for example from a memory mapped file.
+        //! \return 'Result::Success' if all chunks match, 'Result::E_ChecksumMismatch' if at least one chunk does not match or
+        //!   'Result::E_InvalidArgument' if the pack has no checksums or chunks are outside of the given data.
+        auto verify_chunks(
+            hailstorm::v1::HailstormVerifyParams const& params,
+            hailstorm::v1::HailstormData const& hailstorm,
+            hailstorm::Data pack_data
+        ) noexcept -> hailstorm::Result;
+
+        //! \brief Creates a minimal list of aligned reads required to load the given resources.
+        //! \details Byte ranges of all resources (or their chunks) are sorted and neighbouring ranges are merged into a single
+        //!   read, as long as the gap between them is not bigger than the configured threshold.
+        //!
+        //! \param [in] params Parameters describing how ranges are aligned and merged.
+        //! \param [in] hailstorm The pack header data.
+        //! \param [in] resources Indices of resources to be read, duplicates are allowed.
+        //! \param [out] out_plan The read plan, only set when the function succeeds.
+        //! \return 'Result::Success' if the plan was created, 'Result::E_InvalidArgument' if a resource index or the alignment is invalid
+        //!   or 'Result::E_OutOfMemory' if the plan memory could not be allocated.
+        auto plan_reads(
+            hailstorm::v1::HailstormReadPlanParams const& params,
+            hailstorm::v1::HailstormData const& hailstorm,
+            std::span<uint32_t const> resources,
+            hailstorm::v1::HailstormReadPlan& out_plan
+        ) noexcept -> hailstorm::Result;
+
+        //! \brief Translates a byte range of stored resource data into the parts stored in each chunk.
+        //! \details Resources bigger than a single chunk are stored continuously over 'Partial' or 'Streamed' chunks following
+        //!   the chunk they start in. Mapping only the required range allows to keep a sliding window of such a resource loaded.
+        //! \note For compressed resources the range refers to the compressed data.
+        //!
+        //! \param [in] hailstorm The pack header data.
+        //! \param [in] resource_idx The index of the resource.
+        //! \param [in] range The byte range relative to the start of the resource data.
+        //! \param [out] out_parts Parts of the range ordered by their resource offset, at most one for each chunk.
+        //! \param [out] out_count The number of parts the range consists of, set even if 'out_parts' is too small.
+        //! \return 'Result::Success' if all parts where stored, otherwise 'Result::E_InvalidArgument' if the resource index
+        //!   or range are invalid, or 'out_parts' can't hold all parts.
+        auto resource_range_map(
+            hailstorm::v1::HailstormData const& hailstorm,
+            uint32_t resource_idx,
+            hailstorm::v1::HailstormByteRange const& range,
+            std::span<hailstorm::v1::HailstormResourceRangePart> out_parts,
+            uint32_t& out_count
+        ) noexcept -> hailstorm::Result;
+
+        //! \brief Decrypts chunk data in place, the data needs to be encrypted using the same key and chunk index.
+        //! \details Each byte is encrypted based on it's position in the chunk, so any range can be decrypted on it's own,
+        //!   for example a single resource read from a memory mapped pack or loaded using a read plan.
+        //! \note Encrypting and decrypting is the same operation, decrypting the data again restores the encrypted data.
+        //!
+        //! \param [in] key The key used to write the pack.
+        //! \param [in] chunk_idx The index of the chunk the data is stored in.
+        //! \param [in] chunk_offset Offset of the data relative to the start of the chunk.
+        //! \param [in] data The data to be decrypted.
+        void decrypt_chunk_data(
+            hailstorm::v1::HailstormEncryptionKey const& key,
+            uint32_t chunk_idx,
+            uint64_t chunk_offset,
+            hailstorm::Memory data
+        ) noexcept;
+
+        //! \brief Decrypts a byte range of resource data in place, the range may be stored across multiple chunks.
+        //! \note The range refers to stored data, same as for 'resource_range_map'.
+        //!
+        //! \param [in] hailstorm The pack header data.
+        //! \param [in] key The key used to write the pack.
+        //! \param [in] resource_idx The index of the resource.
+        //! \param [in] range The byte range relative to the start of the resource data.
+        //! \param [in] data The stored range of resource data, needs to be at least 'range.size' bytes.
+        //! \return 'Result::Success' if data was decrypted, otherwise 'Result::E_InvalidArgument' if the pack is not encrypted,
+        //!   the resource index or range are invalid or the data is too small.
+        auto decrypt_resource_data(
+            hailstorm::v1::HailstormData const& hailstorm,
+            hailstorm::v1::HailstormEncryptionKey const& key,
+            uint32_t resource_idx,
+            hailstorm::v1::HailstormByteRange const& range,
+            hailstorm::Memory data
+        ) noexcept -> hailstorm::Result;
+
+        //! \brief Returns all relocations of resources with data starting in the given chunk, ordered by their offset in the chunk.
+        //! \note Requires the 'Relocations' section data, \see HailstormWriteData::relocations.
+        //!
+        //! \param [in] hailstorm The pack header data.
+        //! \param [in] chunk_idx The index of the chunk.
+        //! \return Relocations of the chunk, empty if the section is not available or the chunk does not exist.
+        auto chunk_relocations(
+            hailstorm::v1::HailstormData const& hailstorm,
+            uint32_t chunk_idx
+        ) noexcept -> std::span<hailstorm::v1::HailstormRelocation const>;
+
+        //! \brief Turns all offsets stored in the loaded chunk into pointers, with a single pass over the chunk relocations.
+        //! \details Each patched value is increased by the address of the resource data it belongs to, so baked resources can be
+        //!   used directly from the loaded chunk. This needs to be done once after loading, the values are patched in place.
+        //! \note Encrypted chunks need to be decrypted first, \see decrypt_chunk_data.
+        //!
+        //! \param [in] hailstorm The pack header data.
+        //! \param [in] chunk_idx The index of the chunk.
+        //! \param [in] chunk_memory The loaded chunk data, needs to hold all values patched by the chunk relocations.
+        //! \return 'Result::Success' if all values were patched, otherwise 'Result::E_InvalidArgument' if the section is not
+        //!   available, the chunk does not exist or the memory is too small. No values are patched on failure.
+        auto apply_relocations(
+            hailstorm::v1::HailstormData const& hailstorm,
+            uint32_t chunk_idx,
+            hailstorm::Memory chunk_memory
+        ) noexcept -> hailstorm::Result;
+
         //! \brief Returns the total size necessary to store all path data with an prefix appended to each entry.
         //! \param [in] paths_info Path information coming from a hailstorm header.
         //! \param [in] resource_count Number of resources this prefix will be appended to.
@@ -79,6 +504,8 @@ namespace hailstorm
         //! \warning The passed buffer is required to have paths data at the start.
         //! \warning The operation will update the buffer contents and resource information.
         //! \warning It's is REQUIRED that this function works on the entire resource list.
+        //! \warning Hashes stored in the 'PathsIndex' section are not updated and no longer match the prefixed paths.
+        //!   Use the overload taking 'HailstormData' to also drop the index, so 'find_resource' compares paths instead.
         //!
         //! \param [in] paths_info Path information coming from a hailstorm header.
         //! \param [in] resources List of ALL resources that are part of the paths buffer.
@@ -92,6 +519,22 @@ namespace hailstorm
             std::string_view prefix
         ) noexcept;
 
+        //! \brief Updates resource paths same as the overload above and updates the given header data to use the results.
+        //! \details On success 'resources' and 'paths_data' reference the updated lists, 'paths.size' holds the extended size
+        //!   and the 'paths_index' is cleared, since the stored hashes where calculated from the original paths.
+        //!
+        //! \param [in,out] hailstorm Header data of the pack, is only updated if the function succeeds.
+        //! \param [in] resources Copy of ALL resources of the pack, needs to stay valid as long as the header data is used.
+        //! \param [in] paths_data The memory block containing path data and additional space to contain all prefixed entries.
+        //! \param [in] prefix The prefix to be appended to each path.
+        //! \return 'true' If the update was successful and all data could be updated.
+        bool prefix_resource_paths(
+            hailstorm::v1::HailstormData& hailstorm,
+            std::span<hailstorm::v1::HailstormResource> resources,
+            hailstorm::Memory paths_data,
+            std::string_view prefix
+        ) noexcept;
+
         //! \brief The data to be provided when writing a hailstorm cluster.
         struct HailstormWriteData
         {
@@ -115,6 +558,45 @@ namespace hailstorm
             //! \note If provided, this list is required to be the size of 'ids'.
             std::span<uint32_t const> metadata_mapping;
 
+            //! \brief A list of resource indices, referencing the resource storing the data of each resource.
+            //! \note If provided, this list is required to be the size of 'ids'.
+            //!
+            //! \details Resources mapped to another resource don't store their data again and reference the data location
+            //!   of the mapped resource instead. The mapped resource is required to have a smaller index and to map to itself.
+            //!   Resource data is not accessed for mapped resources, however sizes in the 'data' list are still expected to match.
+            //! \see HailstormWriteParams::deduplicate_data
+            std::span<uint32_t const> data_mapping;
+
+            //! \brief A list of resource indices in the pack a patch or expansion pack applies to, replaced by each resource.
+            //! \note If provided, this list is required to be the size of 'ids'. Use 'Constant_HailstormInvalidIndex' for
+            //!   resources that should be identified by their path.
+            //! \details The index is stored in 'HailstormResource::path_offset' with a 'path_size' of '0'.
+            //! \note Paths of such packs can't be extended using 'prefix_resource_paths'.
+            //! \see hailstorm::v1::PackSet
+            std::span<uint32_t const> replaced_resources;
+
+            //! \brief A list of resource indices in the order they are accessed at runtime, for example recorded during a level load.
+            //! \note If provided, this list can be smaller than the number of resources. Resources not listed follow in their
+            //!   original order, out of range and repeated indices are ignored.
+            //!
+            //! \details Resources are assigned to chunks in this order, so resources accessed together are stored in the same
+            //!   or neighbouring chunks and chunks are placed in the pack in the order they are first accessed. Resource indices
+            //!   in the pack are not changed. The order is ignored when repacking clusters.
+            //! \see hailstorm::v1::PackReader::prefetch
+            std::span<uint32_t const> access_order;
+
+            //! \brief A list of offsets of 64-bit values stored in each resource, to be turned into pointers after loading.
+            //! \note If provided, this list is required to be the size of 'ids'. Use empty lists for resources without relocations.
+            //!
+            //! \details Offsets are relative to the start of the resource data, and each value stored at these offsets is an
+            //!   offset relative to the start of the same resource data. The write fails if a value does not fit into the resource.
+            //!   Resources with relocations are never split over multiple chunks, chunks grow to fit them if necessary.
+            //!   Resources with relocations are never compressed by the builtin compression, and if written using
+            //!   'fn_resource_write' their data needs to be stored unchanged. Resources mapped to another resource use it's relocations.
+            //! \note Resources are only deduplicated by 'HailstormWriteParams::deduplicate_data' if their relocations are equal.
+            //! \see HailstormSectionType::Relocations, hailstorm::v1::apply_relocations
+            std::span<std::span<uint32_t const> const> relocations;
+
             //! \brief Application custom values.
             uint32_t custom_values[2];
         };
@@ -173,9 +655,108 @@ namespace hailstorm
             //! \brief If resource was compressed the application may describe the compression format in this member.
             //! \note Setting this member will not affect the data written to the pack file. Writing compressed data is the responsibility of the implementation.
             //! \note If no compression was performed this member should not be written to.
+            //! \note If the resource was compressed by the builtin compression stage, this member already describes the used format.
             hailstorm::v1::HailstormWriteCompressionInfo compression;
         };
 
+        //! \brief Strategies used to assign resources to chunks.
+        enum class HailstormChunkPlanner : uint8_t
+        {
+            //! \brief Resources are assigned in order, using 'fn_select_chunk' and 'fn_create_chunk' for each resource.
+            Sequential,
+
+            //! \brief Resources are sorted by their chunk class and size, and each is assigned to the first chunk with enough space.
+            //!
+            //! \details 'fn_create_chunk' is called once for each resource with an empty base chunk. The returned chunk defines
+            //!   the class of the resource, being all values except 'size', and the size of a chunk created for the resource.
+            //!   Resources are only stored in chunks of the same class, including initial chunks.
+            //!   Free space of all chunks is tracked in a segment tree, so assigning a resource takes O(log C) time.
+            //!
+            //! \note 'fn_select_chunk' is not used.
+            //! \note Only 'Mixed' chunks without flags are supported, metadata is stored in the same chunk as the first resource using it.
+            //! \note If 'HailstormWriteData::access_order' is provided, chunks are placed in the order of their first accessed resource.
+            BinPacking,
+        };
+
+        //! \brief Phases of a write operation, used to report timings and profiling zones.
+        //! \note Phases are entered one after another and never nest, some phases may be entered more than once.
+        enum class HailstormWritePhase : uint8_t
+        {
+            //! \brief Searching for resources with identical data or metadata, \see HailstormWriteParams::deduplicate_data.
+            Deduplication,
+
+            //! \brief Builtin compression of resource data.
+            Compression,
+
+            //! \brief Chunk selection and creation, including re-selections after new chunks where created.
+            ChunkEstimation,
+
+            //! \brief Writing header data, the chunks and resources tables and waiting for pending writes.
+            Header,
+
+            //! \brief Writing resource metadata and data, including calls to resource write callbacks.
+            ResourceData,
+
+            //! \brief Writing data of custom chunks.
+            CustomChunks,
+
+            //! \brief Encrypting chunk data, \see HailstormWriteParams::encryption_key.
+            Encryption,
+
+            //! \brief Copying resource paths into the paths data block.
+            Paths,
+
+            //! \brief Building and writing section data.
+            Sections,
+
+            //! \brief Number of phases, not a valid phase.
+            Count
+        };
+
+        //! \brief Statistics for a single chunk of a written cluster.
+        struct HailstormWriteChunkStats
+        {
+            //! \brief Bytes stored in the chunk, this includes resource data and metadata.
+            size_t used_size;
+
+            //! \brief Bytes lost to alignment of entries and the chunk size.
+            size_t padding_size;
+        };
+
+        //! \brief Statistics collected during a write operation.
+        struct HailstormWriteStats
+        {
+            //! \brief Time spent in each phase in nanoseconds, indexed using 'HailstormWritePhase' values.
+            uint64_t phase_time_ns[size_t(HailstormWritePhase::Count)];
+
+            //! \brief Number of chunks in the written cluster.
+            uint32_t count_chunks;
+
+            //! \brief Number of chunks created by 'fn_create_chunk', this excludes initial chunks.
+            uint32_t count_created_chunks;
+
+            //! \brief Number of times a resource was checked again because 'fn_select_chunk' requested new chunks.
+            uint32_t count_selection_retries;
+
+            //! \brief Number of allocations made using the 'temp_alloc' allocator.
+            uint32_t count_temp_allocations;
+
+            //! \brief Highest number of bytes allocated at the same time using the 'temp_alloc' allocator.
+            size_t temp_alloc_peak_size;
+
+            //! \brief Number of resources referencing the data of another resource.
+            uint32_t count_deduplicated_resources;
+
+            //! \brief Bytes of resource data not stored because they reference the data of another resource.
+            size_t deduplicated_size;
+
+            //! \brief Bytes lost to alignment in all chunks, \see HailstormWriteChunkStats::padding_size.
+            size_t padding_size;
+
+            //! \brief Size of the whole written cluster.
+            size_t cluster_size;
+        };
+
         //! \brief A description of the 'write' operation for a Hailstorm cluster. Allows to partially control how
         //!   the resulting hailstorm cluster looks.
         //! \attention Please make sure you properly fill 'required' members or use default values.
@@ -270,7 +851,48 @@ namespace hailstorm
                 void* userdata
             ) noexcept -> bool;
 
+            //! \brief Function signature called when the write operation enters a new phase. Allows to forward
+            //!   phases as scoped zones to profilers like Tracy or Superluminal.
+            //!
+            //! \note Every begin call is followed by an end call for the same phase before the next phase begins.
+            //! \note Always called from the thread that started the write operation.
+            //!
+            //! \param [in] phase The phase that was entered.
+            //! \param [in] name Static name of the phase, valid for the whole lifetime of the program.
+            //! \param [in] userdata Value passed by the user using the 'HailstormWriteParams' struct.
+            using ProfileZoneBeginFn = void(
+                hailstorm::v1::HailstormWritePhase phase,
+                char const* name,
+                void* userdata
+            ) noexcept;
+
+            //! \brief Function signature called when the write operation leaves a phase.
+            //! \note Also called if the write operation failed while in the given phase.
+            //!
+            //! \param [in] phase The phase that was left.
+            //! \param [in] userdata Value passed by the user using the 'HailstormWriteParams' struct.
+            using ProfileZoneEndFn = void(
+                hailstorm::v1::HailstormWritePhase phase,
+                void* userdata
+            ) noexcept;
+
+            //! \brief Function signature called with statistics of the finished write operation.
+            //!
+            //! \note Called once the whole cluster was written, it's not called if the write operation failed.
+            //! \note Providing this function enables tracking of 'temp_alloc' allocations, which adds a small overhead
+            //!   to each temporary allocation.
+            //!
+            //! \param [in] stats Statistics collected during the write operation.
+            //! \param [in] chunk_stats Statistics for each chunk of the written cluster, only valid during the call.
+            //! \param [in] userdata Value passed by the user using the 'HailstormWriteParams' struct.
+            using WriteStatsFn = void(
+                hailstorm::v1::HailstormWriteStats const& stats,
+                std::span<hailstorm::v1::HailstormWriteChunkStats const> chunk_stats,
+                void* userdata
+            ) noexcept;
+
             //! \brief Allocator object used to handle various temporary allocations.
+            //! \note All temporary allocations are released before returning, \see hailstorm::v1::ArenaAllocator.
             hailstorm::Allocator& temp_alloc;
 
             //! \brief Allocator object used to allocate the final memory for writing.
@@ -283,11 +905,84 @@ namespace hailstorm
             std::span<hailstorm::v1::HailstormChunk const> initial_chunks;
 
             //! \brief Estimated number of chunks in the final cluster, allows to minimize temporary allocations.
+            //! \note If '0', the number is estimated from the total size of all resources and the size of the last initial chunk.
             uint32_t estimated_chunk_count = 0;
 
             //! \brief Forced alignment for the whole pack. This alignment is applied to the header, paths data and each chunk.
             uint32_t pack_slice_alignment = 0;
 
+            //! \brief Identity of the written pack, stored in the header. \see HailstormHeader::pack_id
+            uint32_t pack_id = 0;
+
+            //! \see HailstormHeader::pack_expansion_ver
+            uint16_t pack_expansion_ver = 0;
+
+            //! \see HailstormHeader::pack_patch_ver
+            uint16_t pack_patch_ver = 0;
+
+            //! \brief Marks the pack as an expansion pack. \see HailstormHeader::is_expansion
+            bool is_expansion = false;
+
+            //! \brief Marks the pack as a patch pack. \see HailstormHeader::is_patch
+            bool is_patch = false;
+
+            //! \brief Marks the pack data as baked. \see HailstormHeader::is_baked, HailstormWriteData::relocations
+            bool is_baked = false;
+
+            //! \brief If 'true' a 'PathsIndex' section will be stored in the pack allowing to find resources by path in O(1).
+            //! \see hailstorm::v1::find_resource
+            bool create_paths_index = false;
+
+            //! \brief If 'true' a 'ChunkChecksums' section will be stored in the pack allowing to verify chunks independently.
+            //! \note Checksums are calculated from the written data, so writes fail if the data is not kept in memory,
+            //!   which is the case for 'write_cluster_async' and 'write_cluster_streamed'.
+            //! \see hailstorm::v1::verify_chunks
+            bool create_chunk_checksums = false;
+
+            //! \brief If 'true' a 'ChunkResources' section will be stored in the pack, allowing to list resources of a chunk in O(1).
+            //! \see hailstorm::v1::chunk_resources
+            bool create_chunk_resources_index = false;
+
+            //! \brief If 'true' a 'ResourceColumns' section will be stored in the pack, allowing to scan resource locations faster.
+            //! \see hailstorm::v1::HailstormResourceColumns
+            bool create_resource_columns = false;
+
+            //! \brief If set, data of all chunks is encrypted after it was written. \see HailstormHeader::is_encrypted
+            //! \note Chunks are encrypted in the written memory, so writes fail if the data is not kept in memory,
+            //!   which is the case for 'write_cluster_async', 'write_cluster_streamed' and 'write_cluster_segments'.
+            //! \note Encrypted clusters can't be repacked, since reused chunks would be stored at a different index, and
+            //!   can't be written using 'write_clusters', since all clusters would share the same nonce.
+            //! \see hailstorm::v1::decrypt_chunk_data
+            hailstorm::v1::HailstormEncryptionKey const* encryption_key = nullptr;
+
+            //! \brief If 'true' and no 'data_mapping' was provided, resources with identical data are only stored once.
+            //! \details Data of each resource is hashed and compared to find duplicates, which then reference the data of
+            //!   the first resource with the same content. Resources written using 'fn_resource_write' are never deduplicated.
+            //! \see HailstormWriteData::data_mapping
+            bool deduplicate_data = false;
+
+            //! \brief If 'true' and no 'metadata_mapping' was provided, resources with identical metadata share a single entry.
+            //! \note Metadata is compared the same way as data, \see deduplicate_data.
+            //! \see HailstormWriteData::metadata_mapping
+            bool deduplicate_metadata = false;
+
+            //! \brief Compression applied to resource data before chunks are selected and sized. One of: 'Uncompressed' = 0, 'ZLib' = 1, 'Zstd' = 2
+            //! \note Only resources with data provided up front are compressed. Resources written using 'fn_resource_write' are
+            //!   still required to handle compression on their own.
+            //! \note Each resource is compressed independently and stored uncompressed if compression does not reduce it's size.
+            //! \note Callbacks receiving the 'HailstormWriteData' struct will access the compressed data views.
+            //! \note Writes using 'write_cluster_streamed' fail if set, since compressed data is kept in memory until written.
+            //! \see hailstorm::v1::is_compression_supported, hailstorm::v1::decompress_resource
+            uint8_t compression_type = 0;
+
+            //! \brief Compression level in range [0, 7], where '0' selects the default level of the compression algorithm.
+            //! \note The value is mapped onto the level range of each algorithm, with '7' being the highest compression level.
+            uint8_t compression_level = 0;
+
+            //! \brief The strategy used to assign resources to chunks.
+            //! \see hailstorm::v1::HailstormChunkPlanner
+            HailstormChunkPlanner chunk_planner = HailstormChunkPlanner::Sequential;
+
             //! \brief Please see documentation of ChunkSelectFn.
             ChunkSelectFn* fn_select_chunk;
 
@@ -306,12 +1001,52 @@ namespace hailstorm
 
             //! \brief User provided value, can be anything, passed to function routines.
             void* userdata;
+
+            //! \brief Please see documentation of ProfileZoneBeginFn.
+            //! \note Optional, zones are only reported if both zone functions are provided.
+            ProfileZoneBeginFn* fn_profile_zone_begin = nullptr;
+
+            //! \brief Please see documentation of ProfileZoneEndFn.
+            ProfileZoneEndFn* fn_profile_zone_end = nullptr;
+
+            //! \brief Please see documentation of WriteStatsFn.
+            //! \note Optional.
+            WriteStatsFn* fn_write_stats = nullptr;
         };
 
+        //! \brief The state of a write request returned from asynchronous write callbacks.
+        enum class HailstormAsyncWriteStatus : uint8_t
+        {
+            //! \brief The write failed, no more writes will be requested.
+            Failed,
+
+            //! \brief The write finished before returning from the callback.
+            Completed,
+
+            //! \brief The write is still in progress and needs to be finished by calling 'complete_async_write'.
+            Pending,
+        };
+
+        //! \brief Finishes a write that was reported as 'Pending' by an asynchronous write callback.
+        //! \note Can be called from any thread, but only once for each pending write.
+        //!
+        //! \param [in] completion The completion handle passed to the write callback.
+        //! \param [in] success 'true' if all data was written.
+        void complete_async_write(
+            hailstorm::v1::HailstormAsyncWriteCompletion* completion,
+            bool success
+        ) noexcept;
+
         //! \brief A description of a async write operation for a Hailstorm cluster. Allows to partially control how
         //!   the resulting hailstorm cluster looks.
         //! \note This description is an extension of the regular write params description.
         //! \note All async function calls need to be provided by the user.
+        //!
+        //! \details Write callbacks can either finish writing before returning or return 'Pending' and finish the write later
+        //!   by calling 'complete_async_write' with the provided completion handle. Once 'max_pending_writes' writes are in
+        //!   flight, no new writes are requested until one of them is finished.
+        //!   Data views and memory passed to write callbacks stay valid until the write is finished.
+        //! \note All callbacks are called from the thread that called 'write_cluster_async'.
         struct HailstormAsyncWriteParams
         {
             HailstormWriteParams base_params;
@@ -324,30 +1059,36 @@ namespace hailstorm
             using AsyncWriteHeaderFn = auto(
                 hailstorm::Data header_data,
                 size_t write_offset,
+                hailstorm::v1::HailstormAsyncWriteCompletion* completion,
                 void* userdata
-            ) noexcept -> bool;
+            ) noexcept -> hailstorm::v1::HailstormAsyncWriteStatus;
 
             using AsyncWriteMetadataFn = auto(
                 hailstorm::v1::HailstormWriteData const& write_data,
                 uint32_t resource_index,
                 size_t write_offset,
+                hailstorm::v1::HailstormAsyncWriteCompletion* completion,
                 void* userdata
-            ) noexcept -> bool;
+            ) noexcept -> hailstorm::v1::HailstormAsyncWriteStatus;
 
+            //! \note The 'write_info' object needs to be updated before returning from the callback, even if the write is pending.
             using AsyncWriteDataFn = auto(
                 hailstorm::v1::HailstormWriteData const& write_data,
                 hailstorm::v1::HailstormWriteInfo& write_info,
                 size_t write_offset,
+                hailstorm::v1::HailstormAsyncWriteCompletion* completion,
                 void* userdata
-            ) noexcept -> bool;
+            ) noexcept -> hailstorm::v1::HailstormAsyncWriteStatus;
 
             using AsyncwriteCustomChunkFn = auto(
                 hailstorm::v1::HailstormWriteData const& write_data,
                 hailstorm::v1::HailstormChunk const& chunk,
                 size_t write_offset,
+                hailstorm::v1::HailstormAsyncWriteCompletion* completion,
                 void* userdata
-            ) noexcept -> bool;
+            ) noexcept -> hailstorm::v1::HailstormAsyncWriteStatus;
 
+            //! \note Called once all pending writes finished.
             using AsyncCloseFn = auto(
                 void* userdata
             ) noexcept -> bool;
@@ -361,6 +1102,303 @@ namespace hailstorm
 
             //! \brief User provided value, can be anything, passed to function routines.
             void* async_userdata;
+
+            //! \brief Maximum number of writes that can be pending at the same time.
+            //! \note A value of '0' is treated as '1'.
+            uint32_t max_pending_writes = 8;
+        };
+
+        //! \brief A description of a parallel write operation for a Hailstorm cluster.
+        //! \note This description is an extension of the regular write params description.
+        //! \note If no 'fn_parallel_for' function is provided, the library will spawn 'worker_count' threads on it's own.
+        struct HailstormParallelWriteParams
+        {
+            HailstormWriteParams base_params;
+
+            //! \brief Function signature of a single job that needs to be executed.
+            //! \param [in] job_data Data passed to the 'ParallelForFn' call.
+            //! \param [in] job_index The index of the job to be executed, in range [0, job_count).
+            using JobFn = void(
+                void* job_data,
+                uint32_t job_index
+            ) noexcept;
+
+            //! \brief Function signature for executing jobs on an application provided job system.
+            //!
+            //! \note The function is required to block until all jobs finished executing.
+            //! \note Jobs can be executed in any order and on any thread, including the calling thread.
+            //!
+            //! \param [in] job_count Number of jobs to be executed.
+            //! \param [in] fn_job The function to be called for each job index.
+            //! \param [in] job_data Data to be passed to each job.
+            //! \param [in] userdata Value passed by the user using the 'HailstormParallelWriteParams' struct.
+            //! \return 'true' if all jobs where executed.
+            using ParallelForFn = auto(
+                uint32_t job_count,
+                JobFn* fn_job,
+                void* job_data,
+                void* userdata
+            ) noexcept -> bool;
+
+            //! \brief Please see documentation of ParallelForFn.
+            ParallelForFn* fn_parallel_for = nullptr;
+
+            //! \brief Number of threads to be used when 'fn_parallel_for' is not provided.
+            //! \note A value of '0' will use the number of hardware threads.
+            uint32_t worker_count = 0;
+
+            //! \brief Maximum number of resources written by a single job.
+            uint32_t resources_per_job = 16;
+
+            //! \brief User provided value, can be anything, passed to function routines.
+            void* parallel_userdata = nullptr;
+        };
+
+        //! \brief A description of a batch write operation for multiple Hailstorm clusters.
+        //! \note This description is an extension of the regular write params description.
+        //! \note If no 'fn_parallel_for' function is provided, the library will spawn 'worker_count' threads on it's own.
+        struct HailstormBatchWriteParams
+        {
+            //! \brief Params used to write each cluster.
+            //! \note Clusters are written from multiple threads, so both allocators and all callbacks are required to be thread-safe.
+            //! \note The 'temp_alloc' allocator is only used to allocate arena blocks and bookkeeping of the batch.
+            HailstormWriteParams base_params;
+
+            //! \brief Please see documentation of HailstormParallelWriteParams::ParallelForFn, each job writes a single cluster.
+            HailstormParallelWriteParams::ParallelForFn* fn_parallel_for = nullptr;
+
+            //! \brief Number of threads to be used when 'fn_parallel_for' is not provided.
+            //! \note A value of '0' will use the number of hardware threads.
+            uint32_t worker_count = 0;
+
+            //! \brief Minimal size of blocks allocated by arenas serving temporary allocations, \see ArenaAllocator.
+            size_t arena_block_size = 256 * Constant_1KiB;
+
+            //! \brief User provided value, can be anything, passed to function routines.
+            void* parallel_userdata = nullptr;
+        };
+
+        //! \brief Parameters used to verify chunks with 'verify_chunks'.
+        struct HailstormVerifyParams
+        {
+            //! \brief Please see documentation of HailstormParallelWriteParams::ParallelForFn, each job verifies a single chunk.
+            HailstormParallelWriteParams::ParallelForFn* fn_parallel_for = nullptr;
+
+            //! \brief Number of threads to be used when 'fn_parallel_for' is not provided.
+            //! \note A value of '0' will use the number of hardware threads.
+            uint32_t worker_count = 0;
+
+            //! \brief Optional list receiving the result of each chunk, needs to hold an entry for each chunk.
+            std::span<hailstorm::Result> out_results;
+
+            //! \brief User provided value, can be anything, passed to function routines.
+            void* parallel_userdata = nullptr;
+        };
+
+        //! \brief A description of a streamed write operation for a Hailstorm cluster.
+        //! \note This description is an extension of the regular write params description.
+        struct HailstormStreamWriteParams
+        {
+            HailstormWriteParams base_params;
+
+            //! \brief The file the cluster will be written to. Needs to be opened with write access.
+            //! \note The file position is not used nor updated, all writes are positional.
+            //! \note Padding between some of the data blocks may be skipped, so the written range should not contain old data.
+            hailstorm::NativeFileHandle file_handle;
+
+            //! \brief The offset in file at which the cluster should be written.
+            uint64_t file_offset = 0;
+
+            //! \brief The size of a single staging buffer.
+            size_t staging_buffer_size = Constant_1MiB;
+
+            //! \brief The number of staging buffers, allows to fill buffers while others are written to the file.
+            uint32_t staging_buffer_count = 4;
+        };
+
+        //! \brief The result of 'write_cluster_segments', describes the cluster as consecutive segments of data.
+        struct HailstormWriteSegments
+        {
+            //! \brief All segments in file order, their sizes sum up to 'size'.
+            std::span<hailstorm::Data const> segments;
+
+            //! \brief The total size of the cluster.
+            size_t size;
+
+            //! \brief Memory holding the segments list and all data not provided by the caller, allocated using 'cluster_alloc'.
+            //! \note Needs to be released using 'cluster_alloc' once the segments are no longer used.
+            hailstorm::Memory memory;
+        };
+
+        //! \brief Parameters used to write cluster segments to a file using 'write_segments_file'.
+        struct HailstormFileWriteParams
+        {
+            //! \brief Allocator used for staging buffers.
+            hailstorm::Allocator& alloc;
+
+            //! \brief Path of the file to be created, an existing file is overwritten.
+            char const* path;
+
+            //! \brief If 'true' the file is opened with 'O_DIRECT' / 'FILE_FLAG_NO_BUFFERING', bypassing the system file cache.
+            //! \remarks Writing big packs this way does not evict other data from the file cache.
+            bool unbuffered = true;
+
+            //! \brief Alignment of all write offsets, sizes and buffers for unbuffered access, needs to be a power of '2'.
+            //! \note Needs to be a multiple of the sector size of the device the file is stored on.
+            uint32_t io_alignment = 4 * Constant_1KiB;
+
+            //! \brief The size of a single staging buffer, rounded up to 'io_alignment'.
+            size_t staging_buffer_size = Constant_1MiB;
+
+            //! \brief The number of staging buffers, allows to fill buffers while others are written to the file.
+            uint32_t staging_buffer_count = 4;
+        };
+
+        //! \brief Describes changes applied to an existing cluster using 'repack_cluster'.
+        struct HailstormRepackData
+        {
+            //! \brief Header data of the existing cluster, including paths data.
+            //! \see hailstorm::v1::read_header
+            hailstorm::v1::HailstormData const& pack;
+
+            //! \brief View of the whole existing cluster, for example from a memory mapped file.
+            //! \note Reused chunks are referenced by the returned segments, so the view needs to stay valid as long as they are used.
+            hailstorm::Data pack_data;
+
+            //! \brief Indices of resources to be removed from the cluster.
+            std::span<uint32_t const> removed_resources;
+
+            //! \brief Resources to be stored in the cluster. Resources with the same path as an existing resource replace it,
+            //!   all other resources are added.
+            //! \note The 'custom_values' are ignored, values of the existing cluster are kept.
+            hailstorm::v1::HailstormWriteData const& resources;
+        };
+
+        //! \brief A range of bytes relative to the start of a pack.
+        struct HailstormByteRange
+        {
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        //! \brief A part of a resource data range stored in a single chunk, returned by 'resource_range_map'.
+        struct HailstormResourceRangePart
+        {
+            //! \brief Index of the chunk storing this part.
+            uint32_t chunk;
+
+            //! \brief Offset of the part relative to the start of the chunk.
+            uint64_t chunk_offset;
+
+            //! \brief Offset of the part relative to the start of the resource data.
+            uint64_t resource_offset;
+
+            //! \brief Size of the part in bytes.
+            uint64_t size;
+        };
+
+        //! \brief Key and nonce used to encrypt chunk data of a pack, \see HailstormWriteParams::encryption_key.
+        //! \details The nonce of each chunk consists of the chunk index followed by the pack 'nonce' value, while the ChaCha20
+        //!   block counter is the offset in the chunk divided by '64'. Chunks are limited to 256GiB when encrypted.
+        struct HailstormEncryptionKey
+        {
+            //! \brief The 256-bit ChaCha20 key.
+            uint8_t key[32];
+
+            //! \brief Value shared by all chunks of the pack.
+            //! \attention Each pack encrypted with the same key requires a different value, for example based on the pack identity.
+            uint8_t nonce[8];
+        };
+
+        //! \brief Location of each header part, returned by 'read_header_layout'.
+        //! \note Ranges of parts not stored in the pack have a size of '0'.
+        struct HailstormHeaderLayout
+        {
+            hailstorm::v1::HailstormByteRange chunks;
+            hailstorm::v1::HailstormByteRange resources;
+            hailstorm::v1::HailstormByteRange paths;
+
+            //! \brief The 'HailstormSections' struct followed by all 'HailstormSection' entries.
+            hailstorm::v1::HailstormByteRange sections_table;
+
+            //! \brief Range containing data of all sections, it ends at 'HailstormHeader::offset_data'.
+            hailstorm::v1::HailstormByteRange sections_data;
+        };
+
+        //! \brief Parameters used to create a read plan with 'plan_reads'.
+        struct HailstormReadPlanParams
+        {
+            //! \brief Allocator used for temporary data and the returned plan.
+            hailstorm::Allocator& alloc;
+
+            //! \brief Alignment of read offsets, sizes and memory locations, needs to be a power of '2'.
+            //! \note A value of '0' will use 'HailstormHeader::pack_slice_alignment', or '8' if the pack is not sliced.
+            //! \remarks Use the sector size of the device when reading using direct / unbuffered I/O.
+            uint32_t read_alignment = 0;
+
+            //! \brief Ranges separated by at most this many bytes are read using a single operation, reading the gap.
+            uint64_t merge_gap_threshold = 64 * Constant_1KiB;
+
+            //! \brief Ranges are not merged if the resulting read would be bigger than this value. A value of '0' disables the limit.
+            //! \note Single ranges bigger than the limit are not split.
+            uint64_t max_read_size = 0;
+
+            //! \brief If 'true' whole chunks are read instead of only the requested resource data.
+            //! \note Resources spanning multiple chunks will read all chunks storing their data.
+            bool read_whole_chunks = false;
+
+            //! \brief If 'true' also resource metadata is read.
+            bool read_metadata = false;
+        };
+
+        //! \brief A single read operation of a read plan.
+        struct HailstormReadOp
+        {
+            //! \brief Offset of the data to be read, relative to the start of the pack.
+            uint64_t offset;
+
+            //! \brief Number of bytes to be read.
+            //! \note When using an alignment bigger than the pack slice alignment, the last read may extend past the end of the pack.
+            uint64_t size;
+
+            //! \brief Offset in the destination buffer where the data should be stored.
+            uint64_t memory_offset;
+        };
+
+        //! \brief Location of a requested resource after all reads of a read plan are finished.
+        struct HailstormReadTarget
+        {
+            //! \brief Offset of the resource data in the destination buffer.
+            uint64_t data_offset;
+
+            //! \brief Offset of the resource metadata in the destination buffer, only valid if metadata was requested.
+            uint64_t meta_offset;
+
+            //! \brief Index of the read operation that reads the resource data.
+            uint32_t data_read;
+
+            //! \brief Index of the read operation that reads the resource metadata, or 'Constant_HailstormInvalidIndex'.
+            uint32_t meta_read;
+        };
+
+        //! \brief The result of 'plan_reads', a list of reads into a single destination buffer.
+        struct HailstormReadPlan
+        {
+            //! \brief All reads to be executed, ordered by their offset. Reads can be executed in any order.
+            std::span<hailstorm::v1::HailstormReadOp const> reads;
+
+            //! \brief The location of each requested resource, in the order resources where requested.
+            std::span<hailstorm::v1::HailstormReadTarget const> targets;
+
+            //! \brief Size of the destination buffer required to execute all reads.
+            uint64_t memory_size;
+
+            //! \brief Alignment required for the destination buffer.
+            uint32_t memory_align;
+
+            //! \brief Memory holding the reads and targets lists, allocated using 'alloc'.
+            //! \note Needs to be released using 'alloc' once the plan is no longer used.
+            hailstorm::Memory memory;
         };
 
         //! \brief Default heuristic for creating chunks.
@@ -402,7 +1440,7 @@ namespace hailstorm
         //! \note This function is suboptimal, it assumes all chunks are mixed and always assigns both
         //!   data and metadata to the last chunk. New chunks will be created if the selected chunk is to small.
         inline auto default_chunk_select_logic(
-            hailstorm::Data const& /*resource_meta*/,
+            hailstorm::Data /*resource_meta*/,
             hailstorm::Data /*resource_data*/,
             std::span<hailstorm::v1::HailstormChunk const> chunks,
             uint32_t /*partial_chunk_start*/,
@@ -0,0 +1,105 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <hailstorm/hailstorm_types.hxx>
+#include <hailstorm/hailstorm.hxx>
+
+namespace hailstorm
+{
+
+    namespace v1
+    {
+
+        //! \brief Provides access to a single Hailstorm pack stored in a file by mapping it into memory.
+        //!
+        //! \details The whole pack is mapped at once, but data is only loaded when accessed. All returned views point
+        //!   directly into the mapped memory and are valid as long as the reader is open.
+        //!
+        //! \note Chunk residency follows the 'HailstormChunk::persistance' value:
+        //!   * 'LoadAlways' - chunks are loaded when opening the pack and are never released.
+        //!   * 'LoadIfPossible' - chunks are loaded on acquire and are kept in memory after being released.
+        //!   * 'Regular' - chunks are loaded on acquire and are marked as reclaimable once released.
+        //!   * 'Temporary' - chunks are loaded on acquire and their memory is released immediately once released.
+        //!
+        //! \note Once opened, all functions except 'open' and 'close' can be called from multiple threads. Chunk references
+        //!   are atomic counters, so acquiring and releasing chunks never takes a lock.
+        class PackReader final
+        {
+        public:
+            //! \param [in] alloc Allocator used for internal bookkeeping.
+            explicit PackReader(hailstorm::Allocator& alloc) noexcept;
+            ~PackReader() noexcept;
+
+            //! \brief Opens the file at the given path and maps the pack starting at 'pack_offset'.
+            //! \return 'Result::Success' if the pack was opened, otherwise an error describing the issue.
+            auto open(char const* path, uint64_t pack_offset = 0) noexcept -> hailstorm::Result;
+
+            //! \brief Maps the pack starting at 'pack_offset' from an already opened file.
+            //! \note The file handle is not owned by the reader and needs to stay open as long as the reader is open.
+            //! \return 'Result::Success' if the pack was opened, otherwise an error describing the issue.
+            auto open(hailstorm::NativeFileHandle file, uint64_t pack_offset = 0) noexcept -> hailstorm::Result;
+
+            //! \brief Unmaps the pack and closes the file if it was opened by the reader.
+            void close() noexcept;
+
+            //! \return 'true' if a pack is currently open.
+            bool is_open() const noexcept { return _mapping_base != nullptr; }
+
+            //! \return Header information of the opened pack. Path data is always available.
+            auto data() const noexcept -> hailstorm::v1::HailstormData const& { return _data; }
+
+            //! \brief Returns a view of the whole chunk and requests it's data to be loaded.
+            //! \note Each call needs to be paired with a call to 'release_chunk'.
+            auto acquire_chunk(uint32_t chunk_idx) noexcept -> hailstorm::Data;
+
+            //! \brief Releases a chunk acquired earlier, once unused the chunk memory is handled based on it's persistance.
+            void release_chunk(uint32_t chunk_idx) noexcept;
+
+            //! \return A view of the resource data. Does not change the residency of the owning chunk.
+            auto resource_data(uint32_t resource_idx) const noexcept -> hailstorm::Data;
+
+            //! \brief Returns a view of a byte range of the resource data and requests all chunks storing it to be loaded.
+            //! \details Allows to keep only a part of resources stored in 'Streamed' chunks resident, for example a sliding
+            //!   window over audio or video data. Chunks no longer covered by the window are handled based on their persistance.
+            //! \note Each call needs to be paired with a call to 'release_resource_range' using the same range.
+            //! \return A view of the requested range or an empty view if the range is not valid for the resource.
+            auto acquire_resource_range(uint32_t resource_idx, uint64_t offset, uint64_t size) noexcept -> hailstorm::Data;
+
+            //! \brief Releases all chunks acquired for a resource range earlier.
+            void release_resource_range(uint32_t resource_idx, uint64_t offset, uint64_t size) noexcept;
+
+            //! \return A view of the resource metadata. Does not change the residency of the owning chunk.
+            auto resource_metadata(uint32_t resource_idx) const noexcept -> hailstorm::Data;
+
+            //! \brief Requests all chunks storing data or metadata of the given resources to be loaded ahead of time.
+            //! \details Chunks are grouped into continuous ranges, so packs written with an access order are read using few
+            //!   large reads. The request is only a hint, it does not change the residency of chunks or require a release.
+            //! \see HailstormWriteData::access_order
+            void prefetch(std::span<uint32_t const> resources) const noexcept;
+
+            PackReader(PackReader const&) noexcept = delete;
+            auto operator=(PackReader const&) noexcept -> PackReader& = delete;
+
+        private:
+            auto open_internal(hailstorm::NativeFileHandle file, uint64_t pack_offset) noexcept -> hailstorm::Result;
+
+        private:
+            hailstorm::Allocator& _allocator;
+            hailstorm::NativeFileHandle _file;
+            bool _owns_file;
+
+            void* _mapping_base;
+            size_t _mapping_size;
+            hailstorm::NativeFileHandle _mapping_native;
+            hailstorm::Data _mapping_data;
+
+            hailstorm::v1::HailstormData _data;
+            hailstorm::Memory _chunk_refs;
+        };
+
+    } // namespace v1
+
+    using PackReader = v1::PackReader;
+
+} // namespace hailstorm
@@ -0,0 +1,114 @@
+/// Copyright 2023 - 2023, Dandielo <dandielo@iceshard.net>
+/// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <hailstorm/hailstorm_types.hxx>
+#include <hailstorm/hailstorm_pack_reader.hxx>
+
+namespace hailstorm
+{
+
+    namespace v1
+    {
+
+        //! \brief Identifies a single resource in a pack set.
+        struct PackSetResource
+        {
+            //! \brief Index of the pack, in the order packs where added to the set.
+            uint32_t pack = Constant_HailstormInvalidIndex;
+
+            //! \brief Index of the resource in the pack.
+            uint32_t resource = Constant_HailstormInvalidIndex;
+        };
+
+        //! \brief Provides access to resources stored in multiple packs, where expansion and patch packs override resources
+        //!   of the packs they are applied to.
+        //!
+        //! \details Each added file is walked following 'HailstormHeader::offset_next' and every pack found is opened using a
+        //!   'PackReader'. Once all files are added, 'build' applies packs in the order of their identity values
+        //!   ('pack_id', 'pack_expansion_ver', 'pack_patch_ver') and creates a resolution table for all resources, so
+        //!   resolving a resource to it's final version is a single indexed lookup.
+        //!
+        //! \note Override rules:
+        //!   * Patch packs apply to the pack with the same 'pack_id' and 'pack_expansion_ver'.
+        //!   * Expansion packs apply to the pack with the same 'pack_id' and 'pack_expansion_ver - 1'.
+        //!   * Resources with a 'path_size' of '0' in patch and expansion packs override the resource at index 'path_offset'
+        //!     in the pack they apply to.
+        //!   * All other resources override the resource with the same path, with the pack applied last winning.
+        //!
+        //! \note Thread-safety:
+        //!   * Lookups ('resolve', 'find_resource', 'resource_data', 'resource_metadata') never take a lock and can be called
+        //!     from any number of threads, also while files are added and 'build' is called from another thread.
+        //!   * Each 'build' publishes a new resolution table, lookups started before keep using the previous table, which is
+        //!     released once all of them finished. This allows to mount patches without stalling the loading threads.
+        //!   * 'add_file', 'build' and 'close' need to be called from a single thread at a time, 'close' can't be called
+        //!     while lookups are still in progress.
+        class PackSet final
+        {
+        public:
+            //! \param [in] alloc Allocator used for readers and internal bookkeeping.
+            explicit PackSet(hailstorm::Allocator& alloc) noexcept;
+            ~PackSet() noexcept;
+
+            //! \brief Opens the file at the given path and adds all packs stored in it.
+            //! \note Added packs are only used for lookups after the next call to 'build'.
+            //! \return 'Result::Success' if all packs where added, otherwise an error describing the issue and no packs are added.
+            auto add_file(char const* path) noexcept -> hailstorm::Result;
+
+            //! \brief Adds all packs stored in an already opened file.
+            //! \note The file handle is not owned by the set and needs to stay open as long as the set is open.
+            //! \return 'Result::Success' if all packs where added, otherwise an error describing the issue and no packs are added.
+            auto add_file(hailstorm::NativeFileHandle file) noexcept -> hailstorm::Result;
+
+            //! \brief Creates the resolution table for all added packs and publishes it for lookups.
+            //! \note Waits until all lookups using the previous table finished, lookups are never blocked.
+            //! \return 'Result::Success' if the table was created, 'Result::E_InvalidPackChain' if a patch or expansion pack
+            //!   can't be applied, or 'Result::E_InvalidPackData' if a resource overrides a resource index that does not exist.
+            //!   On failure, the previously published table stays in use.
+            auto build() noexcept -> hailstorm::Result;
+
+            //! \brief Closes all packs and files opened by the set.
+            void close() noexcept;
+
+            //! \return The number of packs in the set, including packs added after the last 'build'.
+            auto count_packs() const noexcept -> uint32_t;
+
+            //! \return The reader of the given pack.
+            //! \note Packs of the published table can be accessed while files are added from another thread.
+            auto pack(uint32_t pack_idx) noexcept -> hailstorm::v1::PackReader&;
+            auto pack(uint32_t pack_idx) const noexcept -> hailstorm::v1::PackReader const&;
+
+            //! \return The final version of the given resource, which might be the resource itself.
+            //! \pre 'build' was called successfully at least once and the pack was added before the last successful 'build'.
+            auto resolve(uint32_t pack_idx, uint32_t resource_idx) const noexcept -> hailstorm::v1::PackSetResource;
+
+            //! \return The final version of the resource with the given path, or an invalid resource if not found.
+            //! \pre 'build' was called successfully at least once.
+            auto find_resource(std::string_view path) const noexcept -> hailstorm::v1::PackSetResource;
+
+            //! \return A view of the resource data. \see PackReader::resource_data
+            auto resource_data(hailstorm::v1::PackSetResource resource) const noexcept -> hailstorm::Data;
+
+            //! \return A view of the resource metadata. \see PackReader::resource_metadata
+            auto resource_metadata(hailstorm::v1::PackSetResource resource) const noexcept -> hailstorm::Data;
+
+            PackSet(PackSet const&) noexcept = delete;
+            auto operator=(PackSet const&) noexcept -> PackSet& = delete;
+
+        private:
+            struct Internal;
+            struct Table;
+
+            auto add_file_internal(hailstorm::NativeFileHandle file) noexcept -> hailstorm::Result;
+
+        private:
+            hailstorm::Allocator& _allocator;
+            Internal* _internal;
+        };
+
+    } // namespace v1
+
+    using PackSetResource = v1::PackSetResource;
+    using PackSet = v1::PackSet;
+
+} // namespace hailstorm
@@ -2,6 +2,7 @@
 #include <span>
 #include <string_view>
 #include <memory>
+#include <cstdint>
 
 namespace hailstorm
 {
@@ -29,8 +30,29 @@ namespace hailstorm
         //! \details It is allowed to have chunks without resources. Such data is defined by an external tool / application.
         //!   Because of this, even if there are no resources, such a pack is NOT considered empty.
         E_EmptyPack,
+
+        //! \brief A file operation failed, the file might not exist or is not accessible.
+        E_FileAccessError,
+
+        //! \brief The compression format is not supported by this build of the library.
+        E_UnsupportedCompression,
+
+        //! \brief Data could not be decompressed, it's either corrupted or the output memory is too small.
+        E_DecompressionFailed,
+
+        //! \brief A patch or expansion pack is missing the pack it applies to, or multiple packs have the same identity.
+        E_InvalidPackChain,
+
+        //! \brief Chunk data does not match the checksum stored in the pack.
+        E_ChecksumMismatch,
+
+        //! \brief The provided allocator failed to allocate the required memory.
+        E_OutOfMemory,
     };
 
+    //! \brief Native file handle, a file descriptor on POSIX systems or a 'HANDLE' value on Windows.
+    using NativeFileHandle = intptr_t;
+
     //! \brief Used to pass data to some functions.
     struct Data
     {